@@ -20,6 +20,8 @@
 #include <multiplier/GUI/Managers/ThemeManager.h>
 #include <multiplier/GUI/Plugins/BuiltinEntityInformationPlugin.h>
 #include <multiplier/GUI/Plugins/CallHierarchyPlugin.h>
+#include <multiplier/GUI/Plugins/CallPathPlugin.h>
+#include <multiplier/GUI/Plugins/CalleeHierarchyPlugin.h>
 #include <multiplier/GUI/Plugins/ClassHierarchyPlugin.h>
 #include <multiplier/GUI/Plugins/StructExplorerPlugin.h>
 #include <multiplier/GUI/Themes/BuiltinTheme.h>
@@ -99,6 +101,10 @@ void MainWindow::InitializePlugins(void) {
   auto ref_explorer = new ReferenceExplorer(d->config_manager, wm);
   ref_explorer->EmplacePlugin<CallHierarchyPlugin>(
       d->config_manager, ref_explorer);
+  ref_explorer->EmplacePlugin<CalleeHierarchyPlugin>(
+      d->config_manager, ref_explorer);
+  ref_explorer->EmplacePlugin<CallPathPlugin>(
+      d->config_manager, ref_explorer);
   ref_explorer->EmplacePlugin<ClassHierarchyPlugin>(
       d->config_manager, ref_explorer);
   ref_explorer->EmplacePlugin<StructExplorerPlugin>(
@@ -199,8 +205,9 @@ void MainWindow::InitializeIndex(QApplication &application) {
     db_path = parser.value(db_option);
   }
 
-  d->config_manager.SetIndex(Index::in_memory_cache(
-      Index::from_database(db_path.toStdString())));
+  d->config_manager.SetIndex(
+      Index::in_memory_cache(Index::from_database(db_path.toStdString())),
+      db_path);
 
   // Set the theme.
   QString theme_name;
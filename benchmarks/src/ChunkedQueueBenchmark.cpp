@@ -0,0 +1,126 @@
+// Copyright (c) 2024-present, Trail of Bits, Inc.
+// All rights reserved.
+//
+// This source code is licensed in accordance with the terms specified in
+// the LICENSE file found in the root directory of this source tree.
+
+// Microbenchmark of the queue that generator models use to buffer generated
+// items between runnables and the model. Items arrive in batches of
+// `kMaxBatchSize`, like they do from the runnables, and are drained one by
+// one, like they are by the models. The time per item should stay flat as the
+// number of items grows. For comparison, it also measures the previous
+// design, a `std::list` of batches that are themselves `std::list`s.
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QVector>
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "ChunkedQueue.h"
+#include "IGenerateTreeRunnable.h"
+
+namespace mx::gui {
+namespace {
+
+// Stand-in for `IGeneratedItemPtr`, which has the same size and the same
+// reference counting costs.
+using Item = std::shared_ptr<int>;
+
+static QVector<Item> MakeBatch(size_t first, size_t num_items) {
+  QVector<Item> batch;
+  batch.reserve(static_cast<qsizetype>(num_items));
+  for (size_t i = 0u; i < num_items; ++i) {
+    batch.emplace_back(std::make_shared<int>(static_cast<int>(first + i)));
+  }
+  return batch;
+}
+
+// Pre-generate the batches, so that only queueing and draining are timed.
+static std::vector<QVector<Item>> MakeBatches(size_t num_items) {
+  std::vector<QVector<Item>> batches;
+  for (size_t i = 0u; i < num_items; i += kMaxBatchSize) {
+    batches.emplace_back(MakeBatch(
+        i, std::min<size_t>(kMaxBatchSize, num_items - i)));
+  }
+  return batches;
+}
+
+static double TimeChunkedQueue(std::vector<QVector<Item>> batches) {
+  QElapsedTimer timer;
+  timer.start();
+
+  ChunkedQueue<Item> queue;
+  for (auto &batch : batches) {
+    queue.append(std::move(batch));
+  }
+
+  int64_t sum = 0;
+  while (!queue.empty()) {
+    sum += *queue.take_front();
+  }
+
+  auto elapsed = timer.nsecsElapsed();
+  Q_ASSERT(sum >= 0);
+  (void) sum;
+  return static_cast<double>(elapsed);
+}
+
+static double TimeListOfLists(std::vector<QVector<Item>> batches) {
+  QElapsedTimer timer;
+  timer.start();
+
+  std::list<std::list<Item>> queue;
+  for (auto &batch : batches) {
+    auto &items = queue.emplace_back();
+    for (auto &item : batch) {
+      items.emplace_back(std::move(item));
+    }
+  }
+
+  int64_t sum = 0;
+  while (!queue.empty()) {
+    auto &items = queue.front();
+    while (!items.empty()) {
+      sum += *items.front();
+      items.pop_front();
+    }
+    queue.pop_front();
+  }
+
+  auto elapsed = timer.nsecsElapsed();
+  Q_ASSERT(sum >= 0);
+  (void) sum;
+  return static_cast<double>(elapsed);
+}
+
+}  // namespace
+}  // namespace mx::gui
+
+int main(void) {
+  using namespace mx::gui;
+
+  QJsonArray results;
+  for (size_t num_items = 1000u; num_items <= 1000000u; num_items *= 10u) {
+    auto chunked_ns = TimeChunkedQueue(MakeBatches(num_items));
+    auto list_ns = TimeListOfLists(MakeBatches(num_items));
+    auto num_items_d = static_cast<double>(num_items);
+
+    QJsonObject result;
+    result["num_items"] = static_cast<qint64>(num_items);
+    result["chunked_queue_ns_per_item"] = chunked_ns / num_items_d;
+    result["list_of_lists_ns_per_item"] = list_ns / num_items_d;
+    results.append(result);
+  }
+
+  std::cout << QJsonDocument(results).toJson(QJsonDocument::Indented)
+                   .toStdString();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,359 @@
+// Copyright (c) 2024-present, Trail of Bits, Inc.
+// All rights reserved.
+//
+// This source code is licensed in accordance with the terms specified in
+// the LICENSE file found in the root directory of this source tree.
+
+// Headless rendering benchmark of the `CodeWidget`. For each file in a
+// database, this opens the file in a code widget on the offscreen Qt platform,
+// and times the following phases:
+//
+//    - `change_scene`: From `ChangeScene` to the end of the first paint.
+//    - `scroll`: Paging down through the whole file, painting each page.
+//    - `theme_switch`: Switching to the light theme and painting.
+//    - `expand_macros`: Expanding every macro substitution and painting.
+//    - `search`: Searching for a pattern until all results arrive.
+//    - `go_to_entity`: Going to an entity near the end of the file.
+//
+// The results, along with the peak RSS, are printed as JSON. The database is
+// usually the indexed build of `ci/data/sample_database01`, e.g.
+//
+//    mx-index --target compile_commands.json --db /tmp/sample_database01.db
+//    CodeWidgetBenchmark --database /tmp/sample_database01.db
+
+#include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QKeyEvent>
+#include <QLineEdit>
+#include <QScrollBar>
+
+#include <multiplier/GUI/Managers/ConfigManager.h>
+#include <multiplier/GUI/Managers/TaskManager.h>
+#include <multiplier/GUI/Managers/ThemeManager.h>
+#include <multiplier/GUI/Themes/BuiltinTheme.h>
+#include <multiplier/GUI/Widgets/CodeWidget.h>
+#include <multiplier/GUI/Widgets/SearchWidget.h>
+#include <multiplier/Frontend/TokenTree.h>
+#include <multiplier/Index.h>
+
+#include <sys/resource.h>
+
+#include <iostream>
+#include <variant>
+
+namespace mx::gui {
+namespace {
+
+// Upper bound on the number of pages that we scroll through in one file, so
+// that huge files don't dominate the run.
+static constexpr int kMaxPages = 1000;
+
+static constexpr int kViewportWidth = 1280;
+static constexpr int kViewportHeight = 1024;
+
+// Drain the event loop until there is no more background work, e.g. building
+// scenes or searching, and no more results of that work left to deliver.
+static void WaitForIdle(const TaskManager &task_manager) {
+  do {
+    task_manager.WaitForDone();
+    QCoreApplication::processEvents();
+  } while (task_manager.NumActiveThreads());
+}
+
+// Wait for background work, then synchronously paint `widget`.
+static void WaitAndPaint(const TaskManager &task_manager, QWidget *widget) {
+  WaitForIdle(task_manager);
+  widget->repaint();
+}
+
+static double ElapsedMs(const QElapsedTimer &timer) {
+  return static_cast<double>(timer.nsecsElapsed()) / 1e6;
+}
+
+// Returns the peak resident set size of this process, in bytes.
+static qint64 PeakRSS(void) {
+  struct rusage usage = {};
+  if (getrusage(RUSAGE_SELF, &usage)) {
+    return 0;
+  }
+
+#ifdef __APPLE__
+  return static_cast<qint64>(usage.ru_maxrss);
+#else
+  return static_cast<qint64>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+// Collect the IDs of all macro substitutions in `node`, including those that
+// are only revealed by expanding other substitutions.
+static void CollectMacros(TokenTreeNode node,
+                          QSet<RawEntityId> &macros_to_expand) {
+  switch (node.kind()) {
+    case TokenTreeNodeKind::EMPTY:
+    case TokenTreeNodeKind::TOKEN:
+      break;
+    case TokenTreeNodeKind::CHOICE:
+      for (auto &item : reinterpret_cast<ChoiceTokenTreeNode &>(
+               node).children()) {
+        CollectMacros(std::move(item.second), macros_to_expand);
+      }
+      break;
+    case TokenTreeNodeKind::SUBSTITUTION: {
+      auto &sub = reinterpret_cast<SubstitutionTokenTreeNode &>(node);
+      std::visit([&] (const auto &macro) {
+                   macros_to_expand.insert(macro.id().Pack());
+                 },
+                 sub.macro());
+      CollectMacros(sub.before(), macros_to_expand);
+      CollectMacros(sub.after(), macros_to_expand);
+      break;
+    }
+    case TokenTreeNodeKind::SEQUENCE:
+      for (auto child_node : reinterpret_cast<SequenceTokenTreeNode &>(
+               node).children()) {
+        CollectMacros(std::move(child_node), macros_to_expand);
+      }
+      break;
+  }
+}
+
+// Find an entity referenced near the end of `file`, so that going to it has
+// to scroll.
+static VariantEntity LastRelatedEntity(const File &file) {
+  TokenRange tokens = file.tokens();
+  for (auto i = tokens.size(); i--; ) {
+    VariantEntity entity = tokens[i].related_entity();
+    if (!std::holds_alternative<NotAnEntity>(entity)) {
+      return entity;
+    }
+  }
+  return NotAnEntity{};
+}
+
+// Type `pattern` into the search widget of `code_widget`.
+static bool StartSearch(CodeWidget *code_widget, const QString &pattern) {
+  auto search_widget = code_widget->findChild<SearchWidget *>();
+  if (!search_widget) {
+    return false;
+  }
+
+  search_widget->Activate();
+
+  // The other line edit is the hidden error display.
+  for (auto line_edit : search_widget->findChildren<QLineEdit *>()) {
+    if (!line_edit->isHidden()) {
+      line_edit->setText(pattern);
+      return true;
+    }
+  }
+  return false;
+}
+
+class Benchmark {
+ public:
+  Benchmark(ConfigManager &config_manager_, const QString &pattern_)
+      : config_manager(config_manager_),
+        theme_manager(config_manager.ThemeManager()),
+        task_manager(config_manager.TaskManager()),
+        pattern(pattern_) {}
+
+  QJsonObject Run(const QString &path, const File &file);
+
+ private:
+  ConfigManager &config_manager;
+  ThemeManager &theme_manager;
+  TaskManager &task_manager;
+  const QString pattern;
+};
+
+QJsonObject Benchmark::Run(const QString &path, const File &file) {
+  QJsonObject timings;
+  QElapsedTimer timer;
+
+  theme_manager.SetTheme(theme_manager.Find("com.trailofbits.theme.Dark"));
+
+  CodeWidget code_widget(config_manager,
+                         "com.trailofbits.benchmark.CodeWidgetBenchmark");
+  code_widget.resize(kViewportWidth, kViewportHeight);
+  code_widget.show();
+  WaitAndPaint(task_manager, &code_widget);
+
+  auto token_tree = TokenTree::create(file);
+  auto file_id = file.id().Pack();
+
+  timer.start();
+  code_widget.ChangeScene(token_tree, {}, file_id);
+  WaitAndPaint(task_manager, &code_widget);
+  timings["change_scene"] = ElapsedMs(timer);
+
+  // Page down through the file, like a reader would.
+  QScrollBar *scrollbar = nullptr;
+  for (auto child : code_widget.findChildren<QScrollBar *>()) {
+    if (child->orientation() == Qt::Vertical) {
+      scrollbar = child;
+    }
+  }
+
+  auto num_pages = 0;
+  timer.start();
+  for (auto prev_value = -1;
+       scrollbar && num_pages < kMaxPages && scrollbar->value() != prev_value;
+       ++num_pages) {
+    prev_value = scrollbar->value();
+    QKeyEvent page_down(QEvent::KeyPress, Qt::Key_PageDown, Qt::NoModifier);
+    QCoreApplication::sendEvent(&code_widget, &page_down);
+    WaitAndPaint(task_manager, &code_widget);
+  }
+  timings["scroll"] = ElapsedMs(timer);
+
+  timer.start();
+  theme_manager.SetTheme(theme_manager.Find("com.trailofbits.theme.Light"));
+  WaitAndPaint(task_manager, &code_widget);
+  timings["theme_switch"] = ElapsedMs(timer);
+
+  QSet<RawEntityId> macros_to_expand;
+  CollectMacros(token_tree.root(), macros_to_expand);
+
+  timer.start();
+  code_widget.OnExpandMacros(macros_to_expand);
+  WaitAndPaint(task_manager, &code_widget);
+  timings["expand_macros"] = ElapsedMs(timer);
+
+  timer.start();
+  if (StartSearch(&code_widget, pattern)) {
+    WaitAndPaint(task_manager, &code_widget);
+    timings["search"] = ElapsedMs(timer);
+  }
+
+  VariantEntity entity = LastRelatedEntity(file);
+  if (!std::holds_alternative<NotAnEntity>(entity)) {
+    timer.start();
+    code_widget.OnGoToEntity(entity, false  /* take focus */);
+    WaitAndPaint(task_manager, &code_widget);
+    timings["go_to_entity"] = ElapsedMs(timer);
+  }
+
+  auto paint_stats = code_widget.GetPaintStatistics();
+  QJsonObject paints;
+  paints["num_paints"] = static_cast<qint64>(paint_stats.num_paints);
+  paints["p50_ms"] = paint_stats.p50_ms;
+  paints["p99_ms"] = paint_stats.p99_ms;
+  paints["max_ms"] = paint_stats.max_ms;
+
+  QJsonObject result;
+  result["path"] = path;
+  result["num_pages"] = num_pages;
+  result["num_macros"] = static_cast<qint64>(macros_to_expand.size());
+  result["timings_ms"] = timings;
+  result["paints"] = paints;
+  result["peak_rss"] = PeakRSS();
+  return result;
+}
+
+}  // namespace
+}  // namespace mx::gui
+
+int main(int argc, char *argv[]) {
+  using namespace mx;
+  using namespace mx::gui;
+
+  // Render without a display, unless told otherwise.
+  if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+
+  QApplication::setStyle("Fusion");
+  QApplication application(argc, argv);
+  application.setApplicationName("CodeWidgetBenchmark");
+
+  qRegisterMetaType<uint64_t>("uint64_t");
+  qRegisterMetaType<RawEntityId>("RawEntityId");
+  qRegisterMetaType<VariantEntity>("VariantEntity");
+
+  QCommandLineOption db_option("database");
+  db_option.setValueName("database");
+
+  QCommandLineOption pattern_option("pattern");
+  pattern_option.setValueName("pattern");
+  pattern_option.setDefaultValue("return");
+
+  QCommandLineOption output_option("output");
+  output_option.setValueName("output");
+
+  QCommandLineParser parser;
+  parser.addHelpOption();
+  parser.addOption(db_option);
+  parser.addOption(pattern_option);
+  parser.addOption(output_option);
+  parser.process(application);
+
+  if (!parser.isSet(db_option)) {
+    std::cerr << "Missing --database" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  ConfigManager config_manager(application);
+  config_manager.SetIndex(
+      Index::in_memory_cache(
+          Index::from_database(parser.value(db_option).toStdString())),
+      parser.value(db_option));
+
+  auto &theme_manager = config_manager.ThemeManager();
+  auto &media_manager = config_manager.MediaManager();
+  theme_manager.Register(CreateDarkTheme(media_manager));
+  theme_manager.Register(CreateLightTheme(media_manager));
+
+  Benchmark benchmark(config_manager, parser.value(pattern_option));
+
+  QJsonArray files;
+  QElapsedTimer total_timer;
+  total_timer.start();
+
+  const Index &index = config_manager.Index();
+  for (const auto &[path, file_id] : index.file_paths()) {
+    if (auto file = index.file(file_id)) {
+      files.append(benchmark.Run(
+          QString::fromStdString(path.generic_string()), file.value()));
+    }
+  }
+
+  auto scene_stats = CodeWidget::GetSceneCacheStatistics();
+  QJsonObject scene_cache;
+  scene_cache["num_hits"] = static_cast<qint64>(scene_stats.num_hits);
+  scene_cache["num_misses"] = static_cast<qint64>(scene_stats.num_misses);
+  scene_cache["memory_usage"] = static_cast<qint64>(scene_stats.memory_usage);
+
+  auto glyph_stats = CodeWidget::GetGlyphCacheStatistics();
+  QJsonObject glyph_cache;
+  glyph_cache["num_hits"] = static_cast<qint64>(glyph_stats.num_hits);
+  glyph_cache["num_misses"] = static_cast<qint64>(glyph_stats.num_misses);
+  glyph_cache["num_entries"] = static_cast<qint64>(glyph_stats.num_entries);
+
+  QJsonObject report;
+  report["files"] = files;
+  report["total_ms"] = ElapsedMs(total_timer);
+  report["peak_rss"] = PeakRSS();
+  report["scene_cache"] = scene_cache;
+  report["glyph_cache"] = glyph_cache;
+
+  auto json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+  if (parser.isSet(output_option)) {
+    QFile output(parser.value(output_option));
+    if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+      std::cerr << "Unable to open " << output.fileName().toStdString()
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+    output.write(json);
+  } else {
+    std::cout << json.toStdString();
+  }
+
+  return EXIT_SUCCESS;
+}
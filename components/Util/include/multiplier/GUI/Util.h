@@ -37,6 +37,8 @@
 #include <QString>
 #include <QMenu>
 
+#include <cstdint>
+#include <functional>
 #include <optional>
 #include <unordered_map>
 #include <utility>
@@ -49,11 +51,40 @@ class Token;
 class TokenRange;
 namespace gui {
 
+//! Return the named entity containing `entity`, or `NotAnEntity`. Results are
+//! memoized by entity ID until `ClearContainingEntityCaches` is called.
 VariantEntity NamedEntityContaining(const VariantEntity &entity);
 
+//! Return the memoized result of `NamedDeclContaining` for the entity whose
+//! ID is `id`, calling `compute` to find it if it isn't cached.
+VariantEntity MemoizedNamedDeclContaining(
+    RawEntityId id, const std::function<VariantEntity(void)> &compute);
+
+//! Hit and miss counts of the caches behind `NamedEntityContaining` and
+//! `NamedDeclContaining`.
+struct ContainingEntityCacheStats final {
+  std::uint64_t named_entity_hits{};
+  std::uint64_t named_entity_misses{};
+  std::uint64_t named_decl_hits{};
+  std::uint64_t named_decl_misses{};
+};
+
+//! Return the hit and miss counts of the caches behind
+//! `NamedEntityContaining` and `NamedDeclContaining`.
+ContainingEntityCacheStats GetContainingEntityCacheStats(void);
+
+//! Clear the caches behind `NamedEntityContaining` and `NamedDeclContaining`.
+//! Entity IDs are only meaningful within one index, so this must be called
+//! whenever the index changes, after `TaskManager::AdvanceEpoch`. Only tasks
+//! started after that use the caches.
+void ClearContainingEntityCaches(void);
+
 template <typename T>
 static VariantEntity NamedDeclContaining(const T &thing) requires(
-    !std::is_same_v<T, VariantEntity>) {
+    !std::is_same_v<T, VariantEntity>);
+
+template <typename T>
+static VariantEntity NamedDeclContainingUncached(const T &thing) {
   for (FunctionDecl func : FunctionDecl::containing(thing)) {
     return func;
   }
@@ -81,6 +112,14 @@ static VariantEntity NamedDeclContaining(const T &thing) requires(
   return NotAnEntity{};
 }
 
+template <typename T>
+static VariantEntity NamedDeclContaining(const T &thing) requires(
+    !std::is_same_v<T, VariantEntity>) {
+  return MemoizedNamedDeclContaining(
+      thing.id().Pack(),
+      [&thing] (void) { return NamedDeclContainingUncached(thing); });
+}
+
 //! Generates the `Copy` menu subsection for an IModel index
 void GenerateCopySubMenu(QMenu *menu, const QModelIndex &index);
 
@@ -134,9 +173,16 @@ QString TokensToString(const TokenRange &tokens);
 //! Return the tokens of `ent` as a string.
 QString TokensToString(const VariantEntity &ent);
 
-//! Create a breadcrumbs string of the token contexts.
+//! Create a breadcrumbs string of the token contexts. Results are memoized by
+//! the innermost token context until `ClearBreadCrumbsCaches` is called, and
+//! identical breadcrumbs share storage.
 QString TokenBreadCrumbs(const Token &ent, bool run_length_encode = true);
 
+//! Clear the memoized results of `TokenBreadCrumbs` and `EntityBreadCrumbs`.
+//! Entity IDs are only meaningful within one index, so this must be called
+//! whenever the index changes, after `TaskManager::AdvanceEpoch`.
+void ClearBreadCrumbsCaches(void);
+
 //! Create a breadcrumbs string of the token contexts.
 QString EntityBreadCrumbs(const VariantEntity &ent,
                           bool run_length_encode = true);
@@ -6,6 +6,7 @@
 
 #include "Util.h"
 
+#include <atomic>
 #include <cassert>
 #include <iostream>
 
@@ -14,8 +15,12 @@
 #include <QApplication>
 #include <QClipboard>
 #include <QMessageBox>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
 
 #include <multiplier/GUI/Interfaces/IModel.h>
+#include <multiplier/GUI/Managers/TaskManager.h>
 
 #include <multiplier/AST.h>
 #include <multiplier/Fragment.h>
@@ -30,8 +35,110 @@ namespace {
 
 static const QString kGeneratedCopyMenuSignature{"GeneratedCopyMenu"};
 
+// A sharded, thread-safe memo of something computed from each entity, e.g.
+// the entity containing it. Many threads, e.g. those expanding call
+// hierarchies and labelling history items, ask about the same entities, so
+// each shard has its own lock.
+template <typename T>
+class EntityIdCache {
+  static constexpr unsigned kNumShardBits = 4u;
+  static constexpr unsigned kNumShards = 1u << kNumShardBits;
+
+  // Upper bound on the number of entries in a shard. A full shard is emptied
+  // rather than tracking recency, as cached entities hold their fragments in
+  // memory.
+  static constexpr size_t kMaxShardSize = 1u << 12u;
+
+  struct Shard {
+    QMutex lock;
+    std::unordered_map<RawEntityId, T> entries;
+  };
+
+  Shard shards[kNumShards];
+
+  // The task epoch of the index whose entities are cached. This is set by
+  // `Clear`, so that lookups of entities of an old index, e.g. by tasks that
+  // were started before the index changed, neither use nor add entries.
+  std::atomic<uint64_t> epoch{0u};
+
+  std::atomic<uint64_t> num_hits{0u};
+  std::atomic<uint64_t> num_misses{0u};
+
+  inline Shard &ShardOf(RawEntityId id) noexcept {
+    // NOTE: The low bits of packed entity IDs encode the entity kind,
+    //       so mix the bits before picking a shard.
+    return shards[(id * 0x9e3779b97f4a7c15ull) >> (64u - kNumShardBits)];
+  }
+
+ public:
+  T Get(RawEntityId id, const std::function<T(void)> &compute) {
+    if (id == kInvalidEntityId) {
+      return compute();
+    }
+
+    // NOTE: The epoch comes from when the task doing this lookup captured
+    //       its entities, not from when the lookup began.
+    uint64_t lookup_epoch = TaskManager::ThreadEpoch();
+    if (lookup_epoch != epoch.load()) {
+      return compute();
+    }
+
+    // The epoch is checked again under the lock, as `Clear` may have run
+    // since, and the shard may now hold entries of the new index.
+    Shard &shard = ShardOf(id);
+    {
+      QMutexLocker locker(&(shard.lock));
+      auto it = shard.entries.find(id);
+      if (it != shard.entries.end() && epoch.load() == lookup_epoch) {
+        num_hits.fetch_add(1u, std::memory_order_relaxed);
+        return it->second;
+      }
+    }
+
+    // NOTE: `compute` may recursively use the cache, so we can't hold
+    //       the shard lock while calling it.
+    num_misses.fetch_add(1u, std::memory_order_relaxed);
+    T val = compute();
+
+    QMutexLocker locker(&(shard.lock));
+    if (epoch.load() == lookup_epoch) {
+      if (shard.entries.size() >= kMaxShardSize) {
+        shard.entries.clear();
+      }
+      shard.entries.emplace(id, val);
+    }
+    return val;
+  }
+
+  void Clear(void) {
+    epoch.store(TaskManager::CurrentEpoch());
+    for (Shard &shard : shards) {
+      QMutexLocker locker(&(shard.lock));
+      shard.entries.clear();
+    }
+  }
+
+  inline uint64_t NumHits(void) const noexcept {
+    return num_hits.load(std::memory_order_relaxed);
+  }
+
+  inline uint64_t NumMisses(void) const noexcept {
+    return num_misses.load(std::memory_order_relaxed);
+  }
+};
+
+static EntityIdCache<VariantEntity> &NamedEntityCache(void) {
+  static EntityIdCache<VariantEntity> cache;
+  return cache;
+}
+
+static EntityIdCache<VariantEntity> &NamedDeclCache(void) {
+  static EntityIdCache<VariantEntity> cache;
+  return cache;
 }
 
+}  // namespace
+
 void GenerateCopySubMenu(QMenu *menu, const QModelIndex &index) {
   // BUG: As the context menu is not always handled in the same
   // level in the component hierarchy, we can end up with a
@@ -125,7 +232,31 @@ void GenerateCopySubMenu(QMenu *menu, const QModelIndex &index) {
   }
 }
 
-VariantEntity NamedEntityContaining(const VariantEntity &entity) {
+// Return the memoized result of `NamedDeclContaining` for the entity whose ID
+// is `id`.
+VariantEntity MemoizedNamedDeclContaining(
+    RawEntityId id, const std::function<VariantEntity(void)> &compute) {
+  return NamedDeclCache().Get(id, compute);
+}
+
+// Return the hit and miss counts of the containing entity caches.
+ContainingEntityCacheStats GetContainingEntityCacheStats(void) {
+  ContainingEntityCacheStats stats;
+  stats.named_entity_hits = NamedEntityCache().NumHits();
+  stats.named_entity_misses = NamedEntityCache().NumMisses();
+  stats.named_decl_hits = NamedDeclCache().NumHits();
+  stats.named_decl_misses = NamedDeclCache().NumMisses();
+  return stats;
+}
+
+// Clear the containing entity caches.
+void ClearContainingEntityCaches(void) {
+  NamedEntityCache().Clear();
+  NamedDeclCache().Clear();
+}
+
+static VariantEntity NamedEntityContainingUncached(
+    const VariantEntity &entity) {
   if (std::holds_alternative<Decl>(entity)) {
 
     if (auto cd = NamedDeclContaining(std::get<Decl>(entity));
@@ -251,6 +382,12 @@ VariantEntity NamedEntityContaining(const VariantEntity &entity) {
   return NotAnEntity{};
 }
 
+VariantEntity NamedEntityContaining(const VariantEntity &entity) {
+  return NamedEntityCache().Get(
+      EntityId(entity).Pack(),
+      [&entity] (void) { return NamedEntityContainingUncached(entity); });
+}
+
 //! Return the optional nearest fragment token associated with this declaration.
 std::optional<Token> DeclFragmentToken(const Decl &decl) {
 
@@ -941,18 +1078,21 @@ VariantEntity NamedDeclContaining(const VariantEntity &ent) {
       [](const Decl &entity) { return NamedDeclContaining(entity); },
       [](const Stmt &entity) { return NamedDeclContaining(entity); },
       [](const Token &entity) { return NamedDeclContaining(entity); },
-      [](const Macro &entity) -> VariantEntity {
-        auto root = entity.root();
-        // NOTE(pag): `root` has to be a separate variable otherwise there are
-        //            lifetime issues with the generators.
-        auto tokens = root.generate_use_tokens();
-        for (Token tok : tokens) {
-          if (auto cont = NamedDeclContaining(tok);
-              !std::holds_alternative<NotAnEntity>(cont)) {
-            return cont;
-          }
-        }
-        return NotAnEntity{};
+      [](const Macro &entity) {
+        return MemoizedNamedDeclContaining(
+            entity.id().Pack(), [&entity] (void) -> VariantEntity {
+              auto root = entity.root();
+              // NOTE(pag): `root` has to be a separate variable otherwise
+              //            there are lifetime issues with the generators.
+              auto tokens = root.generate_use_tokens();
+              for (Token tok : tokens) {
+                if (auto cont = NamedDeclContaining(tok);
+                    !std::holds_alternative<NotAnEntity>(cont)) {
+                  return cont;
+                }
+              }
+              return NotAnEntity{};
+            });
       },
       [](const ir::Operation &op) {
         return NamedDeclContainingOperation(op);
@@ -1229,15 +1369,79 @@ struct BreadCrumbs {
   }
 };
 
-}  // namespace
+// Interns breadcrumbs strings. Sibling uses in the same statement, and uses in
+// similar statements, tend to have identical breadcrumbs, so this lets all of
+// their rows share one string.
+class BreadCrumbsPool {
+  static constexpr unsigned kNumShards = 16u;
+
+  // Upper bound on the number of strings in a shard. Emptying a full shard
+  // doesn't affect already interned strings, which are reference counted.
+  static constexpr qsizetype kMaxShardSize = 1 << 12;
+
+  struct Shard {
+    QMutex lock;
+    QSet<QString> strings;
+  };
+
+  Shard shards[kNumShards];
+
+ public:
+  QString Intern(QString str) {
+    Shard &shard = shards[qHash(str) % kNumShards];
+    QMutexLocker locker(&(shard.lock));
+    if (auto it = shard.strings.constFind(str);
+        it != shard.strings.constEnd()) {
+      return *it;
+    }
 
-// Create a breadcrumbs string of the token contexts.
-QString TokenBreadCrumbs(const Token &ent, bool run_length_encode) {
+    if (shard.strings.size() >= kMaxShardSize) {
+      shard.strings.clear();
+    }
+    shard.strings.insert(str);
+    return str;
+  }
+};
+
+static BreadCrumbsPool &InternedBreadCrumbs(void) {
+  static BreadCrumbsPool pool;
+  return pool;
+}
+
+// Breadcrumbs, keyed by the entity ID of the innermost token context. The
+// breadcrumbs of a token only depend on its context chain, so tokens with the
+// same innermost declaration or statement context share breadcrumbs.
+static EntityIdCache<QString> &BreadCrumbsCache(bool run_length_encode) {
+  static EntityIdCache<QString> caches[2];
+  return caches[run_length_encode ? 1 : 0];
+}
+
+// Return the ID under which the breadcrumbs of `context` are cached, or
+// `kInvalidEntityId` if they can't be cached.
+//
+// NOTE: A declaration or statement has one parent, so its ID identifies the
+//       whole context chain. A type is shared by every place that uses it,
+//       and so its context chains differ from use to use.
+static RawEntityId ContextEntityId(const TokenContext &context) {
+  if (auto cdecl = context.as_declaration()) {
+    return cdecl->id().Pack();
+
+  } else if (auto cstmt = context.as_statement()) {
+    return cstmt->id().Pack();
+
+  } else {
+    return kInvalidEntityId;
+  }
+}
+
+// Create a breadcrumbs string of `context` and its parent contexts.
+static QString ContextBreadCrumbs(std::optional<TokenContext> context,
+                                  bool run_length_encode) {
   auto i = -1;
 
   BreadCrumbs crumbs(run_length_encode);
 
-  for (auto context = ent.context(); context; context = context->parent()) {
+  for (; context; context = context->parent()) {
     ++i;
 
     if (auto cdecl = context->as_declaration()) {
@@ -1297,6 +1501,29 @@ QString TokenBreadCrumbs(const Token &ent, bool run_length_encode) {
   return crumbs.Release();
 }
 
+}  // namespace
+
+// Clear the breadcrumbs cache.
+void ClearBreadCrumbsCaches(void) {
+  BreadCrumbsCache(false).Clear();
+  BreadCrumbsCache(true).Clear();
+}
+
+// Create a breadcrumbs string of the token contexts.
+QString TokenBreadCrumbs(const Token &ent, bool run_length_encode) {
+  std::optional<TokenContext> context = ent.context();
+  if (!context) {
+    return {};
+  }
+
+  return BreadCrumbsCache(run_length_encode).Get(
+      ContextEntityId(context.value()),
+      [&context, run_length_encode] (void) {
+        return InternedBreadCrumbs().Intern(
+            ContextBreadCrumbs(std::move(context), run_length_encode));
+      });
+}
+
 QString EntityBreadCrumbs(const VariantEntity &ent, bool run_length_encode) {
 
   if (std::holds_alternative<Decl>(ent)) {
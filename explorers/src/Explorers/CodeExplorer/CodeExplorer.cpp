@@ -384,7 +384,7 @@ void CodeExplorer::OpenEntity(const VariantEntity &entity,
     }
   }
 
-  code_widget->ChangeScene(tt, d->scene_options);
+  code_widget->ChangeScene(tt, d->scene_options, id);
 
   connect(code_widget, &QObject::destroyed,
           this, [id = id, this] (void) {
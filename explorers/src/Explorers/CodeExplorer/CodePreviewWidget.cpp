@@ -12,7 +12,6 @@
 #include <QHeaderView>
 #include <QLabel>
 #include <QPushButton>
-#include <QThreadPool>
 #include <QToolBar>
 #include <QTreeView>
 #include <QVBoxLayout>
@@ -229,7 +228,8 @@ void CodePreviewWidget::DisplayEntity(
     }
 
     if (!reuse_token_tree) {
-      d->code->ChangeScene(tt, d->scene_options);
+      d->code->ChangeScene(tt, d->scene_options,
+                           EntityId(d->containing_entity).Pack());
     }
   }
 
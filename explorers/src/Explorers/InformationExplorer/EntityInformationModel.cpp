@@ -29,25 +29,25 @@ static constexpr int kBatchIntervalTime = 250;
 
 struct EntityInformationModel::PrivateData {
   FileLocationCache file_location_cache;
-  const AtomicU64Ptr version_number;
+  TaskGroup task_group;
   Node root;
   QTimer import_timer;
   QMap<QString, std::list<std::pair<uint64_t, IInfoGenerator::Item>>>
       insertion_queue;
 
   inline PrivateData(const FileLocationCache &file_location_cache_,
-                     AtomicU64Ptr version_number_)
+                     TaskGroup task_group_)
       : file_location_cache(file_location_cache_),
-        version_number(std::move(version_number_)) {}
+        task_group(std::move(task_group_)) {}
 };
 
 EntityInformationModel::~EntityInformationModel(void) {}
 
 EntityInformationModel::EntityInformationModel(
-    const FileLocationCache &file_location_cache, AtomicU64Ptr version_number,
+    const FileLocationCache &file_location_cache, TaskGroup task_group,
     QObject *parent)
     : IModel(parent),
-      d(new PrivateData(file_location_cache, std::move(version_number))) {
+      d(new PrivateData(file_location_cache, std::move(task_group))) {
 
   connect(&d->import_timer, &QTimer::timeout, this,
           &EntityInformationModel::ProcessData);
@@ -206,7 +206,7 @@ QVariant EntityInformationModel::data(
 
 void EntityInformationModel::AddData(
     uint64_t version_number, QVector<IInfoGenerator::Item> items) {
-  if (version_number != d->version_number->load()) {
+  if (d->task_group.IsCancelled(version_number)) {
     return;
   }
 
@@ -223,7 +223,7 @@ void EntityInformationModel::AddData(
 void EntityInformationModel::ProcessData(void) {
   size_t num_changes = 0u;
 
-  auto version_number = d->version_number->load();
+  auto version_number = d->task_group.Generation();
 
   Node *root_node = &(d->root);
 
@@ -457,7 +457,7 @@ void EntityInformationModel::OnIndexChanged(
 
 void EntityInformationModel::Clear(void) {
   emit beginResetModel();
-  d->version_number->fetch_add(1u);
+  d->task_group.Cancel();
   d->insertion_queue.clear();
   d->root.node_index.clear();
   d->root.nodes.clear();
@@ -62,7 +62,7 @@ class EntityInformationModel Q_DECL_FINAL : public IModel {
   virtual ~EntityInformationModel(void);
 
   EntityInformationModel(const FileLocationCache &cache,
-                         AtomicU64Ptr version_number,
+                         TaskGroup task_group,
                          QObject *parent = nullptr);
 
   QModelIndex index(
@@ -14,7 +14,7 @@ void EntityInformationRunnable::run(void) {
   QVector<IInfoGenerator::Item> items;
 
   for (auto item : generator->Items(generator, file_location_cache)) {
-    if (version_number->load() != captured_version_number) {
+    if (task_group.IsCancelled(captured_version_number)) {
       emit Finished();
       return;
     }
@@ -27,7 +27,7 @@ void EntityInformationRunnable::run(void) {
     }
   }
 
-  if (version_number->load() == captured_version_number) {
+  if (!task_group.IsCancelled(captured_version_number)) {
     emit NewGeneratedItems(captured_version_number, std::move(items));
   }
 
@@ -7,21 +7,17 @@
 #pragma once
 
 #include <multiplier/GUI/Interfaces/IInfoGenerator.h>
+#include <multiplier/GUI/Managers/TaskManager.h>
 
 #include <QVector>
 #include <QObject>
 #include <QRunnable>
 #include <QString>
 
-#include <atomic>
-
 namespace mx::gui {
 
 static constexpr size_t kMaxBatchSize = 250u;
 
-using AtomicU64 = std::atomic<uint64_t>;
-using AtomicU64Ptr = std::shared_ptr<AtomicU64>;
-
 class EntityInformationRunnable Q_DECL_FINAL : public QObject, public QRunnable {
   Q_OBJECT
 
@@ -33,7 +29,7 @@ class EntityInformationRunnable Q_DECL_FINAL : public QObject, public QRunnable
   const FileLocationCache file_location_cache;
 
   // Used to keep track of if fetching the information needs to still happen.
-  const AtomicU64Ptr version_number;
+  const TaskGroup task_group;
   const uint64_t captured_version_number;
 
  public:
@@ -42,11 +38,11 @@ class EntityInformationRunnable Q_DECL_FINAL : public QObject, public QRunnable
   inline explicit EntityInformationRunnable(
       IInfoGeneratorPtr generator_,
       FileLocationCache file_location_cache_,
-      AtomicU64Ptr version_number_)
+      TaskGroup task_group_)
       : generator(std::move(generator_)),
         file_location_cache(std::move(file_location_cache_)),
-        version_number(std::move(version_number_)),
-        captured_version_number(version_number->load()) {
+        task_group(std::move(task_group_)),
+        captured_version_number(task_group.Generation()) {
     setAutoDelete(true);        
   }
 
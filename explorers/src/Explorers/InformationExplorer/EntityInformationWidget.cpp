@@ -13,7 +13,6 @@
 #include <QHeaderView>
 #include <QLabel>
 #include <QPushButton>
-#include <QThreadPool>
 #include <QToolBar>
 #include <QTreeView>
 #include <QVBoxLayout>
@@ -34,6 +33,7 @@
 #include <multiplier/GUI/Managers/ActionManager.h>
 #include <multiplier/GUI/Managers/ConfigManager.h>
 #include <multiplier/GUI/Managers/MediaManager.h>
+#include <multiplier/GUI/Managers/TaskManager.h>
 #include <multiplier/GUI/Widgets/HistoryWidget.h>
 #include <multiplier/GUI/Widgets/SearchWidget.h>
 #include <multiplier/GUI/Widgets/TreeWidget.h>
@@ -70,11 +70,13 @@ bool ShouldAutoExpand(const QModelIndex &index) {
 
 struct EntityInformationWidget::PrivateData {
   
-  // Used kind of like a semaphore to signal to info-fetching runnables
-  // (executing in `thread_pool`) that they should stop early because their
-  // results are going to be ignored / now out-of-date w.r.t. the current
-  // entity being shown.
-  const AtomicU64Ptr version_number;
+  // Runs the info-fetching runnables.
+  TaskManager &task_manager;
+
+  // Used to signal to info-fetching runnables that they should stop early
+  // because their results are going to be ignored / now out-of-date w.r.t. the
+  // current entity being shown.
+  TaskGroup task_group;
 
   // Tree of entity info.
   TreeWidget * const tree;
@@ -105,9 +107,6 @@ struct EntityInformationWidget::PrivateData {
   // Used to search through info results.
   SearchWidget * const search;
 
-  // Thread pool on which the information fetching runnables run.
-  QThreadPool thread_pool;
-
   // Current entity being shown by this widget.
   VariantEntity current_entity;
 
@@ -129,11 +128,11 @@ struct EntityInformationWidget::PrivateData {
 
   inline PrivateData(const ConfigManager &config_manager, bool enable_history,
                      QWidget *parent)
-      : version_number(std::make_shared<AtomicU64>()),
+      : task_manager(config_manager.TaskManager()),
         tree(new TreeWidget(parent)),
         status(new QWidget(parent)),
         model(new EntityInformationModel(
-            config_manager.FileLocationCache(), version_number, tree)),
+            config_manager.FileLocationCache(), task_group, tree)),
         sort_model(new SortFilterProxyModel(tree)),
         toolbar(enable_history ? new QToolBar(parent) : nullptr),
         sort_order(new QToolButton(parent)),
@@ -148,7 +147,9 @@ struct EntityInformationWidget::PrivateData {
             "com.trailofbits.action.OpenPinnedEntityInfo")) {}
 };
 
-EntityInformationWidget::~EntityInformationWidget(void) {}
+EntityInformationWidget::~EntityInformationWidget(void) {
+  d->task_group.Cancel();
+}
 
 EntityInformationWidget::EntityInformationWidget(
     const ConfigManager &config_manager, bool enable_history,
@@ -487,7 +488,7 @@ void EntityInformationWidget::DisplayEntity(
 
       auto runnable = new EntityInformationRunnable(
           std::move(category_generator), file_location_cache,
-          d->version_number);
+          d->task_group);
 
       connect(runnable, &EntityInformationRunnable::NewGeneratedItems,
               d->model, &EntityInformationModel::AddData);
@@ -502,7 +503,7 @@ void EntityInformationWidget::DisplayEntity(
       }
 
       ++d->num_requests;
-      d->thread_pool.start(runnable);
+      d->task_manager.Start(runnable, TaskPriority::kVisible, d->task_group);
     }
   }
 
@@ -592,7 +593,7 @@ void EntityInformationWidget::OnAllDataFound(void) {
 
 void EntityInformationWidget::OnCancelRunningRequest(void) {
   d->status->setVisible(false);
-  d->version_number->fetch_add(1u);
+  d->task_group.Cancel();
 }
 
 void EntityInformationWidget::OnChangeSync(int state) {
@@ -6,7 +6,6 @@
 
 #include <multiplier/GUI/Explorers/InformationExplorer.h>
 
-#include <QThreadPool>
 #include <QClipboard>
 #include <QMenu>
 #include <QAction>
@@ -45,6 +45,18 @@ class IGeneratedItem {
   //
   // NOTE(pag): This must be non-blocking.
   virtual QVariant Data(int) const = 0;
+
+  // Returns `true` if the data of the given column is expensive to compute,
+  // and so should be computed by `DeferredData` when it's first needed, e.g.
+  // when the row is shown, sorted, or filtered, rather than by `Data` when the
+  // item is generated.
+  virtual bool IsDeferred(int) const;
+
+  // Column data for the tree item, for the columns where `IsDeferred` returns
+  // `true`. Models cache the results.
+  //
+  // NOTE: This can block, and is called on a background thread.
+  virtual QVariant DeferredData(int) const;
 };
 
 }  // namespace mx::gui
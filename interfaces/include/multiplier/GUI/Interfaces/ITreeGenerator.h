@@ -62,6 +62,11 @@ class ITreeGenerator : public std::enable_shared_from_this<ITreeGenerator> {
   //            tree generator (`self`) itself via aliasing `std::shared_ptr`.
   //
   // NOTE(pag): This is allowed to block.
+  //
+  // NOTE: A generator that can go a long time between items, e.g. because
+  //       it's searching, should yield `nullptr` every so often. This is a
+  //       checkpoint, where the caller checks for cancellation and sends out
+  //       any items yielded so far.
   virtual gap::generator<IGeneratedItemPtr> Roots(
       ITreeGeneratorPtr self) = 0;
 
@@ -73,6 +78,8 @@ class ITreeGenerator : public std::enable_shared_from_this<ITreeGenerator> {
   //            tree generator (`self`) itself via aliasing `std::shared_ptr`.
   //
   // NOTE(pag): This is allowed to block.
+  //
+  // NOTE: This can yield `nullptr` checkpoints like `Roots`.
   virtual gap::generator<IGeneratedItemPtr> Children(
       ITreeGeneratorPtr self, IGeneratedItemPtr parent_item) = 0;
 };
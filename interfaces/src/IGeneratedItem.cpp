@@ -18,4 +18,12 @@ VariantEntity IGeneratedItem::AliasedEntity(void) const {
   return NotAnEntity{};
 }
 
+bool IGeneratedItem::IsDeferred(int) const {
+  return false;
+}
+
+QVariant IGeneratedItem::DeferredData(int col) const {
+  return Data(col);
+}
+
 }  // namespace mx::gui
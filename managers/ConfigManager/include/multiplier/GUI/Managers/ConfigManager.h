@@ -23,6 +23,7 @@ namespace mx::gui {
 class ActionManager;
 class ConfigManagerImpl;
 class MediaManager;
+class TaskManager;
 class ThemeManager;
 class TriggerHandle;
 
@@ -46,11 +47,21 @@ class ConfigManager Q_DECL_FINAL : public QObject {
   //! Get access to the global media manager.
   class MediaManager &MediaManager(void) const noexcept;
 
+  //! Get access to the global task manager, on which all background work
+  //! should run.
+  class TaskManager &TaskManager(void) const noexcept;
+
   //! Get access to the current index.
   const class Index &Index(void) const noexcept;
 
-  //! Change the current index.
-  void SetIndex(const class Index &index) noexcept;
+  //! Change the current index. `database_path` is the path of the database
+  //! backing `index`, if any.
+  void SetIndex(const class Index &index,
+                const QString &database_path = QString()) noexcept;
+
+  //! Returns the path of the database backing the current index, or an empty
+  //! string if the index isn't backed by a database on disk.
+  const QString &DatabasePath(void) const noexcept;
 
   //! Return the shared file location cache. This is used to compute locations
   //! of things, taking into account the current configuration (tab width, and
@@ -11,7 +11,9 @@
 
 #include <multiplier/GUI/Managers/ActionManager.h>
 #include <multiplier/GUI/Managers/MediaManager.h>
+#include <multiplier/GUI/Managers/TaskManager.h>
 #include <multiplier/GUI/Managers/ThemeManager.h>
+#include <multiplier/GUI/Util.h>
 
 #include "ThemedItemDelegate.h"
 
@@ -24,10 +26,16 @@ class ConfigManagerImpl {
   class ActionManager action_manager;
   class FileLocationCache file_location_cache;
   class Index index;
+  QString database_path;
+
+  // NOTE: This is last so that it's destroyed first, i.e. running tasks
+  //       finish before anything else is torn down.
+  class TaskManager task_manager;
 
   inline ConfigManagerImpl(QApplication &application, QObject *self)
       : theme_manager(application, self),
-        media_manager(theme_manager, self) {}
+        media_manager(theme_manager, self),
+        task_manager(self) {}
 };
 
 ConfigManager::~ConfigManager(void) {}
@@ -50,18 +58,33 @@ class MediaManager &ConfigManager::MediaManager(void) const noexcept {
   return d->media_manager;
 }
 
+// Get access to the global task manager.
+class TaskManager &ConfigManager::TaskManager(void) const noexcept {
+  return d->task_manager;
+}
+
 //! Get access to the current index.
 const class Index &ConfigManager::Index(void) const noexcept {
   return d->index;
 }
 
 //! Change the current index.
-void ConfigManager::SetIndex(const class Index &index) noexcept {
+void ConfigManager::SetIndex(const class Index &index,
+                             const QString &database_path) noexcept {
   d->file_location_cache.clear();
+  gui::TaskManager::AdvanceEpoch();
+  ClearContainingEntityCaches();
+  ClearBreadCrumbsCaches();
   d->index = index;
+  d->database_path = database_path;
   emit IndexChanged(*this);
 }
 
+//! Returns the path of the database backing the current index.
+const QString &ConfigManager::DatabasePath(void) const noexcept {
+  return d->database_path;
+}
+
 // Return the shared file location cache.
 const class FileLocationCache &
 ConfigManager::FileLocationCache(void) const noexcept {
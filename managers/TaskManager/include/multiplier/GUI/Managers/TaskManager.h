@@ -0,0 +1,114 @@
+// Copyright (c) 2024-present, Trail of Bits, Inc.
+// All rights reserved.
+//
+// This source code is licensed in accordance with the terms specified in
+// the LICENSE file found in the root directory of this source tree.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <QObject>
+
+QT_BEGIN_NAMESPACE
+class QRunnable;
+QT_END_NAMESPACE
+
+namespace mx::gui {
+
+class TaskGroupImpl;
+class TaskManager;
+class TaskManagerImpl;
+
+//! Priority classes of background tasks. Queued tasks of a higher priority
+//! start before queued tasks of a lower priority.
+enum class TaskPriority : int {
+
+  //! Work whose results aren't on screen yet, e.g. expanding rows that are
+  //! scrolled out of view.
+  kBackground = 0,
+
+  //! Work whose results are on screen, e.g. listing entity information.
+  kVisible = 1,
+
+  //! Work that the user is actively waiting on, e.g. building the scene of a
+  //! code widget.
+  kInteractive = 2,
+};
+
+//! A cancellation group of tasks. Each owner of background tasks, e.g. a
+//! model, has one. Tasks capture the group's generation when they're created,
+//! and stop early once that generation is cancelled.
+//!
+//! NOTE: Copies of a group share their state, and tasks hold copies, so
+//!       a task can safely outlive the owner of its group.
+class TaskGroup {
+  friend class TaskManager;
+
+  std::shared_ptr<TaskGroupImpl> d;
+
+ public:
+  TaskGroup(void);
+
+  //! Returns the current generation of this group.
+  uint64_t Generation(void) const noexcept;
+
+  //! Returns `true` if `generation` is no longer the current generation.
+  bool IsCancelled(uint64_t generation) const noexcept;
+
+  //! Cancel all tasks of the current generation, and return the new
+  //! generation.
+  uint64_t Cancel(void) noexcept;
+
+  //! Returns the number of tasks of this group that have been started but
+  //! haven't yet finished.
+  int NumPending(void) const noexcept;
+
+  //! Block until all started tasks of this group have finished.
+  void WaitForDone(void) const;
+};
+
+//! Runs the background tasks of all widgets and models on one process-wide
+//! pool of threads, so that having many views open doesn't oversubscribe the
+//! cores.
+class TaskManager Q_DECL_FINAL : public QObject {
+  Q_OBJECT
+
+  std::unique_ptr<TaskManagerImpl> d;
+
+ public:
+  virtual ~TaskManager(void);
+
+  explicit TaskManager(QObject *parent = nullptr);
+
+  //! Start `runnable` as a member of `group`. If `runnable` auto-deletes, then
+  //! it is deleted once it finishes.
+  void Start(QRunnable *runnable, TaskPriority priority,
+             const TaskGroup &group);
+
+  //! Returns the maximum number of tasks that can run concurrently. This is
+  //! the number of hardware threads.
+  int MaxThreadCount(void) const noexcept;
+
+  //! Returns the number of tasks that are running right now.
+  int NumActiveThreads(void) const noexcept;
+
+  //! Block until all started tasks, of all groups, have finished.
+  void WaitForDone(void) const;
+
+  //! Start a new epoch, e.g. because the index changed. Tasks that are
+  //! started from now on belong to the new epoch.
+  static void AdvanceEpoch(void);
+
+  //! Returns the current epoch.
+  static uint64_t CurrentEpoch(void);
+
+  //! Returns the epoch of the data used on this thread. In a task, this is
+  //! the epoch in which the task was started, i.e. in which it captured its
+  //! data, even if the epoch has since advanced. Outside of a task, this is
+  //! the current epoch.
+  static uint64_t ThreadEpoch(void);
+};
+
+}  // namespace mx::gui
@@ -0,0 +1,151 @@
+// Copyright (c) 2024-present, Trail of Bits, Inc.
+// All rights reserved.
+//
+// This source code is licensed in accordance with the terms specified in
+// the LICENSE file found in the root directory of this source tree.
+
+#include <multiplier/GUI/Managers/TaskManager.h>
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <atomic>
+#include <optional>
+
+namespace mx::gui {
+
+// Advanced whenever the data that tasks capture, e.g. the index, changes.
+static std::atomic<uint64_t> gEpoch{0u};
+
+// The epoch in which the task running on this thread was started, if any.
+static thread_local std::optional<uint64_t> gThreadEpoch;
+
+class TaskGroupImpl {
+ public:
+  std::atomic<uint64_t> generation{0u};
+
+  // Number of started tasks that haven't finished. Guarded by `lock`, so that
+  // `WaitForDone` doesn't miss a wakeup.
+  int num_pending{0};
+  QMutex lock;
+  QWaitCondition all_done;
+
+  void Started(void) {
+    QMutexLocker locker(&lock);
+    ++num_pending;
+  }
+
+  void Finished(void) {
+    QMutexLocker locker(&lock);
+    if (!--num_pending) {
+      all_done.wakeAll();
+    }
+  }
+};
+
+class TaskManagerImpl {
+ public:
+  QThreadPool thread_pool;
+
+  inline TaskManagerImpl(void) {
+    thread_pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount()));
+  }
+};
+
+TaskGroup::TaskGroup(void)
+    : d(std::make_shared<TaskGroupImpl>()) {}
+
+// Returns the current generation of this group.
+uint64_t TaskGroup::Generation(void) const noexcept {
+  return d->generation.load();
+}
+
+// Returns `true` if `generation` is no longer the current generation.
+bool TaskGroup::IsCancelled(uint64_t generation) const noexcept {
+  return d->generation.load() != generation;
+}
+
+// Cancel all tasks of the current generation, and return the new generation.
+uint64_t TaskGroup::Cancel(void) noexcept {
+  return d->generation.fetch_add(1u) + 1u;
+}
+
+// Returns the number of tasks of this group that have been started but
+// haven't yet finished.
+int TaskGroup::NumPending(void) const noexcept {
+  QMutexLocker locker(&(d->lock));
+  return d->num_pending;
+}
+
+// Block until all started tasks of this group have finished.
+void TaskGroup::WaitForDone(void) const {
+  QMutexLocker locker(&(d->lock));
+  while (d->num_pending) {
+    d->all_done.wait(&(d->lock));
+  }
+}
+
+TaskManager::~TaskManager(void) {}
+
+TaskManager::TaskManager(QObject *parent)
+    : QObject(parent),
+      d(new TaskManagerImpl) {}
+
+// Start `runnable` as a member of `group`.
+void TaskManager::Start(QRunnable *runnable, TaskPriority priority,
+                        const TaskGroup &group) {
+  std::shared_ptr<TaskGroupImpl> group_impl = group.d;
+  group_impl->Started();
+
+  // NOTE: We wrap `runnable` so that we can tell its group when it's
+  //       done. This means we're responsible for auto-deleting it.
+  d->thread_pool.start(
+      [runnable, group_impl = std::move(group_impl),
+       epoch = gEpoch.load()] (void) {
+        gThreadEpoch = epoch;
+        runnable->run();
+        gThreadEpoch.reset();
+        if (runnable->autoDelete()) {
+          delete runnable;
+        }
+        group_impl->Finished();
+      },
+      static_cast<int>(priority));
+}
+
+// Returns the maximum number of tasks that can run concurrently.
+int TaskManager::MaxThreadCount(void) const noexcept {
+  return d->thread_pool.maxThreadCount();
+}
+
+// Returns the number of tasks that are running right now.
+int TaskManager::NumActiveThreads(void) const noexcept {
+  return d->thread_pool.activeThreadCount();
+}
+
+// Block until all started tasks, of all groups, have finished.
+void TaskManager::WaitForDone(void) const {
+  d->thread_pool.waitForDone();
+}
+
+// Start a new epoch.
+void TaskManager::AdvanceEpoch(void) {
+  gEpoch.fetch_add(1u);
+}
+
+// Returns the current epoch.
+uint64_t TaskManager::CurrentEpoch(void) {
+  return gEpoch.load();
+}
+
+// Returns the epoch of the data used on this thread.
+uint64_t TaskManager::ThreadEpoch(void) {
+  return gThreadEpoch.value_or(gEpoch.load());
+}
+
+}  // namespace mx::gui
@@ -32,6 +32,9 @@ class CallHierarchyPlugin Q_DECL_FINAL : public IReferenceExplorerPlugin {
   std::optional<NamedAction> ActOnKeyPress(
       IWindowManager *manager, const QKeySequence &keys,
       const QModelIndex &index) Q_DECL_FINAL;
+
+ private slots:
+  void OnIndexChanged(const ConfigManager &config_manager);
 };
 
 }  // namespace mx::gui
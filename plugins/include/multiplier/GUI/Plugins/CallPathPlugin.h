@@ -0,0 +1,37 @@
+// Copyright (c) 2024-present, Trail of Bits, Inc.
+// All rights reserved.
+//
+// This source code is licensed in accordance with the terms specified in
+// the LICENSE file found in the root directory of this source tree.
+
+#pragma once
+
+#include <multiplier/GUI/Interfaces/IReferenceExplorerPlugin.h>
+
+#include <memory>
+
+namespace mx::gui {
+
+// Implements the call path plugin, which finds call paths from one function
+// to another, and shows them in the reference explorer.
+class CallPathPlugin Q_DECL_FINAL : public IReferenceExplorerPlugin {
+  Q_OBJECT
+
+  struct PrivateData;
+  std::unique_ptr<PrivateData> d;
+
+  void SetSource(const QVariant &data);
+
+ public:
+  virtual ~CallPathPlugin(void);
+
+  CallPathPlugin(ConfigManager &config_manager, QObject *parent = nullptr);
+
+  std::vector<NamedAction> ActOnSecondaryClickEx(
+      IWindowManager *manager, const QModelIndex &index) Q_DECL_FINAL;
+
+ private slots:
+  void OnIndexChanged(const ConfigManager &config_manager);
+};
+
+}  // namespace mx::gui
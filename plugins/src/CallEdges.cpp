@@ -0,0 +1,103 @@
+// Copyright (c) 2024-present, Trail of Bits, Inc.
+// All rights reserved.
+//
+// This source code is licensed in accordance with the terms specified in
+// the LICENSE file found in the root directory of this source tree.
+
+#include "CallEdges.h"
+
+#include <multiplier/AST/CallExpr.h>
+#include <multiplier/GUI/Util.h>
+
+#include <unordered_set>
+
+namespace mx::gui {
+namespace {
+
+static bool IsCall(const Reference &ref) {
+  auto brk = ref.builtin_reference_kind();
+  return brk && brk.value() == BuiltinReferenceKind::CALLS;
+}
+
+}  // namespace
+
+// Returns the ID of the canonical declaration of `entity`, or of `entity`
+// itself if it isn't a declaration.
+RawEntityId CanonicalId(const VariantEntity &entity) {
+  if (std::holds_alternative<Decl>(entity)) {
+    return std::get<Decl>(entity).canonical_declaration().id().Pack();
+  }
+  return EntityId(entity).Pack();
+}
+
+// Returns the definition of `func`, if any.
+std::optional<FunctionDecl> DefinitionOf(const FunctionDecl &func) {
+  for (Decl redecl : func.redeclarations()) {
+    if (redecl.is_definition()) {
+      return FunctionDecl::from(redecl);
+    }
+  }
+  return std::nullopt;
+}
+
+// Generate the calls made by the body of `caller`.
+gap::generator<CallEdge> CalleesOf(FunctionDecl caller) {
+  auto def = DefinitionOf(caller);
+  if (!def) {
+    co_return;
+  }
+
+  FunctionDecl canon_caller = caller.canonical_declaration();
+
+  // NOTE: A fragment can contain more than one function, e.g. the methods
+  //       of a class, so we only keep the calls contained in `caller`. See
+  //       the TODO about `::in(entity)` in `BuiltinEntityInformationPlugin`.
+  RawEntityId caller_id = canon_caller.id().Pack();
+  for (CallExpr call : CallExpr::in(Fragment::containing(def.value()))) {
+    if (CanonicalId(NamedEntityContaining(call)) != caller_id) {
+      continue;
+    }
+
+    // Indirect calls can have many possible callees; only mention each
+    // callee once per call site.
+    std::unordered_set<RawEntityId> seen_callees;
+    for (Reference ref : Reference::from(call)) {
+      if (!IsCall(ref)) {
+        continue;
+      }
+
+      auto callee = FunctionDecl::from(ref.as_variant());
+      if (!callee) {
+        continue;
+      }
+
+      FunctionDecl canon_callee = callee->canonical_declaration();
+      if (!seen_callees.insert(canon_callee.id().Pack()).second) {
+        continue;
+      }
+
+      co_yield CallEdge{call, canon_caller, std::move(canon_callee)};
+    }
+  }
+}
+
+// Generate the calls of `callee`.
+gap::generator<CallEdge> CallersOf(FunctionDecl callee) {
+  FunctionDecl canon_callee = callee.canonical_declaration();
+  for (Reference ref : Reference::to(canon_callee)) {
+    if (!IsCall(ref)) {
+      continue;
+    }
+
+    VariantEntity call = ref.as_variant();
+    auto caller = FunctionDecl::from(NamedEntityContaining(call));
+    if (!caller) {
+      continue;
+    }
+
+    co_yield CallEdge{std::move(call), caller->canonical_declaration(),
+                      canon_callee};
+  }
+}
+
+}  // namespace mx::gui
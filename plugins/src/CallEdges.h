@@ -0,0 +1,41 @@
+// Copyright (c) 2024-present, Trail of Bits, Inc.
+// All rights reserved.
+//
+// This source code is licensed in accordance with the terms specified in
+// the LICENSE file found in the root directory of this source tree.
+
+#pragma once
+
+#include <gap/coro/generator.hpp>
+#include <multiplier/AST/FunctionDecl.h>
+#include <multiplier/Index.h>
+
+namespace mx::gui {
+
+//! A direct or indirect call from one function to another.
+struct CallEdge {
+  //! The call, e.g. a `CallExpr`.
+  VariantEntity call_site;
+
+  //! The canonical declaration of the function containing `call_site`.
+  FunctionDecl caller;
+
+  //! The canonical declaration of the called function.
+  FunctionDecl callee;
+};
+
+//! Returns the ID of the canonical declaration of `entity`, or of `entity`
+//! itself if it isn't a declaration.
+RawEntityId CanonicalId(const VariantEntity &entity);
+
+//! Returns the definition of `func`, if any.
+std::optional<FunctionDecl> DefinitionOf(const FunctionDecl &func);
+
+//! Generate the calls made by the body of `caller`, in the order of their
+//! call sites. Each callee of an indirect call is generated at most once.
+gap::generator<CallEdge> CalleesOf(FunctionDecl caller);
+
+//! Generate the calls of `callee`.
+gap::generator<CallEdge> CallersOf(FunctionDecl callee);
+
+}  // namespace mx::gui
@@ -0,0 +1,288 @@
+// Copyright (c) 2024-present, Trail of Bits, Inc.
+// All rights reserved.
+//
+// This source code is licensed in accordance with the terms specified in
+// the LICENSE file found in the root directory of this source tree.
+
+#include "CallGraphIndex.h"
+
+#include <multiplier/AST/Decl.h>
+#include <multiplier/AST/Stmt.h>
+#include <multiplier/Frontend/File.h>
+#include <multiplier/Frontend/Macro.h>
+#include <multiplier/GUI/Util.h>
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <limits>
+#include <tuple>
+#include <unordered_set>
+
+namespace mx::gui {
+namespace {
+
+static constexpr quint32 kMagic = 0x4d584347u;  // `MXCG`.
+static constexpr quint32 kFormatVersion = 2u;
+
+// Where the index of the database at `database_path` is saved.
+static QString IndexPath(const QString &database_path) {
+  return database_path + ".callgraph";
+}
+
+// The identity of the database at `database_path`. If the database changes,
+// then so does its identity, which invalidates any saved index.
+static std::pair<qint64, qint64> DatabaseIdentity(
+    const QString &database_path) {
+  QFileInfo info(database_path);
+  return {info.size(), info.lastModified().toMSecsSinceEpoch()};
+}
+
+struct Triple {
+  RawEntityId key;
+  RawEntityId use;
+  RawEntityId user;
+
+  inline bool operator<(const Triple &that) const noexcept {
+    return std::tie(key, use, user) < std::tie(that.key, that.use, that.user);
+  }
+
+  inline bool operator==(const Triple &that) const noexcept {
+    return key == that.key && use == that.use && user == that.user;
+  }
+};
+
+}  // namespace
+
+// Returns the key under which `entity` is indexed.
+RawEntityId CallGraphIndex::KeyOf(const VariantEntity &entity) {
+  if (std::holds_alternative<Decl>(entity)) {
+    return std::get<Decl>(entity).canonical_declaration().id().Pack();
+  }
+  return EntityId(entity).Pack();
+}
+
+// Returns the users of the entity whose key is `key`.
+CallGraphIndex::EdgeRange CallGraphIndex::UsersOf(RawEntityId key) const {
+  auto it = std::lower_bound(keys.begin(), keys.end(), key);
+  if (it == keys.end() || *it != key) {
+    return EdgeRange(nullptr, nullptr);
+  }
+
+  auto i = static_cast<size_t>(it - keys.begin());
+  return EdgeRange(edges.data() + offsets[i], edges.data() + offsets[i + 1u]);
+}
+
+// Build the index of all references in `index`.
+CallGraphIndexPtr CallGraphIndex::Build(
+    const Index &index, const std::function<bool(void)> &is_cancelled) {
+
+  std::vector<Triple> triples;
+
+  // Record the references from `use` to other entities. This mirrors what
+  // `CallHierarchyGenerator::Children` computes for the referenced entities.
+  auto add_uses = [&] (VariantEntity use) {
+    RawEntityId use_id = EntityId(use).Pack();
+    std::optional<RawEntityId> containing_id;
+
+    for (Reference ref : Reference::from(use)) {
+      if (auto bk = ref.builtin_reference_kind()) {
+        if (bk.value() == BuiltinReferenceKind::CONTAINS) {
+          continue;
+        }
+
+        // The use is its own user. Like any other user, a declaration is
+        // canonicalized, so that all redeclarations show up as one user.
+        if (bk.value() == BuiltinReferenceKind::USES_TYPE) {
+          triples.push_back({KeyOf(ref.as_variant()), use_id, KeyOf(use)});
+          continue;
+        }
+      }
+
+      // Computing the containing entity is the expensive part, so do it at
+      // most once per use.
+      if (!containing_id) {
+        containing_id = KeyOf(NamedEntityContaining(use));
+      }
+
+      triples.push_back({KeyOf(ref.as_variant()), use_id,
+                         containing_id.value()});
+    }
+  };
+
+  std::unordered_set<RawEntityId> seen_files;
+  for (const auto &[path, file_id] : index.file_paths()) {
+    std::optional<File> file = index.file(file_id);
+    if (!file || !seen_files.insert(file->id().Pack()).second) {
+      continue;
+    }
+
+    for (Fragment frag : file->fragments()) {
+      if (is_cancelled()) {
+        return {};
+      }
+
+      for (Decl decl : Decl::in(frag)) {
+        add_uses(std::move(decl));
+      }
+
+      for (Stmt stmt : Stmt::in(frag)) {
+        add_uses(std::move(stmt));
+      }
+
+      for (Macro macro : Macro::in(frag)) {
+        add_uses(std::move(macro));
+      }
+    }
+  }
+
+  std::sort(triples.begin(), triples.end());
+  triples.erase(std::unique(triples.begin(), triples.end()), triples.end());
+
+  if (triples.size() > std::numeric_limits<uint32_t>::max()) {
+    return {};
+  }
+
+  auto call_graph = std::make_shared<CallGraphIndex>();
+  call_graph->edges.reserve(triples.size());
+  for (const Triple &triple : triples) {
+    if (call_graph->keys.empty() || call_graph->keys.back() != triple.key) {
+      call_graph->keys.push_back(triple.key);
+      call_graph->offsets.push_back(
+          static_cast<uint32_t>(call_graph->edges.size()));
+    }
+    call_graph->edges.push_back({triple.use, triple.user});
+  }
+  call_graph->offsets.push_back(
+      static_cast<uint32_t>(call_graph->edges.size()));
+
+  return call_graph;
+}
+
+// Load the index that was saved for the database at `database_path`.
+CallGraphIndexPtr CallGraphIndex::Load(const QString &database_path) {
+  QFile file(IndexPath(database_path));
+  if (!file.open(QIODevice::ReadOnly)) {
+    return {};
+  }
+
+  QDataStream stream(&file);
+  quint32 magic = 0u;
+  quint32 format_version = 0u;
+  qint64 size = 0;
+  qint64 last_modified = 0;
+  quint64 num_keys = 0u;
+  quint64 num_edges = 0u;
+  stream >> magic >> format_version >> size >> last_modified >> num_keys
+         >> num_edges;
+
+  if (stream.status() != QDataStream::Ok || magic != kMagic ||
+      format_version != kFormatVersion ||
+      std::make_pair(size, last_modified) != DatabaseIdentity(database_path) ||
+      num_edges > std::numeric_limits<uint32_t>::max() ||
+      num_keys > num_edges) {
+    return {};
+  }
+
+  // Make sure that the file actually has as many keys, offsets, and edges as
+  // the header claims before allocating space for them. Neither count exceeds
+  // `uint32_t`, so this can't overflow.
+  auto needed_bytes = num_keys * sizeof(RawEntityId) +
+                      (num_keys + 1u) * sizeof(uint32_t) +
+                      num_edges * sizeof(Edge);
+  auto remaining_bytes = file.size() - file.pos();
+  if (remaining_bytes < 0 ||
+      needed_bytes > static_cast<quint64>(remaining_bytes)) {
+    return {};
+  }
+
+  auto call_graph = std::make_shared<CallGraphIndex>();
+  call_graph->keys.resize(num_keys);
+  call_graph->offsets.resize(num_keys + 1u);
+  call_graph->edges.resize(num_edges);
+
+  auto read = [&stream] (auto &vec) {
+    auto num_bytes = static_cast<qint64>(vec.size() * sizeof(vec[0]));
+    return !num_bytes || stream.readRawData(
+        reinterpret_cast<char *>(vec.data()), num_bytes) == num_bytes;
+  };
+
+  if (!read(call_graph->keys) || !read(call_graph->offsets) ||
+      !read(call_graph->edges)) {
+    return {};
+  }
+
+  // Sanity check the offsets, so that `UsersOf` stays in bounds even if the
+  // file is corrupt.
+  uint32_t prev_offset = 0u;
+  for (uint32_t offset : call_graph->offsets) {
+    if (offset < prev_offset || offset > num_edges) {
+      return {};
+    }
+    prev_offset = offset;
+  }
+
+  if (call_graph->offsets.back() != num_edges) {
+    return {};
+  }
+
+  return call_graph;
+}
+
+// Save this index next to the database at `database_path`.
+bool CallGraphIndex::Save(const QString &database_path) const {
+  QSaveFile file(IndexPath(database_path));
+  if (!file.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+
+  auto [size, last_modified] = DatabaseIdentity(database_path);
+
+  QDataStream stream(&file);
+  stream << kMagic << kFormatVersion << size << last_modified
+         << static_cast<quint64>(keys.size())
+         << static_cast<quint64>(edges.size());
+
+  auto write = [&stream] (const auto &vec) {
+    auto num_bytes = static_cast<qint64>(vec.size() * sizeof(vec[0]));
+    return !num_bytes || stream.writeRawData(
+        reinterpret_cast<const char *>(vec.data()), num_bytes) == num_bytes;
+  };
+
+  if (!write(keys) || !write(offsets) || !write(edges)) {
+    file.cancelWriting();
+    return false;
+  }
+
+  return file.commit();
+}
+
+CallGraphIndexRunnable::~CallGraphIndexRunnable(void) {}
+
+void CallGraphIndexRunnable::run(void) {
+  auto is_cancelled = [this] (void) {
+    return task_group.IsCancelled(captured_version_number);
+  };
+
+  CallGraphIndexPtr call_graph;
+  if (!database_path.isEmpty()) {
+    call_graph = CallGraphIndex::Load(database_path);
+  }
+
+  if (!call_graph) {
+    call_graph = CallGraphIndex::Build(index, is_cancelled);
+    if (call_graph && !database_path.isEmpty()) {
+      call_graph->Save(database_path);
+    }
+  }
+
+  if (call_graph && !is_cancelled()) {
+    emit IndexReady(captured_version_number, std::move(call_graph));
+  }
+}
+
+}  // namespace mx::gui
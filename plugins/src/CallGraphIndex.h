@@ -0,0 +1,123 @@
+// Copyright (c) 2024-present, Trail of Bits, Inc.
+// All rights reserved.
+//
+// This source code is licensed in accordance with the terms specified in
+// the LICENSE file found in the root directory of this source tree.
+
+#pragma once
+
+#include <multiplier/Index.h>
+#include <multiplier/GUI/Managers/TaskManager.h>
+
+#include <QObject>
+#include <QRunnable>
+#include <QString>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace mx::gui {
+
+class CallGraphIndex;
+
+using CallGraphIndexPtr = std::shared_ptr<const CallGraphIndex>;
+
+//! A whole-program reverse reference graph. This maps the ID of each
+//! referenced entity (the canonical declaration, for declarations) to the
+//! entities that use it, and the named entities containing those uses. This
+//! is what `Reference::to` followed by `NamedEntityContaining` would compute,
+//! but without any database queries.
+class CallGraphIndex {
+ public:
+  struct Edge {
+    //! The entity using the referenced entity, e.g. a `CallExpr`.
+    RawEntityId use;
+
+    //! The named entity containing `use`, e.g. the calling function.
+    RawEntityId user;
+  };
+
+  //! The edges of one referenced entity, sorted by `use`.
+  class EdgeRange {
+    const Edge *begin_edge;
+    const Edge *end_edge;
+
+   public:
+    inline EdgeRange(const Edge *begin_, const Edge *end_)
+        : begin_edge(begin_),
+          end_edge(end_) {}
+
+    inline const Edge *begin(void) const noexcept {
+      return begin_edge;
+    }
+
+    inline const Edge *end(void) const noexcept {
+      return end_edge;
+    }
+
+    inline bool empty(void) const noexcept {
+      return begin_edge == end_edge;
+    }
+  };
+
+ private:
+  // Sorted IDs of the referenced entities.
+  std::vector<RawEntityId> keys;
+
+  // `edges[offsets[i]]` through `edges[offsets[i + 1u]]` are the edges of
+  // `keys[i]`.
+  std::vector<uint32_t> offsets;
+  std::vector<Edge> edges;
+
+ public:
+  //! Build the index of all references in `index`. Returns `nullptr` if
+  //! `is_cancelled` returns `true` before the index is built.
+  static CallGraphIndexPtr Build(const Index &index,
+                                 const std::function<bool(void)> &is_cancelled);
+
+  //! Load the index that was saved for the database at `database_path`.
+  //! Returns `nullptr` if there is no saved index, or if the database has
+  //! changed since the index was saved.
+  static CallGraphIndexPtr Load(const QString &database_path);
+
+  //! Save this index next to the database at `database_path`. Returns `false`
+  //! if the index can't be written, e.g. because the directory is read-only.
+  bool Save(const QString &database_path) const;
+
+  //! Returns the key under which `entity` is indexed.
+  static RawEntityId KeyOf(const VariantEntity &entity);
+
+  //! Returns the users of the entity whose key is `key`.
+  EdgeRange UsersOf(RawEntityId key) const;
+};
+
+//! Loads, or builds and then saves, the call graph index of a database.
+class CallGraphIndexRunnable Q_DECL_FINAL : public QObject, public QRunnable {
+  Q_OBJECT
+
+  const Index index;
+  const QString database_path;
+  const TaskGroup task_group;
+  const uint64_t captured_version_number;
+
+  void run(void) Q_DECL_FINAL;
+
+ public:
+  virtual ~CallGraphIndexRunnable(void);
+
+  inline explicit CallGraphIndexRunnable(Index index_,
+                                         QString database_path_,
+                                         TaskGroup task_group_)
+      : index(std::move(index_)),
+        database_path(std::move(database_path_)),
+        task_group(std::move(task_group_)),
+        captured_version_number(task_group.Generation()) {
+    setAutoDelete(true);
+  }
+
+ signals:
+  void IndexReady(uint64_t version_number, CallGraphIndexPtr call_graph);
+};
+
+}  // namespace mx::gui
@@ -11,12 +11,15 @@
 #include <multiplier/GUI/Interfaces/ITreeGenerator.h>
 #include <multiplier/GUI/Managers/ActionManager.h>
 #include <multiplier/GUI/Managers/ConfigManager.h>
+#include <multiplier/GUI/Managers/TaskManager.h>
 #include <multiplier/GUI/Util.h>
 #include <multiplier/Frontend/DefineMacroDirective.h>
 #include <multiplier/Frontend/MacroParameter.h>
 #include <multiplier/Frontend/File.h>
 #include <multiplier/Index.h>
 
+#include "CallGraphIndex.h"
+
 Q_DECLARE_METATYPE(mx::TokenRange);
 
 namespace mx::gui {
@@ -31,26 +34,23 @@ static QString ActionName(const VariantEntity &) {
   return QObject::tr("Open Call Hierarchy");
 }
 
+// NOTE: All columns are deferred, as most items are never shown, and
+//       computing breadcrumbs walks the whole context of the user.
 class CallHierarchyItem final : public IGeneratedItem {
 
+  const FileLocationCache file_location_cache;
   VariantEntity user_entity;
   VariantEntity used_entity;
-  TokenRange name_tokens;
-  QString location;
-  QString breadcrumbs;
 
  public:
   virtual ~CallHierarchyItem(void) = default;
 
-  inline CallHierarchyItem(VariantEntity user_entity_,
-                           VariantEntity used_entity_,
-                           TokenRange name_tokens_, QString location_,
-                           QString breadcrumbs_)
-      : user_entity(std::move(user_entity_)),
-        used_entity(used_entity_),
-        name_tokens(std::move(name_tokens_)),
-        location(std::move(location_)),
-        breadcrumbs(std::move(breadcrumbs_)) {}
+  inline CallHierarchyItem(const FileLocationCache &file_location_cache_,
+                           VariantEntity user_entity_,
+                           VariantEntity used_entity_)
+      : file_location_cache(file_location_cache_),
+        user_entity(std::move(user_entity_)),
+        used_entity(std::move(used_entity_)) {}
 
   VariantEntity Entity(void) const Q_DECL_FINAL {
     return user_entity;
@@ -60,12 +60,22 @@ class CallHierarchyItem final : public IGeneratedItem {
     return used_entity;
   }
 
-  QVariant Data(int col) const Q_DECL_FINAL {
+  QVariant Data(int) const Q_DECL_FINAL {
+    return {};
+  }
+
+  bool IsDeferred(int col) const Q_DECL_FINAL {
+    return 0 <= col && col <= 2;
+  }
+
+  QVariant DeferredData(int col) const Q_DECL_FINAL {
     QVariant data;
     switch (col) {
-      case 0: data.setValue(name_tokens); break;
-      case 1: data.setValue(breadcrumbs); break;
-      case 2: data.setValue(location); break;
+      case 0: data.setValue(NameOfEntity(used_entity)); break;
+      case 1: data.setValue(EntityBreadCrumbs(user_entity)); break;
+      case 2:
+        data.setValue(LocationOfEntity(file_location_cache, user_entity));
+        break;
       default: break;
     }
     return data;
@@ -76,9 +86,7 @@ static IGeneratedItemPtr CreateGeneratedItem(
     const FileLocationCache &file_location_cache,
     const VariantEntity &user, const VariantEntity &used) {
 
-  return std::make_shared<CallHierarchyItem>(
-      user, used, NameOfEntity(used),
-      LocationOfEntity(file_location_cache, user), EntityBreadCrumbs(user));
+  return std::make_shared<CallHierarchyItem>(file_location_cache, user, used);
 }
 
 class CallHierarchyGenerator final : public ITreeGenerator {
@@ -86,15 +94,23 @@ class CallHierarchyGenerator final : public ITreeGenerator {
   const VariantEntity root_entity;
   const unsigned initialize_expansion_depth;
 
+  // If present, then children are found in the call graph index rather than
+  // by querying `index`.
+  const Index index;
+  const CallGraphIndexPtr call_graph;
+
  public:
   virtual ~CallHierarchyGenerator(void) = default;
 
   inline CallHierarchyGenerator(FileLocationCache file_location_cache_,
                                 VariantEntity root_entity_,
+                                Index index_, CallGraphIndexPtr call_graph_,
                                 unsigned initialize_expansion_depth_=2u)
       : file_location_cache(std::move(file_location_cache_)),
         root_entity(std::move(root_entity_)),
-        initialize_expansion_depth(initialize_expansion_depth_) {}
+        initialize_expansion_depth(initialize_expansion_depth_),
+        index(std::move(index_)),
+        call_graph(std::move(call_graph_)) {}
 
   unsigned InitialExpansionDepth(void) const Q_DECL_FINAL;
 
@@ -183,6 +199,19 @@ gap::generator<IGeneratedItemPtr> CallHierarchyGenerator::Children(
     co_return;
   }
 
+  if (call_graph) {
+    auto key = CallGraphIndex::KeyOf(containing_entity);
+    for (const CallGraphIndex::Edge &edge : call_graph->UsersOf(key)) {
+      VariantEntity user = NotAnEntity{};
+      if (edge.user != kInvalidEntityId) {
+        user = index.entity(EntityId(edge.user));
+      }
+      co_yield CreateGeneratedItem(
+          file_location_cache, index.entity(EntityId(edge.use)), user);
+    }
+    co_return;
+  }
+
   for (Reference ref : Reference::to(containing_entity)) {
     auto use = ref.as_variant();
     auto user = NamedEntityContaining(use);
@@ -217,18 +246,68 @@ struct CallHierarchyPlugin::PrivateData {
 
   TriggerHandle open_reference_explorer_trigger;
 
+  // Call graph index of the current index, if it's been built. This is
+  // shared with the generators, which keep using it even if a new index
+  // replaces it.
+  CallGraphIndexPtr call_graph;
+
+  // Cancels the building of the call graph index when the index changes.
+  TaskGroup task_group;
+
+  inline std::shared_ptr<CallHierarchyGenerator> CreateGenerator(
+      VariantEntity entity, unsigned initialize_expansion_depth=2u) const {
+    return std::make_shared<CallHierarchyGenerator>(
+        config_manager.FileLocationCache(), std::move(entity),
+        config_manager.Index(), call_graph, initialize_expansion_depth);
+  }
+
   inline PrivateData(const ConfigManager &config_manager_)
       : config_manager(config_manager_),
         open_reference_explorer_trigger(config_manager.ActionManager().Find(
             "com.trailofbits.action.OpenReferenceExplorer")) {}
 };
 
-CallHierarchyPlugin::~CallHierarchyPlugin(void) {}
+CallHierarchyPlugin::~CallHierarchyPlugin(void) {
+  d->task_group.Cancel();
+}
 
 CallHierarchyPlugin::CallHierarchyPlugin(
     ConfigManager &config_manager, QObject *parent)
     : IReferenceExplorerPlugin(config_manager, parent),
-      d(new PrivateData(config_manager)) {}
+      d(new PrivateData(config_manager)) {
+
+  connect(&config_manager, &ConfigManager::IndexChanged,
+          this, &CallHierarchyPlugin::OnIndexChanged);
+
+  OnIndexChanged(config_manager);
+}
+
+// Load or build the call graph index of the new index in the background.
+// Until it's ready, generators fall back on querying the index directly.
+void CallHierarchyPlugin::OnIndexChanged(const ConfigManager &config_manager) {
+  auto version_number = d->task_group.Cancel();
+  d->call_graph.reset();
+
+  // Indexes that aren't backed by a database on disk are assumed to be small,
+  // and so aren't worth indexing.
+  if (config_manager.DatabasePath().isEmpty()) {
+    return;
+  }
+
+  auto runnable = new CallGraphIndexRunnable(
+      config_manager.Index(), config_manager.DatabasePath(), d->task_group);
+
+  connect(runnable, &CallGraphIndexRunnable::IndexReady, this,
+          [=, this] (uint64_t ready_version_number,
+                     CallGraphIndexPtr call_graph) {
+            if (ready_version_number == version_number) {
+              d->call_graph = std::move(call_graph);
+            }
+          });
+
+  config_manager.TaskManager().Start(
+      runnable, TaskPriority::kBackground, d->task_group);
+}
 
 std::optional<NamedAction> CallHierarchyPlugin::ActOnSecondaryClick(
     IWindowManager *, const QModelIndex &index) {
@@ -245,8 +324,7 @@ std::optional<NamedAction> CallHierarchyPlugin::ActOnSecondaryClick(
     .name = ActionName(entity),
     .action = d->open_reference_explorer_trigger,
     .data = QVariant::fromValue<ITreeGeneratorPtr>(
-        std::make_shared<CallHierarchyGenerator>(
-            d->config_manager.FileLocationCache(), std::move(entity)))
+        d->CreateGenerator(std::move(entity)))
   };
 }
 
@@ -288,8 +366,8 @@ std::optional<NamedAction> CallHierarchyPlugin::ActOnKeyPress(
     .name = action_name,
     .action = d->open_reference_explorer_trigger,
     .data = QVariant::fromValue<ITreeGeneratorPtr>(
-        std::make_shared<CallHierarchyGenerator>(
-            d->config_manager.FileLocationCache(), std::move(entity),
+        d->CreateGenerator(
+            std::move(entity),
             depth + 1u  /* logical depth 1 is physcal depth 1,
                          * i.e. 1 under a root */))
   };
@@ -0,0 +1,292 @@
+// Copyright (c) 2024-present, Trail of Bits, Inc.
+// All rights reserved.
+//
+// This source code is licensed in accordance with the terms specified in
+// the LICENSE file found in the root directory of this source tree.
+
+#include <multiplier/GUI/Plugins/CallPathPlugin.h>
+
+#include <multiplier/AST/FunctionDecl.h>
+#include <multiplier/GUI/Interfaces/IModel.h>
+#include <multiplier/GUI/Interfaces/ITreeGenerator.h>
+#include <multiplier/GUI/Managers/ActionManager.h>
+#include <multiplier/GUI/Managers/ConfigManager.h>
+#include <multiplier/GUI/Util.h>
+#include <multiplier/Index.h>
+
+#include <utility>
+#include <vector>
+
+#include "CallEdges.h"
+#include "CallPathSearch.h"
+
+Q_DECLARE_METATYPE(mx::TokenRange);
+
+namespace mx::gui {
+namespace {
+
+// The calls between functions in an index.
+struct EntityCallGraph {
+  using Node = FunctionDecl;
+  using CallSite = VariantEntity;
+  using Id = RawEntityId;
+
+  static RawEntityId IdOf(const FunctionDecl &func) {
+    return func.id().Pack();
+  }
+
+  static RawEntityId IdOf(const VariantEntity &call_site) {
+    return EntityId(call_site).Pack();
+  }
+
+  static gap::generator<CallEdge> Callees(FunctionDecl func) {
+    return CalleesOf(std::move(func));
+  }
+
+  static gap::generator<CallEdge> Callers(FunctionDecl func) {
+    return CallersOf(std::move(func));
+  }
+};
+
+using CallPathStep = BasicCallPathStep<EntityCallGraph>;
+using CallPathPtr = BasicCallPathPtr<EntityCallGraph>;
+
+// A row of the call path finder. The first row of a path stands for the
+// whole path, and its children are the calls along the path.
+class CallPathItem final : public IGeneratedItem {
+  const FileLocationCache file_location_cache;
+
+ public:
+  const CallPathPtr path;
+  const size_t step;
+
+  virtual ~CallPathItem(void) = default;
+
+  inline CallPathItem(const FileLocationCache &file_location_cache_,
+                      CallPathPtr path_, size_t step_)
+      : file_location_cache(file_location_cache_),
+        path(std::move(path_)),
+        step(step_) {}
+
+  VariantEntity Entity(void) const Q_DECL_FINAL {
+    const CallPathStep &path_step = path->at(step);
+    if (!step) {
+      return path_step.function;
+    }
+    return path_step.call_site;
+  }
+
+  VariantEntity AliasedEntity(void) const Q_DECL_FINAL {
+    return path->at(step).function;
+  }
+
+  QVariant Data(int col) const Q_DECL_FINAL {
+    if (step || col != 1) {
+      return {};
+    }
+    return QObject::tr("Path of %n call(s)", nullptr,
+                       static_cast<int>(path->size() - 1u));
+  }
+
+  bool IsDeferred(int col) const Q_DECL_FINAL {
+    return !col || (step && col == 1);
+  }
+
+  QVariant DeferredData(int col) const Q_DECL_FINAL {
+    const CallPathStep &path_step = path->at(step);
+    QVariant data;
+    switch (col) {
+      case 0: data.setValue(NameOfEntity(path_step.function)); break;
+      case 1:
+        data.setValue(LocationOfEntity(file_location_cache,
+                                       path_step.call_site));
+        break;
+      default: break;
+    }
+    return data;
+  }
+};
+
+class CallPathGenerator final : public ITreeGenerator {
+  const FileLocationCache file_location_cache;
+  const FunctionDecl source;
+  const FunctionDecl target;
+
+ public:
+  virtual ~CallPathGenerator(void) = default;
+
+  inline CallPathGenerator(FileLocationCache file_location_cache_,
+                           FunctionDecl source_, FunctionDecl target_)
+      : file_location_cache(std::move(file_location_cache_)),
+        source(source_.canonical_declaration()),
+        target(target_.canonical_declaration()) {}
+
+  bool EnableDeduplication(void) const Q_DECL_FINAL;
+
+  int NumColumns(void) const Q_DECL_FINAL;
+
+  int SortColumn(void) const Q_DECL_FINAL;
+
+  QString ColumnTitle(int) const Q_DECL_FINAL;
+
+  QString Name(const ITreeGeneratorPtr &self) const Q_DECL_FINAL;
+
+  gap::generator<IGeneratedItemPtr> Roots(
+      ITreeGeneratorPtr self) Q_DECL_FINAL;
+
+  gap::generator<IGeneratedItemPtr> Children(
+      ITreeGeneratorPtr self, IGeneratedItemPtr parent_item) Q_DECL_FINAL;
+};
+
+// Paths share functions, and the same function can appear at different steps
+// of different paths, so deduplicating them would hide steps.
+bool CallPathGenerator::EnableDeduplication(void) const {
+  return false;
+}
+
+int CallPathGenerator::NumColumns(void) const {
+  return 2;
+}
+
+int CallPathGenerator::SortColumn(void) const {
+  return -1;  // Keep the paths in the order found, i.e. shortest first.
+}
+
+QString CallPathGenerator::ColumnTitle(int col) const {
+  switch (col) {
+    case 0: return QObject::tr("Function");
+    case 1: return QObject::tr("Call Site");
+    default: return QString();
+  }
+}
+
+QString CallPathGenerator::Name(const ITreeGeneratorPtr &) const {
+  auto source_name = NameOfEntityAsString(source).value_or(
+      QString::number(source.id().Pack()));
+  auto target_name = NameOfEntityAsString(target).value_or(
+      QString::number(target.id().Pack()));
+  return QObject::tr("Call paths from `%1` to `%2`").arg(source_name)
+                                                     .arg(target_name);
+}
+
+// Generate a row for each path from `source` to `target`.
+//
+// NOTE: This runs on the tree's initialization thread, so the search's
+//       `nullptr` checkpoints are passed along, and a cancelled search
+//       stops promptly.
+gap::generator<IGeneratedItemPtr> CallPathGenerator::Roots(
+    ITreeGeneratorPtr self) {
+
+  for (CallPathPtr path : FindCallPaths(EntityCallGraph{}, source, target)) {
+    if (!path) {
+      co_yield nullptr;  // Checkpoint.
+    } else {
+      co_yield std::make_shared<CallPathItem>(
+          file_location_cache, std::move(path), 0u);
+    }
+  }
+}
+
+gap::generator<IGeneratedItemPtr> CallPathGenerator::Children(
+    ITreeGeneratorPtr self, IGeneratedItemPtr parent_item) {
+
+  auto item = std::dynamic_pointer_cast<const CallPathItem>(parent_item);
+  Q_ASSERT(item != nullptr);
+
+  // Only the first row of a path has children.
+  if (item->step) {
+    co_return;
+  }
+
+  for (size_t step = 1u, num_steps = item->path->size(); step < num_steps;
+       ++step) {
+    co_yield std::make_shared<CallPathItem>(
+        file_location_cache, item->path, step);
+  }
+}
+
+}  // namespace
+
+struct CallPathPlugin::PrivateData {
+  const ConfigManager &config_manager;
+
+  TriggerHandle open_reference_explorer_trigger;
+  TriggerHandle set_source_trigger;
+
+  // The function from which paths are found. This is chosen by the user
+  // before they choose the function to which paths are found.
+  std::optional<FunctionDecl> source;
+
+  inline PrivateData(const ConfigManager &config_manager_)
+      : config_manager(config_manager_),
+        open_reference_explorer_trigger(config_manager.ActionManager().Find(
+            "com.trailofbits.action.OpenReferenceExplorer")) {}
+};
+
+CallPathPlugin::~CallPathPlugin(void) {}
+
+CallPathPlugin::CallPathPlugin(
+    ConfigManager &config_manager, QObject *parent)
+    : IReferenceExplorerPlugin(config_manager, parent),
+      d(new PrivateData(config_manager)) {
+
+  d->set_source_trigger = config_manager.ActionManager().Register(
+      this, "com.trailofbits.action.SetCallPathSource",
+      &CallPathPlugin::SetSource);
+
+  connect(&config_manager, &ConfigManager::IndexChanged,
+          this, &CallPathPlugin::OnIndexChanged);
+}
+
+// The source function belongs to the old index.
+void CallPathPlugin::OnIndexChanged(const ConfigManager &) {
+  d->source.reset();
+}
+
+void CallPathPlugin::SetSource(const QVariant &data) {
+  if (!data.canConvert<VariantEntity>()) {
+    return;
+  }
+
+  if (auto func = FunctionDecl::from(data.value<VariantEntity>())) {
+    d->source = func->canonical_declaration();
+  }
+}
+
+std::vector<NamedAction> CallPathPlugin::ActOnSecondaryClickEx(
+    IWindowManager *, const QModelIndex &index) {
+
+  std::vector<NamedAction> actions;
+
+  // Call paths go between functions.
+  VariantEntity entity = IModel::EntitySkipThroughTokens(index);
+  auto func = FunctionDecl::from(entity);
+  if (!func) {
+    return actions;
+  }
+
+  FunctionDecl canon_func = func->canonical_declaration();
+  if (d->source && d->source->id().Pack() != canon_func.id().Pack()) {
+    auto source_name = NameOfEntityAsString(d->source.value()).value_or(
+        QString::number(d->source->id().Pack()));
+
+    actions.emplace_back(NamedAction{
+      .name = tr("Find Call Paths from `%1`").arg(source_name),
+      .action = d->open_reference_explorer_trigger,
+      .data = QVariant::fromValue<ITreeGeneratorPtr>(
+          std::make_shared<CallPathGenerator>(
+              d->config_manager.FileLocationCache(), d->source.value(),
+              canon_func))
+    });
+  }
+
+  actions.emplace_back(NamedAction{
+    .name = tr("Set as Call Path Source"),
+    .action = d->set_source_trigger,
+    .data = QVariant::fromValue<VariantEntity>(std::move(canon_func))
+  });
+
+  return actions;
+}
+
+}  // namespace mx::gui
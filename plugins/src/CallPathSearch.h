@@ -0,0 +1,228 @@
+// Copyright (c) 2024-present, Trail of Bits, Inc.
+// All rights reserved.
+//
+// This source code is licensed in accordance with the terms specified in
+// the LICENSE file found in the root directory of this source tree.
+
+#pragma once
+
+#include <gap/coro/generator.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace mx::gui {
+
+//! Upper bound on the number of calls in a path.
+static constexpr unsigned kMaxCallPathLength = 12u;
+
+//! Upper bound on the number of functions in each frontier of the search.
+//! Without this, reaching a function like `malloc` or a logging function would
+//! make the next frontier cover most of the program.
+static constexpr size_t kMaxCallPathFrontierSize = 4096u;
+
+//! Upper bound on the number of paths found by one search.
+static constexpr size_t kMaxNumCallPaths = 256u;
+
+//! One step of a call path through a `Graph`.
+template <typename Graph>
+struct BasicCallPathStep {
+  //! The call of `function`, or a default-constructed call site for the first
+  //! step of a path.
+  typename Graph::CallSite call_site;
+  typename Graph::Node function;
+};
+
+template <typename Graph>
+using BasicCallPath = std::vector<BasicCallPathStep<Graph>>;
+
+template <typename Graph>
+using BasicCallPathPtr = std::shared_ptr<const BasicCallPath<Graph>>;
+
+namespace detail {
+
+// How one side of the search reached a function.
+template <typename Graph>
+struct CallPathVisit {
+  // ID of the function one step closer to where this side of the search
+  // started, or nothing for the function where it started.
+  std::optional<typename Graph::Id> next_id;
+
+  // The call between `function` and the function of `next_id`.
+  typename Graph::CallSite call_site;
+
+  typename Graph::Node function;
+};
+
+template <typename Graph>
+using CallPathVisitMap =
+    std::unordered_map<typename Graph::Id, CallPathVisit<Graph>>;
+
+// Create the path that goes from the start of the search to the function of
+// `caller_id`, then through `call_site` to the function of `callee_id`, and
+// then on to the end of the search. Returns `nullptr` if the path visits a
+// function more than once.
+template <typename Graph>
+BasicCallPathPtr<Graph> CreateCallPath(
+    const CallPathVisitMap<Graph> &forward,
+    const CallPathVisitMap<Graph> &backward, typename Graph::Id caller_id,
+    typename Graph::CallSite call_site, typename Graph::Id callee_id) {
+
+  auto path = std::make_shared<BasicCallPath<Graph>>();
+  std::unordered_set<typename Graph::Id> seen_ids;
+
+  // The forward side of the search links from the meeting point back to
+  // the start, so collect that half in reverse.
+  for (std::optional<typename Graph::Id> id = caller_id; id; ) {
+    const CallPathVisit<Graph> &visit = forward.at(id.value());
+    if (!seen_ids.insert(id.value()).second) {
+      return {};
+    }
+    path->emplace_back(
+        BasicCallPathStep<Graph>{visit.call_site, visit.function});
+    id = visit.next_id;
+  }
+
+  std::reverse(path->begin(), path->end());
+
+  for (std::optional<typename Graph::Id> id = callee_id; id; ) {
+    const CallPathVisit<Graph> &visit = backward.at(id.value());
+    if (!seen_ids.insert(id.value()).second) {
+      return {};
+    }
+    path->emplace_back(
+        BasicCallPathStep<Graph>{std::move(call_site), visit.function});
+    call_site = visit.call_site;
+    id = visit.next_id;
+  }
+
+  return path;
+}
+
+}  // namespace detail
+
+//! Search `graph` for paths from `source` to `target` by going forward, over
+//! callees, from `source`, and backward, over callers, from `target`, one
+//! level at a time. Each level expands whichever side has the smaller
+//! frontier, and a path is found whenever a call connects the two sides.
+//! Paths are generated shortest first, and each path is generated once.
+//!
+//! A `Graph` provides:
+//!
+//!   - The `Node`, `CallSite`, and `Id` types. An `Id` is hashable and
+//!     ordered.
+//!
+//!   - `IdOf(node)` and `IdOf(call_site)`, which return the `Id`s of nodes
+//!     and call sites.
+//!
+//!   - `Callees(node)` and `Callers(node)`, which return ranges of edges. An
+//!     edge has `caller`, `call_site`, and `callee` members.
+//!
+//! NOTE: This yields `nullptr` checkpoints, so that callers can stop a
+//!       cancelled search promptly, and can show paths as soon as they're
+//!       found.
+template <typename Graph>
+gap::generator<BasicCallPathPtr<Graph>> FindCallPaths(
+    Graph graph, typename Graph::Node source, typename Graph::Node target) {
+
+  using Id = typename Graph::Id;
+  using VisitMap = detail::CallPathVisitMap<Graph>;
+
+  Id source_id = graph.IdOf(source);
+  Id target_id = graph.IdOf(target);
+  if (source_id == target_id) {
+    co_return;
+  }
+
+  VisitMap forward;
+  VisitMap backward;
+  forward.emplace(source_id, detail::CallPathVisit<Graph>{
+      std::nullopt, typename Graph::CallSite{}, std::move(source)});
+  backward.emplace(target_id, detail::CallPathVisit<Graph>{
+      std::nullopt, typename Graph::CallSite{}, std::move(target)});
+
+  std::vector<Id> forward_frontier{source_id};
+  std::vector<Id> backward_frontier{target_id};
+  std::vector<Id> next_frontier;
+  unsigned forward_depth = 0u;
+  unsigned backward_depth = 0u;
+
+  // The two sides can meet at any call along a path. E.g. once the forward
+  // side reaches the target through a chain of calls, the backward side will
+  // meet it again at each earlier call of that chain. Identify each path by
+  // its sequence of functions and calls, so that it's only found once.
+  std::set<std::vector<Id>> seen_paths;
+  std::vector<Id> path_key;
+  size_t num_paths = 0u;
+
+  while (!forward_frontier.empty() && !backward_frontier.empty() &&
+         (forward_depth + backward_depth) < kMaxCallPathLength &&
+         num_paths < kMaxNumCallPaths) {
+
+    const bool is_forward =
+        forward_frontier.size() <= backward_frontier.size();
+    VisitMap &visits = is_forward ? forward : backward;
+    const VisitMap &other_visits = is_forward ? backward : forward;
+    std::vector<Id> &frontier =
+        is_forward ? forward_frontier : backward_frontier;
+    unsigned &depth = is_forward ? forward_depth : backward_depth;
+
+    next_frontier.clear();
+    for (Id id : frontier) {
+      auto func = visits.at(id).function;
+      auto edges = is_forward ? graph.Callees(std::move(func)) :
+                                graph.Callers(std::move(func));
+
+      for (auto edge : edges) {
+        Id caller_id = graph.IdOf(edge.caller);
+        Id callee_id = graph.IdOf(edge.callee);
+        Id found_id = is_forward ? callee_id : caller_id;
+
+        if (other_visits.count(found_id) && num_paths < kMaxNumCallPaths) {
+          auto path = detail::CreateCallPath<Graph>(
+              forward, backward, caller_id, edge.call_site, callee_id);
+
+          if (path) {
+            path_key.clear();
+            for (const BasicCallPathStep<Graph> &step : *path) {
+              path_key.push_back(graph.IdOf(step.function));
+              if (&step != &path->front()) {
+                path_key.push_back(graph.IdOf(step.call_site));
+              }
+            }
+
+            if (seen_paths.insert(path_key).second) {
+              ++num_paths;
+              co_yield std::move(path);
+            }
+          }
+        }
+
+        if (next_frontier.size() >= kMaxCallPathFrontierSize) {
+          continue;
+        }
+
+        auto found = is_forward ? std::move(edge.callee) :
+                                  std::move(edge.caller);
+        if (visits.emplace(found_id, detail::CallPathVisit<Graph>{
+                id, std::move(edge.call_site), std::move(found)}).second) {
+          next_frontier.push_back(found_id);
+        }
+      }
+
+      co_yield nullptr;  // Checkpoint.
+    }
+
+    frontier.swap(next_frontier);
+    ++depth;
+  }
+}
+
+}  // namespace mx::gui
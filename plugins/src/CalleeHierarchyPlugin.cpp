@@ -0,0 +1,207 @@
+// Copyright (c) 2024-present, Trail of Bits, Inc.
+// All rights reserved.
+//
+// This source code is licensed in accordance with the terms specified in
+// the LICENSE file found in the root directory of this source tree.
+
+#include <multiplier/GUI/Plugins/CalleeHierarchyPlugin.h>
+
+#include <multiplier/AST/FunctionDecl.h>
+#include <multiplier/GUI/Interfaces/IModel.h>
+#include <multiplier/GUI/Interfaces/ITreeGenerator.h>
+#include <multiplier/GUI/Managers/ActionManager.h>
+#include <multiplier/GUI/Managers/ConfigManager.h>
+#include <multiplier/GUI/Util.h>
+#include <multiplier/Index.h>
+
+#include "CallEdges.h"
+
+Q_DECLARE_METATYPE(mx::TokenRange);
+
+namespace mx::gui {
+namespace {
+
+static const QKeySequence kKeySeqShiftX("Shift+X");
+
+static QString ActionName(const VariantEntity &) {
+  return QObject::tr("Open Callee Hierarchy");
+}
+
+// A row of the callee hierarchy. The entity of a row is the call site, and
+// its aliased entity is the called function. This lets the same function be
+// called from many call sites, while the `TreeGeneratorModel` only expands
+// the first of them.
+class CalleeHierarchyItem final : public IGeneratedItem {
+  const FileLocationCache file_location_cache;
+  VariantEntity call_site;
+  FunctionDecl callee;
+
+ public:
+  virtual ~CalleeHierarchyItem(void) = default;
+
+  inline CalleeHierarchyItem(const FileLocationCache &file_location_cache_,
+                             VariantEntity call_site_, FunctionDecl callee_)
+      : file_location_cache(file_location_cache_),
+        call_site(std::move(call_site_)),
+        callee(std::move(callee_)) {}
+
+  VariantEntity Entity(void) const Q_DECL_FINAL {
+    return call_site;
+  }
+
+  VariantEntity AliasedEntity(void) const Q_DECL_FINAL {
+    return callee;
+  }
+
+  QVariant Data(int) const Q_DECL_FINAL {
+    return {};
+  }
+
+  bool IsDeferred(int col) const Q_DECL_FINAL {
+    return 0 <= col && col <= 1;
+  }
+
+  QVariant DeferredData(int col) const Q_DECL_FINAL {
+    QVariant data;
+    switch (col) {
+      case 0: data.setValue(NameOfEntity(callee)); break;
+      case 1:
+        data.setValue(LocationOfEntity(file_location_cache, call_site));
+        break;
+      default: break;
+    }
+    return data;
+  }
+};
+
+class CalleeHierarchyGenerator final : public ITreeGenerator {
+  const FileLocationCache file_location_cache;
+  const FunctionDecl root_entity;
+
+ public:
+  virtual ~CalleeHierarchyGenerator(void) = default;
+
+  inline CalleeHierarchyGenerator(FileLocationCache file_location_cache_,
+                                  FunctionDecl root_entity_)
+      : file_location_cache(std::move(file_location_cache_)),
+        root_entity(root_entity_.canonical_declaration()) {}
+
+  int NumColumns(void) const Q_DECL_FINAL;
+
+  int SortColumn(void) const Q_DECL_FINAL;
+
+  QString ColumnTitle(int) const Q_DECL_FINAL;
+
+  QString Name(const ITreeGeneratorPtr &self) const Q_DECL_FINAL;
+
+  gap::generator<IGeneratedItemPtr> Roots(
+      ITreeGeneratorPtr self) Q_DECL_FINAL;
+
+  gap::generator<IGeneratedItemPtr> Children(
+      ITreeGeneratorPtr self, IGeneratedItemPtr parent_item) Q_DECL_FINAL;
+};
+
+int CalleeHierarchyGenerator::NumColumns(void) const {
+  return 2;
+}
+
+int CalleeHierarchyGenerator::SortColumn(void) const {
+  return -1;  // Keep the callees in the order of their call sites.
+}
+
+QString CalleeHierarchyGenerator::ColumnTitle(int col) const {
+  switch (col) {
+    case 0: return QObject::tr("Callee");
+    case 1: return QObject::tr("Call Site");
+    default: return QString();
+  }
+}
+
+QString CalleeHierarchyGenerator::Name(
+    const ITreeGeneratorPtr &) const {
+  auto name = NameOfEntityAsString(root_entity);
+  if (name) {
+    return QObject::tr("Callee hierarchy of `%1`").arg(name.value());
+  } else {
+    return QObject::tr("Callee hierarchy of entity %1").arg(
+        root_entity.id().Pack());
+  }
+}
+
+gap::generator<IGeneratedItemPtr> CalleeHierarchyGenerator::Roots(
+    ITreeGeneratorPtr self) {
+  co_yield std::make_shared<CalleeHierarchyItem>(
+      file_location_cache, root_entity, root_entity);
+}
+
+gap::generator<IGeneratedItemPtr> CalleeHierarchyGenerator::Children(
+    ITreeGeneratorPtr self, IGeneratedItemPtr parent_item) {
+
+  auto caller = FunctionDecl::from(parent_item->AliasedEntity());
+  if (!caller) {
+    co_return;
+  }
+
+  // Indirect calls can have many possible callees; these are grouped under
+  // the same call site.
+  for (CallEdge edge : CalleesOf(std::move(caller.value()))) {
+    co_yield std::make_shared<CalleeHierarchyItem>(
+        file_location_cache, std::move(edge.call_site),
+        std::move(edge.callee));
+  }
+}
+
+}  // namespace
+
+struct CalleeHierarchyPlugin::PrivateData {
+  const ConfigManager &config_manager;
+
+  TriggerHandle open_reference_explorer_trigger;
+
+  inline PrivateData(const ConfigManager &config_manager_)
+      : config_manager(config_manager_),
+        open_reference_explorer_trigger(config_manager.ActionManager().Find(
+            "com.trailofbits.action.OpenReferenceExplorer")) {}
+};
+
+CalleeHierarchyPlugin::~CalleeHierarchyPlugin(void) {}
+
+CalleeHierarchyPlugin::CalleeHierarchyPlugin(
+    ConfigManager &config_manager, QObject *parent)
+    : IReferenceExplorerPlugin(config_manager, parent),
+      d(new PrivateData(config_manager)) {}
+
+std::optional<NamedAction> CalleeHierarchyPlugin::ActOnSecondaryClick(
+    IWindowManager *, const QModelIndex &index) {
+
+  VariantEntity entity = IModel::EntitySkipThroughTokens(index);
+
+  // It's only reasonable to ask for the callees of functions.
+  auto func = FunctionDecl::from(entity);
+  if (!func) {
+    return std::nullopt;
+  }
+
+  return NamedAction{
+    .name = ActionName(entity),
+    .action = d->open_reference_explorer_trigger,
+    .data = QVariant::fromValue<ITreeGeneratorPtr>(
+        std::make_shared<CalleeHierarchyGenerator>(
+            d->config_manager.FileLocationCache(),
+            std::move(func.value())))
+  };
+}
+
+// Allow a main window plugin to act on a key sequence.
+std::optional<NamedAction> CalleeHierarchyPlugin::ActOnKeyPress(
+    IWindowManager *manager, const QKeySequence &keys,
+    const QModelIndex &index) {
+
+  if (keys != kKeySeqShiftX) {
+    return std::nullopt;
+  }
+
+  return ActOnSecondaryClick(manager, index);
+}
+
+}  // namespace mx::gui
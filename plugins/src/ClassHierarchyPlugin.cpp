@@ -26,18 +26,16 @@ static QString ActionName(const VariantEntity &) {
 }
 
 class ClassHierarchyItem final : public IGeneratedItem {
+  const FileLocationCache file_location_cache;
   CXXRecordDecl entity;
-  TokenRange name_tokens;
-  QString location;
 
  public:
   virtual ~ClassHierarchyItem(void) = default;
 
-  inline ClassHierarchyItem(CXXRecordDecl entity_, TokenRange name_tokens_,
-                            QString location_)
-      : entity(std::move(entity_)),
-        name_tokens(std::move(name_tokens_)),
-        location(std::move(location_)) {}
+  inline ClassHierarchyItem(const FileLocationCache &file_location_cache_,
+                            CXXRecordDecl entity_)
+      : file_location_cache(file_location_cache_),
+        entity(std::move(entity_)) {}
 
   VariantEntity Entity(void) const Q_DECL_FINAL {
     return entity;
@@ -47,11 +45,21 @@ class ClassHierarchyItem final : public IGeneratedItem {
     return entity;
   }
 
-  QVariant Data(int col) const Q_DECL_FINAL {
+  QVariant Data(int) const Q_DECL_FINAL {
+    return {};
+  }
+
+  bool IsDeferred(int col) const Q_DECL_FINAL {
+    return 0 <= col && col <= 1;
+  }
+
+  QVariant DeferredData(int col) const Q_DECL_FINAL {
     QVariant data;
     switch (col) {
-      case 0: data.setValue(name_tokens); break;
-      case 1: data.setValue(location); break;
+      case 0: data.setValue(NameOfEntity(entity)); break;
+      case 1:
+        data.setValue(LocationOfEntity(file_location_cache, entity));
+        break;
       default: break;
     }
     return data;
@@ -61,10 +69,8 @@ class ClassHierarchyItem final : public IGeneratedItem {
 static IGeneratedItemPtr CreateGeneratedItem(
     const FileLocationCache &file_location_cache,
     const CXXRecordDecl class_) {
-  auto name = NameOfEntity(class_);
-  auto loc = LocationOfEntity(file_location_cache, class_);
   return std::make_shared<ClassHierarchyItem>(
-      std::move(class_), std::move(name), std::move(loc));
+      file_location_cache, std::move(class_));
 }
 
 class ClassHierarchyGenerator final : public ITreeGenerator {
@@ -37,15 +37,18 @@ static QString ActionName(const VariantEntity &) {
   return QObject::tr("Open Struct Explorer");
 }
 
+static TokenRange BitsToTokenRange(uint64_t num_bits);
+
+// NOTE: The offset, size, and type columns are deferred, as each one
+//       builds a new token range.
 class StructExplorerItem final : public IGeneratedItem {
   VariantEntity entity;
   VariantEntity aliased_entity;
   TokenRange name_tokens;
   TokenRange type_tokens;
-  std::optional<TokenRange> offset_tokens;
-  std::optional<TokenRange> cumulative_offset_tokens;
-  std::optional<TokenRange> size_tokens;
+  std::optional<uint64_t> offset_bits;
   std::optional<uint64_t> cumulative_offset_bits;
+  std::optional<uint64_t> size_bits;
 
  public:
   virtual ~StructExplorerItem(void) = default;
@@ -54,18 +57,16 @@ class StructExplorerItem final : public IGeneratedItem {
                             VariantEntity aliased_entity_,
                             TokenRange name_tokens_,
                             TokenRange type_tokens_,
-                            std::optional<TokenRange> offset_tokens_,
-                            std::optional<TokenRange> cumulative_offset_tokens_,
-                            std::optional<TokenRange> size_tokens_,
-                            std::optional<uint64_t> cumulative_offset_bits_)
+                            std::optional<uint64_t> offset_bits_,
+                            std::optional<uint64_t> cumulative_offset_bits_,
+                            std::optional<uint64_t> size_bits_)
       : entity(std::move(entity_)),
         aliased_entity(std::move(aliased_entity_)),
         name_tokens(std::move(name_tokens_)),
         type_tokens(std::move(type_tokens_)),
-        offset_tokens(std::move(offset_tokens_)),
-        cumulative_offset_tokens(std::move(cumulative_offset_tokens_)),
-        size_tokens(std::move(size_tokens_)),
-        cumulative_offset_bits(std::move(cumulative_offset_bits_)) {}
+        offset_bits(std::move(offset_bits_)),
+        cumulative_offset_bits(std::move(cumulative_offset_bits_)),
+        size_bits(std::move(size_bits_)) {}
 
   VariantEntity Entity(void) const Q_DECL_FINAL {
     return entity;
@@ -80,26 +81,37 @@ class StructExplorerItem final : public IGeneratedItem {
   }
 
   QVariant Data(int col) const Q_DECL_FINAL {
+    QVariant data;
+    if (col == 3) {
+      data.setValue(name_tokens);
+    }
+    return data;
+  }
+
+  bool IsDeferred(int col) const Q_DECL_FINAL {
+    return 0 <= col && col <= 4 && col != 3;
+  }
+
+  QVariant DeferredData(int col) const Q_DECL_FINAL {
     QVariant data;
     switch (col) {
       case 0:
-        if (offset_tokens) {
-          data.setValue(*offset_tokens);
+        if (offset_bits) {
+          data.setValue(BitsToTokenRange(*offset_bits));
         }
         break;
       case 1:
-        if (cumulative_offset_tokens) {
-          data.setValue(*cumulative_offset_tokens);
+        if (cumulative_offset_bits) {
+          data.setValue(BitsToTokenRange(*cumulative_offset_bits));
         }
         break;
       case 2:
-        if (size_tokens) {
-          data.setValue(*size_tokens);
+        if (size_bits) {
+          data.setValue(BitsToTokenRange(*size_bits));
         }
         break;
-      case 3: data.setValue(name_tokens); break;
       case 4:
-        data.setValue(type_tokens);
+        data.setValue(InjectWhitespace(type_tokens));
         break;
       default: break;
     }
@@ -185,26 +197,9 @@ CreateGeneratedItem(const VariantEntity &entity, TokenRange name,
                     std::optional<uint64_t> offset_in_bits,
                     std::optional<uint64_t> cumulative_offset_bits,
                     std::optional<uint64_t> size_in_bits) {
-  type_tokens = InjectWhitespace(type_tokens);
-
-  std::optional<TokenRange> offset_tokens;
-  if (offset_in_bits) {
-    offset_tokens = BitsToTokenRange(*offset_in_bits);
-  }
-
-  std::optional<TokenRange> cumulative_offset_tokens;
-  if (cumulative_offset_bits) {
-    cumulative_offset_tokens = BitsToTokenRange(*cumulative_offset_bits);
-  }
-
-  std::optional<TokenRange> size_tokens;
-  if (size_in_bits) {
-    size_tokens = BitsToTokenRange(*size_in_bits);
-  }
-
   return std::make_shared<StructExplorerItem>(
-      entity, entity, name, type_tokens, offset_tokens,
-      cumulative_offset_tokens, size_tokens, cumulative_offset_bits);
+      entity, entity, std::move(name), std::move(type_tokens), offset_in_bits,
+      cumulative_offset_bits, size_in_bits);
 }
 
 struct SizeOffsetAndBase {
@@ -0,0 +1,148 @@
+// Copyright (c) 2024-present, Trail of Bits, Inc.
+// All rights reserved.
+//
+// This source code is licensed in accordance with the terms specified in
+// the LICENSE file found in the root directory of this source tree.
+
+// Tests of the call path search on small, hand-written call graphs.
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <CallPathSearch.h>
+
+#include <utility>
+#include <vector>
+
+namespace mx::gui {
+namespace {
+
+// A call graph whose functions and call sites are numbers. Call site `0` is
+// the missing call site of the first step of a path.
+struct TestCallGraph {
+  using Node = unsigned;
+  using CallSite = unsigned;
+  using Id = unsigned;
+
+  struct Edge {
+    unsigned caller;
+    unsigned call_site;
+    unsigned callee;
+  };
+
+  std::vector<Edge> edges;
+
+  static unsigned IdOf(unsigned id) {
+    return id;
+  }
+
+  std::vector<Edge> Callees(unsigned func) const {
+    std::vector<Edge> callees;
+    for (const Edge &edge : edges) {
+      if (edge.caller == func) {
+        callees.push_back(edge);
+      }
+    }
+    return callees;
+  }
+
+  std::vector<Edge> Callers(unsigned func) const {
+    std::vector<Edge> callers;
+    for (const Edge &edge : edges) {
+      if (edge.callee == func) {
+        callers.push_back(edge);
+      }
+    }
+    return callers;
+  }
+};
+
+using TestCallPath = BasicCallPath<TestCallGraph>;
+
+// Run the search to completion, skipping over its checkpoints.
+static std::vector<TestCallPath> FindAll(TestCallGraph graph, unsigned source,
+                                         unsigned target) {
+  std::vector<TestCallPath> paths;
+  for (auto path : FindCallPaths(std::move(graph), source, target)) {
+    if (path) {
+      paths.push_back(*path);
+    }
+  }
+  return paths;
+}
+
+// Returns the functions along `path`.
+static std::vector<unsigned> Functions(const TestCallPath &path) {
+  std::vector<unsigned> funcs;
+  for (const auto &step : path) {
+    funcs.push_back(step.function);
+  }
+  return funcs;
+}
+
+// Returns the call sites along `path`.
+static std::vector<unsigned> CallSites(const TestCallPath &path) {
+  std::vector<unsigned> call_sites;
+  for (const auto &step : path) {
+    call_sites.push_back(step.call_site);
+  }
+  return call_sites;
+}
+
+TEST_CASE("A single chain of calls is one path") {
+  TestCallGraph graph;
+  graph.edges = {{1u, 12u, 2u}, {2u, 23u, 3u}, {3u, 34u, 4u}};
+
+  // The calls that lead nowhere make the forward frontier the bigger one, so
+  // that the backward side of the search runs along the chain, and meets the
+  // forward side at every call.
+  SUBCASE("Searched from one side") {}
+  SUBCASE("Searched from both sides") {
+    graph.edges.push_back({1u, 15u, 5u});
+    graph.edges.push_back({1u, 16u, 6u});
+  }
+
+  auto paths = FindAll(graph, 1u, 4u);
+  REQUIRE(paths.size() == 1u);
+  CHECK(Functions(paths[0]) == std::vector<unsigned>{1u, 2u, 3u, 4u});
+  CHECK(CallSites(paths[0]) == std::vector<unsigned>{0u, 12u, 23u, 34u});
+}
+
+TEST_CASE("Calls on different branches are different paths") {
+  TestCallGraph graph;
+  graph.edges = {{1u, 12u, 2u}, {1u, 13u, 3u}, {2u, 24u, 4u}, {3u, 34u, 4u}};
+
+  auto paths = FindAll(graph, 1u, 4u);
+  REQUIRE(paths.size() == 2u);
+  CHECK(Functions(paths[0]) != Functions(paths[1]));
+}
+
+TEST_CASE("Different calls of the same function are different paths") {
+  TestCallGraph graph;
+  graph.edges = {{1u, 12u, 2u}, {2u, 23u, 3u}, {2u, 230u, 3u}};
+
+  auto paths = FindAll(graph, 1u, 3u);
+  REQUIRE(paths.size() == 2u);
+  CHECK(Functions(paths[0]) == Functions(paths[1]));
+  CHECK(CallSites(paths[0]) != CallSites(paths[1]));
+}
+
+TEST_CASE("Paths don't go around cycles") {
+  TestCallGraph graph;
+  graph.edges = {{1u, 12u, 2u}, {2u, 21u, 1u}, {2u, 23u, 3u}, {3u, 32u, 2u}};
+
+  auto paths = FindAll(graph, 1u, 3u);
+  REQUIRE(paths.size() == 1u);
+  CHECK(Functions(paths[0]) == std::vector<unsigned>{1u, 2u, 3u});
+}
+
+TEST_CASE("There are no paths to unreachable functions") {
+  TestCallGraph graph;
+  graph.edges = {{1u, 12u, 2u}, {3u, 34u, 4u}};
+
+  CHECK(FindAll(graph, 1u, 4u).empty());
+  CHECK(FindAll(graph, 1u, 1u).empty());
+}
+
+}  // namespace
+}  // namespace mx::gui
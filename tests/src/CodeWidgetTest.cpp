@@ -0,0 +1,162 @@
+// Copyright (c) 2024-present, Trail of Bits, Inc.
+// All rights reserved.
+//
+// This source code is licensed in accordance with the terms specified in
+// the LICENSE file found in the root directory of this source tree.
+
+// Tests of the `CodeWidget` on the offscreen Qt platform. These need a
+// database, which is given by the `MXQT_TEST_DATABASE` environment variable,
+// e.g. the indexed build of `ci/data/sample_database01`. Without a database,
+// the tests are skipped.
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+#include <QApplication>
+
+#include <multiplier/AST/Decl.h>
+#include <multiplier/Frontend/TokenTree.h>
+#include <multiplier/GUI/Managers/ConfigManager.h>
+#include <multiplier/GUI/Managers/TaskManager.h>
+#include <multiplier/GUI/Managers/ThemeManager.h>
+#include <multiplier/GUI/Themes/BuiltinTheme.h>
+#include <multiplier/GUI/Widgets/CodeWidget.h>
+#include <multiplier/Index.h>
+
+#include <optional>
+#include <variant>
+
+namespace mx::gui {
+namespace {
+
+static constexpr int kViewportWidth = 1280;
+static constexpr int kViewportHeight = 1024;
+
+static ConfigManager *gConfigManager = nullptr;
+
+// Drain the event loop until there is no more background work, and no more
+// results of that work left to deliver.
+static void WaitForIdle(const TaskManager &task_manager) {
+  do {
+    task_manager.WaitForDone();
+    QCoreApplication::processEvents();
+  } while (task_manager.NumActiveThreads());
+}
+
+// Find a file with a declaration, and the last declaration in that file.
+static std::optional<std::pair<File, Decl>> FileWithDecl(const Index &index) {
+  for (const auto &[path, file_id] : index.file_paths()) {
+    std::optional<File> file = index.file(file_id);
+    if (!file) {
+      continue;
+    }
+
+    std::optional<Decl> last_decl;
+    for (Fragment frag : file->fragments()) {
+      for (Decl decl : Decl::in(frag)) {
+        last_decl = std::move(decl);
+      }
+    }
+
+    if (last_decl) {
+      return std::make_pair(std::move(file.value()),
+                            std::move(last_decl.value()));
+    }
+  }
+  return std::nullopt;
+}
+
+TEST_CASE("Going to an entity in a cached scene") {
+  if (!gConfigManager) {
+    MESSAGE("Set MXQT_TEST_DATABASE to run this test");
+    return;
+  }
+
+  ConfigManager &config_manager = *gConfigManager;
+  TaskManager &task_manager = config_manager.TaskManager();
+
+  auto file_and_decl = FileWithDecl(config_manager.Index());
+  REQUIRE(file_and_decl.has_value());
+  auto &[file, decl] = file_and_decl.value();
+
+  auto token_tree = TokenTree::create(file);
+  auto file_id = file.id().Pack();
+
+  // The first widget builds the scene, and puts it in the scene cache.
+  CodeWidget first(config_manager, "com.trailofbits.test.CodeWidgetTest");
+  first.resize(kViewportWidth, kViewportHeight);
+  first.show();
+  first.ChangeScene(token_tree, {}, file_id);
+  WaitForIdle(task_manager);
+  first.repaint();
+
+  auto num_hits = CodeWidget::GetSceneCacheStatistics().num_hits;
+
+  // The second widget finds the scene in the cache, and is asked to go to an
+  // entity before the scene is installed.
+  CodeWidget second(config_manager, "com.trailofbits.test.CodeWidgetTest");
+  second.resize(kViewportWidth, kViewportHeight);
+  second.show();
+
+  auto num_go_tos = 0;
+  QObject::connect(
+      &second, &CodeWidget::LocationChanged,
+      [&num_go_tos] (CodeWidget::LocationChangeReason reason) {
+        if (reason == CodeWidget::kExternalGoToEntity) {
+          ++num_go_tos;
+        }
+      });
+
+  second.ChangeScene(token_tree, {}, file_id);
+  second.OnGoToEntity(decl, false  /* take focus */);
+
+  // Painting before the scene is installed must not install it.
+  second.repaint();
+  CHECK(num_go_tos == 0);
+
+  WaitForIdle(task_manager);
+  second.repaint();
+
+  CHECK(CodeWidget::GetSceneCacheStatistics().num_hits > num_hits);
+  CHECK(num_go_tos == 1);
+}
+
+}  // namespace
+}  // namespace mx::gui
+
+int main(int argc, char *argv[]) {
+  using namespace mx;
+  using namespace mx::gui;
+
+  // Render without a display, unless told otherwise.
+  if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+
+  QApplication::setStyle("Fusion");
+  QApplication application(argc, argv);
+  application.setApplicationName("CodeWidgetTest");
+
+  qRegisterMetaType<uint64_t>("uint64_t");
+  qRegisterMetaType<RawEntityId>("RawEntityId");
+  qRegisterMetaType<VariantEntity>("VariantEntity");
+
+  std::optional<ConfigManager> config_manager;
+  QString database_path = qEnvironmentVariable("MXQT_TEST_DATABASE");
+  if (!database_path.isEmpty()) {
+    config_manager.emplace(application);
+    config_manager->SetIndex(
+        Index::in_memory_cache(
+            Index::from_database(database_path.toStdString())),
+        database_path);
+
+    auto &theme_manager = config_manager->ThemeManager();
+    auto &media_manager = config_manager->MediaManager();
+    theme_manager.Register(CreateDarkTheme(media_manager));
+    theme_manager.SetTheme(theme_manager.Find("com.trailofbits.theme.Dark"));
+    gConfigManager = &(config_manager.value());
+  }
+
+  doctest::Context context(argc, argv);
+  return context.run();
+}
@@ -119,8 +119,44 @@ class CodeWidget Q_DECL_FINAL : public IWindowWidget {
              bool browse_mode = false,
              QWidget *parent = nullptr);
 
+  //! Counters of the process-wide cache of scenes shared by code widgets.
+  //! `memory_usage / num_tokens` is the number of bytes used per displayed
+  //! token.
+  struct SceneCacheStatistics {
+    size_t num_hits{0u};
+    size_t num_misses{0u};
+    size_t num_scenes{0u};
+    size_t num_tokens{0u};
+    size_t memory_usage{0u};
+    size_t memory_budget{0u};
+  };
+
+  //! Counters of the process-wide cache of shaped token text. The hit rate,
+  //! `num_hits / (num_hits + num_misses)`, is the fraction of drawn tokens
+  //! whose text didn't need to be shaped.
+  struct GlyphCacheStatistics {
+    size_t num_hits{0u};
+    size_t num_misses{0u};
+    size_t num_entries{0u};
+    size_t max_entries{0u};
+  };
+
+  //! Durations of the recent paints of a code widget, in milliseconds.
+  //! `num_paints` counts all paints, whereas the percentiles only consider the
+  //! most recent ones.
+  struct PaintStatistics {
+    size_t num_paints{0u};
+    double p50_ms{0};
+    double p99_ms{0};
+    double max_ms{0};
+  };
+
   //! Change the underlying data / model being rendered by this code widget.
-  void ChangeScene(const TokenTree &token_tree, const SceneOptions &options);
+  //! `containing_entity_id` identifies what `token_tree` was created from,
+  //! e.g. a file or fragment. If it's valid, then code widgets showing the
+  //! same entity in the same way share their scenes.
+  void ChangeScene(const TokenTree &token_tree, const SceneOptions &options,
+                   RawEntityId containing_entity_id = kInvalidEntityId);
 
   //! Called when we want to act on the context menu.
   void ActOnContextMenu(IWindowManager *manager, QMenu *menu,
@@ -132,6 +168,23 @@ class CodeWidget Q_DECL_FINAL : public IWindowWidget {
   // Try to go to an opaque location.
   void TryGoToLocation(const OpaqueLocation &location, bool take_focus);
 
+  //! Set the maximum number of bytes of rasterized code that this widget keeps
+  //! cached. Only the parts of the code near the viewport are rasterized.
+  void SetRasterCacheBudget(size_t num_bytes);
+
+  //! Return the durations of the recent paints of this widget.
+  PaintStatistics GetPaintStatistics(void) const;
+
+  //! Set the maximum number of bytes of scenes that code widgets keep cached
+  //! for sharing with each other.
+  static void SetSceneCacheBudget(size_t num_bytes);
+
+  //! Return the counters of the cache of scenes shared by code widgets.
+  static SceneCacheStatistics GetSceneCacheStatistics(void);
+
+  //! Return the counters of the cache of shaped text shared by code widgets.
+  static GlyphCacheStatistics GetGlyphCacheStatistics(void);
+
  private:
   friend struct PrivateData;
   void EmitLocationChanged(LocationChangeReason reason);
@@ -0,0 +1,40 @@
+/*
+  Copyright (c) 2024-present, Trail of Bits, Inc.
+  All rights reserved.
+
+  This source code is licensed in accordance with the terms specified in
+  the LICENSE file found in the root directory of this source tree.
+*/
+
+#include "BuildSceneRunnable.h"
+
+namespace mx::gui {
+
+BuildSceneRunnable::~BuildSceneRunnable(void) {}
+
+void BuildSceneRunnable::run(void) {
+  SceneBuilder builder(config, file_location_cache);
+
+  builder.SetCancelCallback([this] (void) {
+    return version_number->load() != captured_version_number;
+  });
+
+  if (0 < num_partial_lines) {
+    builder.SetPartialSceneCallback(
+        num_partial_lines,
+        [this] (Scene scene) {
+          emit PartialSceneReady(captured_version_number,
+                                 std::make_shared<Scene>(std::move(scene)));
+        });
+  }
+
+  builder.Import(token_tree.root());
+  if (builder.WasCancelled()) {
+    return;
+  }
+
+  emit SceneReady(captured_version_number,
+                  std::make_shared<Scene>(builder.TakeScene()));
+}
+
+}  // namespace mx::gui
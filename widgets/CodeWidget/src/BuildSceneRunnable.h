@@ -0,0 +1,75 @@
+/*
+  Copyright (c) 2024-present, Trail of Bits, Inc.
+  All rights reserved.
+
+  This source code is licensed in accordance with the terms specified in
+  the LICENSE file found in the root directory of this source tree.
+*/
+
+#pragma once
+
+#include <QObject>
+#include <QRunnable>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <multiplier/Frontend/TokenTree.h>
+
+#include "Scene.h"
+#include "SceneBuilder.h"
+
+namespace mx::gui {
+
+using AtomicU64 = std::atomic<uint64_t>;
+using AtomicU64Ptr = std::shared_ptr<AtomicU64>;
+
+//! Imports a `TokenTree` into a `Scene` off of the main thread. Builds are
+//! abandoned as soon as `version_number` no longer matches the version number
+//! captured at construction time.
+class BuildSceneRunnable Q_DECL_FINAL : public QObject, public QRunnable {
+  Q_OBJECT
+
+  // The tree to import, and the snapshot of the widget's configuration.
+  const TokenTree token_tree;
+  const SceneConfiguration config;
+
+  // Shared with other runnables, so that line tables are computed once.
+  const FileLocationCache file_location_cache;
+
+  // Number of logical lines to import before publishing a partial scene, or
+  // zero to only publish the complete scene.
+  const int num_partial_lines;
+
+  // Used to keep track of if the build needs to still happen.
+  const AtomicU64Ptr version_number;
+  const uint64_t captured_version_number;
+
+ public:
+  virtual ~BuildSceneRunnable(void);
+
+  inline explicit BuildSceneRunnable(
+      TokenTree token_tree_, SceneConfiguration config_,
+      FileLocationCache file_location_cache_, int num_partial_lines_,
+      AtomicU64Ptr version_number_)
+      : token_tree(std::move(token_tree_)),
+        config(std::move(config_)),
+        file_location_cache(std::move(file_location_cache_)),
+        num_partial_lines(num_partial_lines_),
+        version_number(std::move(version_number_)),
+        captured_version_number(version_number->load()) {
+    setAutoDelete(true);
+  }
+
+  void run(void) Q_DECL_FINAL;
+
+ signals:
+  //! Published at most once, before `SceneReady`, with the first few lines of
+  //! the scene.
+  void PartialSceneReady(uint64_t version_number, ScenePtr scene);
+
+  //! Published with the complete scene, unless the build was cancelled.
+  void SceneReady(uint64_t version_number, ScenePtr scene);
+};
+
+}  // namespace mx::gui
@@ -11,6 +11,7 @@
 #include <QAction>
 #include <QApplication>
 #include <QClipboard>
+#include <QElapsedTimer>
 #include <QFontMetricsF>
 #include <QHBoxLayout>
 #include <QImage>
@@ -22,14 +23,19 @@
 #include <QPaintEvent>
 #include <QPixmap>
 #include <QRectF>
+#include <QRegion>
 #include <QRegularExpression>
 #include <QResizeEvent>
 #include <QScrollBar>
+#include <QTextLayout>
 #include <QTimer>
 #include <QVBoxLayout>
 #include <QWheelEvent>
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <unordered_map>
 #include <multiplier/AST/AddrLabelExpr.h>
 #include <multiplier/AST/DeclRefExpr.h>
 #include <multiplier/AST/LabelStmt.h>
@@ -41,12 +47,20 @@
 #include <multiplier/GUI/Managers/ActionManager.h>
 #include <multiplier/GUI/Managers/ConfigManager.h>
 #include <multiplier/GUI/Managers/MediaManager.h>
+#include <multiplier/GUI/Managers/TaskManager.h>
 #include <multiplier/GUI/Managers/ThemeManager.h>
 #include <multiplier/GUI/Util.h>
 #include <multiplier/GUI/Widgets/SearchWidget.h>
 #include <multiplier/Types.h>
 
+#include "BuildSceneRunnable.h"
+#include "GlyphCache.h"
 #include "GoToLineWidget.h"
+#include "Scene.h"
+#include "SceneCache.h"
+#include "ScrollMarkerWidget.h"
+#include "SearchRunnable.h"
+#include "TileCache.h"
 
 #ifdef __APPLE__
 # include "MacosUtils.h"
@@ -61,301 +75,23 @@ static const QKeySequence kGotoLineKeqSequence("Ctrl+L");
 static constexpr auto kBoldMask = 0b10u;
 static constexpr auto kItalicMask = 0b01u;
 static constexpr auto kFormatMask = kBoldMask | kItalicMask;
-static constexpr auto kFormatShift = 2u;
 static constexpr qreal kCursorWidth = 2;
 static constexpr qreal kCursorDisp = -0.5;
 
-// TODO(pag): Don't hardcode this. Investigate `QStackTextEngine`, the
-//            `QPainter` uses this internally. It seems that
-//            `QPainter::boundingRect` can take a `QTextOption` that can be
-//            configured with tab info.
-static constexpr auto kTabWidth = 4u;
+// Number of recent paints whose durations we keep for `GetPaintStatistics`.
+static constexpr size_t kNumPaintTimes = 256u;
 
-struct Entity {
+// Column used in `TileKey`s for tiles of the line number gutter.
+static constexpr int kGutterColumn = -1;
 
-  // Beginning `(x, y)` positions of where some text data exists in the scene.
-  // The origin `(0, 0)` represents the top-left of the viewport. The unit size
-  // of the `x` coordinate system is in terms of the font width, and the unit
-  // size of the `y` coordinate system is in terms of the font height.
-  //
-  // NOTE(pag): These are overwritten by the painter.
-  qreal x;
+// Number of tiles around the viewport that we try to rasterize ahead of time,
+// and the maximum number of tiles to rasterize per idle event loop turn.
+static constexpr int kPrefetchMargin = 1;
+static constexpr int kMaxPrefetchTilesPerTurn = 4;
 
-  // Index of this entity's data in `Scene::token_data`. The low two bits are
-  // the "configuration" of this entity, i.e. selects which bounding rect
-  // applies. These low two bits get updated by the painter.
-  unsigned data_index_and_config;
-
-  // Index of this entity's token in `Scene::tokens`.
-  unsigned token_index;
-
-  // The logical (one-indexed) line number of this token.
-  int logical_line_number;
-
-  // The logical (one-indexed) column number of this token.
-  int logical_column_number;
-};
-
-struct Data {
-  QString text;
-
-  QString selection;
-
-  bool bounding_rect_valid[4u];
-
-  // Normal, bold, italic, and bold+italic.
-  QRectF bounding_rect[4u];
-};
-
-struct Scene {
-  // The complete, (nearly) original document.
-  QString document;
-
-  // Sorted list of entities in this scene. This is sorted by
-  // `(Entity::x, Entity::y)` positions.
-  std::vector<Entity> entities;
-
-  // For logical (one-based) line number `N`, `logical_line_index[N - 1]` is
-  // the index into `entities` of the first entity on that line.
-  std::vector<unsigned> logical_line_index;
-
-  // The file line number associated with the `N`th entity. `0` if invalid,
-  // negative if in a macro.
-  std::vector<int> file_line_number;
-
-  // Offset of the beginning of each entity in the total text of the document.
-  std::vector<int> begin_of_entity_in_document;
-
-  // A linear representation of the token data. If a token spans multiple lines
-  // then it is split into multiple entries in `token_data`. If a token only
-  // contributes pure whitespace then it is not included in `token_data`.
-  std::vector<Data> data;
-
-  // The underlying tokens.
-  std::vector<Token> tokens;
-
-  // A sorted list of related entity IDs and the into `entities`.
-  std::vector<std::pair<RawEntityId, unsigned>> related_entity_ids;
-
-  // Keeps track of which macros were and weren't expanded.
-  std::unordered_map<RawEntityId, bool> expanded_macros;
-
-  // Maps things like fragments to where they should/could logically begin.
-  std::unordered_map<RawEntityId, unsigned> entity_begin_offset;
-
-  // Maps displayed fragments to where they should/could logically begin.
-  std::unordered_map<RawEntityId, unsigned> fragment_begin_offset;
-
-  // Given that `N` is a logical line number, `physical_line_number[N - 1]` is
-  // a physical line number. These can have repeats, and negative numbers, and
-  // can't be relied upon as being in 
-  std::vector<int> physical_line_number;
-
-  // Maximum number of characters on any given line.
-  int max_logical_columns{1};
-
-  // Number of logical lines in this scene.
-  int num_lines{1};
-
-  // Number file line number seen.
-  int num_file_lines{1};
-};
-
-// The scene builder helps to populate a given `Scene`. It keeps track of state
-// that doesn't need to persist past the creation of a `Scene`.
-struct SceneBuilder {
-  Scene scene;
-
-  // Maps unique `QString`s to an index in `Scene::data`.
-  QMap<QString, unsigned> data_to_index;
-
-  int logical_column_number{1};
-  int token_start_column{0};
-  int token_length{0};
-  int expansion_depth{0};
-  int document_offset{0};
-  int line_number{0};
-  unsigned token_index{0u};
-  bool added_anything{false};
-  RawEntityId related_entity_id{kInvalidEntityId};
-  FileLocationCache file_cache;
-  QString token_data;
-  TokenRange macro_use_tokens;
-
-  inline SceneBuilder(void) {
-    scene.logical_line_index.emplace_back(0u);
-  }
-
-  void BeginToken(const Token &tok) {
-    related_entity_id = tok.related_entity_id().Pack();
-    document_offset = static_cast<int>(scene.document.size());
-    line_number = 0;
-
-    TokenRange file_toks;
-    if (expansion_depth) {
-      file_toks = macro_use_tokens;
-    } else {
-      file_toks = TokenRange(tok).file_tokens();
-    }
-    auto first_file_loc = file_toks.front().location(file_cache);
-    auto last_file_loc = file_toks.back().location(file_cache);
-    if (!first_file_loc) {
-      return;
-    }
-
-    Q_ASSERT(last_file_loc.has_value());
-
-    auto first_line_num = static_cast<int>(first_file_loc->first);
-    auto last_line_num = static_cast<int>(last_file_loc->first);
-    
-    // The token, or the extent of the use of the macro, are all on one line.
-    if (first_line_num == last_line_num) {
-      line_number = first_line_num;
-    }
-
-    scene.num_file_lines = std::max(scene.num_file_lines, line_number);
-
-    // If we're in an expansion, then negate the line number to signal that it
-    // should be specially colored.
-    if (expansion_depth) {
-      line_number = -line_number;
-    }
-  }
-
-  void AddNewLine(void) {
-    AddChar(QChar::LineFeed);
-    AddEntity();
-    logical_column_number = 1u;
-    scene.num_lines += 1;
-    scene.logical_line_index.emplace_back(
-        static_cast<unsigned>(scene.entities.size()));
-
-    if (0 < line_number) {
-      line_number += 1;
-    } 
-  }
-
-  void AddChar(QChar ch) {
-    if (!token_start_column) {
-      token_start_column = logical_column_number;
-    }
-    scene.document.append(ch);
-    token_data.append(ch);
-    token_length += 1;
-    logical_column_number += 1u;
-    added_anything = true;
-  }
-
-  void EndToken(Token tok) {
-    AddEntity();
-    if (added_anything) {
-
-      // The `TokenTree` API often gives us macro tokens, but if we can get a
-      // parsed token, then we actually want that, as it makes scroll to entity
-      // much easier.
-      if (auto parsed_tok = tok.parsed_token()) {
-        scene.tokens.emplace_back(std::move(parsed_tok));
-      } else {
-        scene.tokens.emplace_back(std::move(tok));
-      }
-
-      added_anything = false;
-      token_index += 1u;
-    }
-  }
-
-  void AddEntity(void) {
-    if (!token_length) {
-      return;
-    }
-
-    scene.max_logical_columns = std::max(
-        scene.max_logical_columns, token_start_column + token_length);
-
-    // Get or create an index in `Scene::data` for the actual token data.
-    auto data_index_it = data_to_index.find(token_data);
-    unsigned data_index = 0u;
-    if (data_index_it == data_to_index.end()) {
-      data_index = static_cast<unsigned>(scene.data.size());
-
-      Data &d = scene.data.emplace_back();
-      d.text = std::move(token_data);
-
-      for (auto &v : d.bounding_rect_valid) {
-        v = false;
-      }
-
-    } else {
-      data_index = data_index_it.value();
-    }
-    token_data.clear();
-
-    // Keep track of the related entity ID associated with this entity.
-    if (related_entity_id != kInvalidEntityId) {
-      scene.related_entity_ids.emplace_back(
-        related_entity_id, static_cast<unsigned>(scene.entities.size()));
-    }
-
-    // Add the entity.
-    Entity &e = scene.entities.emplace_back();
-    e.logical_line_number = scene.num_lines;
-    e.logical_column_number = token_start_column;
-    e.data_index_and_config = data_index << 2u;
-    e.token_index = token_index;
-
-    scene.file_line_number.push_back(line_number);
-    scene.begin_of_entity_in_document.push_back(document_offset);
-
-    token_start_column = 0u;
-    token_length = 0;
-    document_offset = static_cast<int>(scene.document.size());
-  }
-
-  Scene TakeScene(void) & {
-    scene.logical_line_index.resize(static_cast<unsigned>(scene.num_lines + 1));
-    scene.logical_line_index.back()
-        = static_cast<unsigned>(scene.entities.size());
-    std::sort(scene.related_entity_ids.begin(), scene.related_entity_ids.end());
-
-    auto max_i = scene.logical_line_index.size() - 1u;
-    int last_line_num = -1;
-
-    // Paint the line numbers.
-    for (auto i = 0u; i < max_i; ++i) {
-      line_number = 0;
-      auto backup_line_number = 0;
-      auto max_e = scene.logical_line_index[i + 1u];
-      
-      // Go get the minimum line number. Some might be negative because of a
-      // macro expansion on the line, so we want to highlight that an expansion
-      // happened somewhere on the line.
-      for (auto e = scene.logical_line_index[i]; e < max_e; ++e) {
-        if (auto ln = scene.file_line_number[e]) {
-          if (!line_number) {
-            line_number = ln;
-          } else if (std::abs(ln) >= std::abs(last_line_num)) {
-            line_number = std::min(line_number, ln);
-          
-          // TODO(pag): Sometimes see these; diagnose their source.
-          } else if (!backup_line_number) {
-            backup_line_number = ln;
-          } else {
-            backup_line_number = std::min(backup_line_number, ln);
-          }
-        }
-      }
-
-      if (!line_number) {
-        line_number = backup_line_number ? backup_line_number : last_line_num;
-      }
-
-      scene.physical_line_number.emplace_back(line_number);
-      last_line_num = -std::abs(line_number);
-    }
-
-    return std::move(scene);
-  }
-};
+// Minimum number of logical lines that a scene build imports before it
+// publishes a partial scene for the first paint.
+static constexpr int kMinPartialSceneLines = 128;
 
 // Dummy model to expose tokens to other stuff.
 class TokenModel Q_DECL_FINAL : public IModel {
@@ -472,6 +208,10 @@ struct CodeWidget::PrivateData {
   // Source of data that we're rendering.
   TokenTree token_tree;
 
+  // Shared by everything that computes locations. Scene builds use this to
+  // find the line numbers of tokens.
+  FileLocationCache file_location_cache;
+
   // Size of the visible viewport area for this widget.
   QRect viewport;
 
@@ -507,13 +247,38 @@ struct CodeWidget::PrivateData {
   // must be recomputed.
   bool scene_changed{true};
 
+  // Scenes are built by a `BuildSceneRunnable` on a background thread. Bumping
+  // `scene_version_number` cancels any in-progress build. `scene_pending` is
+  // `true` until the complete scene of the latest build has been installed.
+  AtomicU64Ptr scene_version_number;
+  bool scene_pending{false};
+
+  // Runs scene builds and searches.
+  TaskManager &task_manager;
+  TaskGroup task_group;
+
+  // Requests that arrived while a scene was being built, and that need the
+  // complete scene to be serviced.
+  std::optional<std::pair<VariantEntity, bool>> pending_go_to_entity;
+  std::optional<std::pair<OpaqueLocation, bool>> pending_location;
+  std::optional<unsigned> pending_line_number;
+
   // The canvas is really a mix of things, but as a whole it represents what
   // we're trying to paint in order to render code. The canvas is made of a mix
-  // of cached layers (`background_canvas`, `foreground_canvas`) and layers
-  // that are (re)generated on every `paintEvent`. If the scene or theme changes
-  // then we generally need to recompute the canvas.
+  // of cached layers (tiles in `tile_cache`) and layers that are (re)generated
+  // on every `paintEvent`. If the scene or theme changes then we generally need
+  // to recompute the canvas, i.e. re-layout the entities.
   bool canvas_changed{true};
 
+  // If set, then the next re-layout only needs to re-rasterize the logical
+  // lines in this (zero-based, inclusive) range, e.g. because a macro was
+  // expanded in place.
+  std::optional<std::pair<int, int>> dirty_lines;
+
+  // Theme colors (and maybe bold/italic) changed, so the style of each token
+  // needs to be resolved again. This doesn't require a new scene.
+  bool styles_changed{true};
+
   // The current DPI ratio for the app. The viewport of the codewidget is
   // expressed in pixels, and we need to multiply by the DPI ratio to get the
   // actual width that we're painting.
@@ -549,71 +314,159 @@ struct CodeWidget::PrivateData {
   // The current entity under the cursor.
   const Entity *current_entity{nullptr};
 
-  // The previous highlighted entity.
-  const Entity *prev_highlighted_entity{nullptr};
+  // What the last `paintEvent` drew, so that we know what to repaint when
+  // the cursor moves. `painted_scroll` is the scroll position of what's on
+  // screen, which lets us shift it when scrolling rather than repaint it.
+  QPoint painted_scroll;
+  std::optional<QPointF> painted_cursor;
+  int painted_line_index{-1};
+  const Entity *painted_entity{nullptr};
+  bool painted_selection{false};
+
+  // Durations, in nanoseconds, of the most recent `kNumPaintTimes` paints.
+  // This is a ring buffer; `num_paints` counts all paints.
+  std::vector<qint64> paint_times;
+  size_t num_paints{0u};
 
   TokenModel token_model;
 
-  // Data structure keeping track of the logical things to render, and
-  // where to render them. The act of rendering updates `Entity`s in the
-  // scene to keep track of their physical locations within `*_canvas`.
-  Scene scene;
+  // Data structure keeping track of the logical things to render. The scene
+  // is immutable, and may be shared with other code widgets by way of the
+  // `SceneCache`.
+  ConstScenePtr scene;
+
+  // Identifies what `token_tree` was created from, so that scenes can be
+  // found in, and added to, the `SceneCache`.
+  RawEntityId scene_cache_id{kInvalidEntityId};
+
+  // For entity index `N`, `entity_layout[N]` is where `scene->entities[N]`
+  // is placed. For data index `N`, `data_layout[N]` holds the measured
+  // shapes of `scene->data[N]`. The act of laying out the canvas updates
+  // these.
+  std::vector<EntityLayout> entity_layout;
+  std::vector<DataLayout> data_layout;
+
+  // Lazily computed cursor positions within the data of entities, for
+  // variable-width fonts. For data index `D` drawn in bounding rect
+  // configuration `C`, `character_offsets[(D << 2) | C][K]` is the width of
+  // the first `K` characters of the data. This makes hit-testing a binary
+  // search, rather than a re-measurement of successively longer prefixes.
+  mutable std::unordered_map<uint64_t, std::vector<qreal>> character_offsets;
+
+  // For token index `N`, `token_styles[N]` is the theme's color and style for
+  // `scene->tokens[N]`. This is filled in by the style pass.
+  std::vector<ITheme::ColorAndStyle> token_styles;
+
+  // Rasterized tiles of the code (background and foreground layers), and of
+  // the line number gutter. Only tiles that intersect the viewport, plus a
+  // prefetch margin, get rasterized.
+  TileCache tile_cache;
+
+  // Used to rasterize tiles around the viewport when we're otherwise idle.
+  QTimer prefetch_timer;
 
-  // Semi-persistent layers of the "picture" of what is rendered.
-  QImage background_canvas;
-  QImage foreground_canvas;
-  QImage highlight_canvas;
-  QImage line_number_canvas;
+  // Width of the digits in the gutter.
+  qreal gutter_digits_width{0};
 
   // Sets of entities that configure what gets shown from `token_tree`.
   QSet<RawEntityId> macros_to_expand;
   QMap<RawEntityId, QString> new_entity_names;
   QSet<RawEntityId> scene_overrides;
 
-  // Search results.
-  std::vector<std::pair<qsizetype, qsizetype>> search_result_list;
+  // Search results, in document order. These stream in from a
+  // `SearchRunnable`. Bumping `search_version_number` cancels the search.
+  SearchResults search_result_list;
+  AtomicU64Ptr search_version_number;
+
+  // The parameters of, and the scene searched by, the most recent search.
+  // `search_complete` is `true` once all of its results are in
+  // `search_result_list`.
+  SearchWidget::SearchParameters search_parameters;
+  ConstScenePtr search_scene;
+  bool search_complete{false};
 
   QWidget *code_area{nullptr};
   QScrollBar *horizontal_scrollbar{nullptr};
   QScrollBar *vertical_scrollbar{nullptr};
+
+  // Marks the lines of all occurrences of the current entity. The markers are
+  // recomputed when the current entity changes, or when `markers_changed`.
+  ScrollMarkerWidget *scroll_marker{nullptr};
+  const Entity *marked_entity{nullptr};
+  bool markers_changed{true};
   SearchWidget *search_widget{nullptr};
   GoToLineWidget *goto_line_widget{nullptr};
 
   std::optional<OpaqueLocation> last_location;
   VariantEntity last_entity_for_location;
 
-  inline PrivateData(const QString &model_id)
+  inline PrivateData(TaskManager &task_manager_, const QString &model_id)
       : monospace(" "),
         to(Qt::AlignLeft),
+        scene_version_number(std::make_shared<AtomicU64>(0u)),
+        task_manager(task_manager_),
         dpi_ratio(qApp->devicePixelRatio()),
-        token_model(model_id) {}
+        token_model(model_id),
+        scene(std::make_shared<Scene>()),
+        search_version_number(std::make_shared<AtomicU64>(0u)) {}
+
+  inline const EntityLayout &LayoutOf(const Entity *entity) const {
+    return entity_layout[static_cast<size_t>(
+        entity - scene->entities.data())];
+  }
+
+  inline const QRectF &BoundingRectOf(const Entity *entity) const {
+    return data_layout[entity->data_index].bounding_rect[
+        LayoutOf(entity).config];
+  }
 
   void UpdateScrollbars(void);
-  void RecomputeScene(void);
-  void RecomputeCanvas(void);
+  bool CanNarrowSearch(
+      const SearchWidget::SearchParameters &new_parameters) const;
+  SceneConfiguration Configuration(void) const;
+  void RecomputeScene(CodeWidget *self);
+  bool InstallScene(CodeWidget *self, uint64_t scene_version,
+                    ConstScenePtr new_scene);
+  void SetScene(ConstScenePtr new_scene);
+  void ClearMeasurements(void);
+  void RecomputeStyles(void);
+  void UpdateEntityConfigs(void);
+  bool SpliceMacros(CodeWidget *self);
+  void RecomputeCanvas(CodeWidget *self);
   void RecomputeLineNumbers(void);
-  void RecomputeHighlights(void);
+  void PaintHighlights(QPainter &blitter, QRect dirty_rect);
+  void UpdateScrollMarkers(void);
+  std::pair<RawEntityId, QColor> HighlightedEntity(void) const;
   void RecomputeSelection(QPainter &blitter);
+
+  std::vector<TileKey> CodeTileKeys(QRect rect) const;
+  std::vector<TileKey> GutterTileKeys(QRect rect) const;
+  QPointF TileOrigin(TileKey key) const;
+  Tile GetTile(TileKey key);
+  Tile RenderCodeTile(TileKey key);
+  Tile RenderGutterTile(int row);
+  bool PrefetchTiles(void);
   void ScrollToPoint(CodeWidget *self, QPointF, bool take_focus,
                      LocationChangeReason reason);
   void ScrollToEntityOffset(CodeWidget *self, unsigned offset,
                             bool take_focus, LocationChangeReason reason);
 
+  QFont FontForStyle(const ITheme::ColorAndStyle &cs) const;
+
+  qreal LayoutToken(QPainter &measurer, QStringView text,
+                    DataLayout &layout, unsigned rect_config,
+                    const ITheme::ColorAndStyle &cs);
+
   void PaintToken(
-      QPainter &fg_painter, QPainter &bg_painter, Data &data,
-      unsigned rect_config, ITheme::ColorAndStyle cs, qreal &x, qreal &y);
-
-  void ImportChoiceNode(SceneBuilder &b,
-                        ChoiceTokenTreeNode node);
-  void ImportSubstitutionNode(SceneBuilder &b,
-                              SubstitutionTokenTreeNode node);
-  void ImportSequenceNode(SceneBuilder &b,
-                          SequenceTokenTreeNode node);
-  void ImportTokenNode(SceneBuilder &b,
-                       TokenTokenTreeNode node);
-  void ImportNode(SceneBuilder &b, TokenTreeNode node);
+      QPainter &fg_painter, QPainter &bg_painter, QStringView text,
+      DataLayout &layout, unsigned rect_config, ITheme::ColorAndStyle cs,
+      qreal &x, qreal &y);
 
   void ScrollBy(int horizontal_pixel_delta, int vertical_pixel_delta);
+  void UpdateAfterScroll(CodeWidget *self);
+  void UpdateCursorArea(CodeWidget *self);
+  QRect CursorRect(QPointF cursor_pos) const;
+  QRect LineRect(int line_index) const;
 
   const Entity *EntityUnderPoint(QPointF point) const;
 
@@ -625,6 +478,8 @@ struct CodeWidget::PrivateData {
       QPointF point, const Entity *entity) const;
   std::pair<int, qreal> CharacterPositionFixed(
       QPointF point, const Entity *entity) const;
+  const std::vector<qreal> &CharacterOffsets(const Entity *entity) const;
+  const Entity *LastEntityAtOrBefore(unsigned line_index, qreal x) const;
 
   QPointF CursorPosition(QPointF point) const;
   QPointF CursorPositionFixed(QPointF point) const;
@@ -690,222 +545,118 @@ QModelIndex CodeWidget::PrivateData::CreateModelIndex(const Entity *entity) {
     token_model.token = {};
     token_model.text = token_model.selection;
   } else {
-    token_model.token = scene.tokens[entity->token_index];
-    token_model.text
-        = scene.data[entity->data_index_and_config >> kFormatShift].text;
+    token_model.token = scene->tokens[entity->token_index];
+    token_model.text = scene->Text(entity->data_index).toString();
   }
   return token_model.index(0, 0, {});
 }
 
-// Import a choice node.
-void CodeWidget::PrivateData::ImportChoiceNode(
-    SceneBuilder &b, ChoiceTokenTreeNode node) {
+// Scroll the window by a specific delta.
+void CodeWidget::PrivateData::ScrollBy(
+    int horizontal_pixel_delta, int vertical_pixel_delta) {
 
-  std::optional<TokenTreeNode> chosen_node;
-  RawEntityId chosen_fragment_id = kInvalidEntityId;
-  unsigned eo = static_cast<unsigned>(b.scene.entities.size());
+  auto c_width = canvas_rect.width();
+  auto c_height = canvas_rect.height();
 
-  for (auto &item : node.children()) {
-    RawEntityId fragment_id = item.first.id().Pack();
-    
-    // Keep track of fragment locations.
-    b.scene.entity_begin_offset.emplace(fragment_id, eo);
+  auto v_width = viewport.width();
+  auto v_height = viewport.height();
 
-    if (scene_overrides.contains(fragment_id) || !chosen_node) {
-      chosen_node.reset();
-      chosen_node.emplace(std::move(item.second));
-      chosen_fragment_id = fragment_id;
-    }
-  }
+  if (c_width > v_width) {
+    scroll_x = std::min(
+        std::max(0, scroll_x + horizontal_pixel_delta),
+        c_width - v_width);
 
-  if (chosen_node) {
-    b.scene.fragment_begin_offset.emplace(chosen_fragment_id, eo);
-    ImportNode(b, std::move(chosen_node.value()));
+  } else {
+    scroll_x = 0;
   }
-}
 
-// Import a substitution node.
-void CodeWidget::PrivateData::ImportSubstitutionNode(
-    SceneBuilder &b, SubstitutionTokenTreeNode node) {
-
-  RawEntityId def_id = kInvalidEntityId;
-  std::optional<Macro> macro;
-  auto sub = node.macro();
-  auto force_expand = false;
-  if (std::holds_alternative<MacroSubstitution>(sub)) {
-    auto &sub_node = std::get<MacroSubstitution>(sub);
-    macro = sub_node;
-
-    // Global expansion of a macro is based on the definition ID.
-    if (auto exp = MacroExpansion::from(macro.value())) {
-      if (auto def = exp->definition()) {
-        def_id = def->id().Pack();
-      }
-    
-    } else if (sub_node.last_fully_substituted_token().kind() ==
-               TokenKind::HEADER_NAME) {
-      force_expand = true;
+  if (c_height > v_height) {
+    scroll_y = std::min(
+        std::max(0, scroll_y + vertical_pixel_delta),
+        c_height - v_height);
 
-    } else if (macro->kind() == MacroKind::CONCATENATE) {
-      force_expand = true;
-    }
   } else {
-    macro = std::get<MacroVAOpt>(sub);
+    scroll_y = 0;
   }
+}
 
-  const RawEntityId macro_id = macro->id().Pack();
-
-  // Keep track of which macros were expanded.
-  auto expanded = force_expand || macros_to_expand.contains(macro_id);
-
-  if (def_id != kInvalidEntityId) {
-    expanded = expanded || macros_to_expand.contains(def_id);
-    b.scene.expanded_macros.emplace(def_id, expanded);
+// Bring what's on screen in line with `scroll_x` and `scroll_y`. If nothing
+// else needs repainting, then we shift what's already on screen, and only the
+// newly exposed strips get repainted.
+void CodeWidget::PrivateData::UpdateAfterScroll(CodeWidget *self) {
+  QPoint scroll(scroll_x, scroll_y);
+  QPoint delta = painted_scroll - scroll;
+  if (delta.isNull()) {
+    return;
   }
-  b.scene.expanded_macros.emplace(macro_id, expanded);
 
-  // Keep track of macro locations.
-  b.scene.entity_begin_offset.emplace(
-      macro_id, static_cast<unsigned>(b.scene.entities.size()));
+  painted_scroll = scroll;
 
-  if (expanded) {
-    if (!b.expansion_depth) {
-      b.macro_use_tokens = macro->use_tokens().file_tokens();
-    }
-    ++b.expansion_depth;
+  // NOTE: With fractional DPI ratios, a shift by some number of logical
+  //       pixels may not be a whole number of device pixels, and so what
+  //       is on screen can't be reused.
+  qreal device_dx = delta.x() * dpi_ratio;
+  qreal device_dy = delta.y() * dpi_ratio;
 
-    ImportNode(b, node.after());
-    --b.expansion_depth;
+  if (scene_changed || canvas_changed || styles_changed ||
+      std::abs(delta.x()) >= viewport.width() ||
+      std::abs(delta.y()) >= viewport.height() ||
+      device_dx != std::round(device_dx) ||
+      device_dy != std::round(device_dy)) {
+    self->update();
   } else {
-    ImportNode(b, node.before());
-  }
-}
-
-// Import a sequence of nodes.
-void CodeWidget::PrivateData::ImportSequenceNode(
-    SceneBuilder &b, SequenceTokenTreeNode node) {
-  for (auto child_node : node.children()) {
-    ImportNode(b, std::move(child_node));
+    self->scroll(delta.x(), delta.y(), viewport);
   }
 }
 
-// Import a node containing a token.
-void CodeWidget::PrivateData::ImportTokenNode(
-    SceneBuilder &b, TokenTokenTreeNode node) {
-
-  // Get the data of this token in Qt's native format.
-  Token token = node.token();
-  std::string_view utf8_data = token.data();
-  if (utf8_data.empty()) {
+// Repaint what changed because the cursor moved. Moving the cursor within the
+// current entity only changes the cursor itself, and maybe the current line.
+// Anything else changes the highlights or the selection, which could be
+// anywhere on screen.
+void CodeWidget::PrivateData::UpdateCursorArea(CodeWidget *self) {
+  if (current_entity != painted_entity || selection_start_cursor ||
+      painted_selection || painted_scroll != QPoint(scroll_x, scroll_y)) {
+    self->update();
     return;
   }
 
-  QString utf16_data = QString::fromUtf8(
-      utf8_data.data(), static_cast<qsizetype>(utf8_data.size()));
-
-  RawEntityId related_entity_id = token.related_entity_id().Pack();
-  if (related_entity_id != kInvalidEntityId) {
-
-    // Support entity renaming.
-    if (auto rename_it = new_entity_names.find(related_entity_id);
-        rename_it != new_entity_names.end()) {
-      utf16_data = rename_it.value();
-    }
+  QRegion dirty;
+  if (painted_cursor) {
+    dirty += CursorRect(painted_cursor.value());
   }
 
-  // The new name is empty. That's weird.
-  if (utf16_data.isEmpty()) {
-    Q_ASSERT(false);
-    return;
+  if (cursor) {
+    dirty += CursorRect(cursor.value());
   }
 
-  b.BeginToken(token);
-
-  for (QChar ch : utf16_data) {
-    switch (ch.unicode()) {
-
-      // TODO(pag): Configurable tab width; tab stops
-      case QChar::Tabulation:
-        for (auto i = 0u; i < kTabWidth; ++i) {
-          b.AddChar(QChar::Space);
-        }
-        break;
-
-      case QChar::Space:
-      case QChar::Nbsp:
-        b.AddChar(QChar::Space);
-        break;
-
-      case QChar::ParagraphSeparator:
-      case QChar::LineFeed:
-      case QChar::LineSeparator: {
-        b.AddNewLine();
-        break;
-      }
-
-      case QChar::CarriageReturn:
-        continue;
-
-      default:
-        b.AddChar(ch);
-        break;
-    }
+  if (current_line_index != painted_line_index) {
+    dirty += LineRect(painted_line_index);
+    dirty += LineRect(current_line_index);
   }
 
-  b.EndToken(std::move(token));
-}
-
-// Import a generic node, dispatching to the relevant node.
-void CodeWidget::PrivateData::ImportNode(SceneBuilder &b, TokenTreeNode node) {
-  switch (node.kind()) {
-    case TokenTreeNodeKind::EMPTY:
-      break; 
-    case TokenTreeNodeKind::TOKEN:
-      ImportTokenNode(
-          b, std::move(reinterpret_cast<TokenTokenTreeNode &&>(node)));
-      break;
-    case TokenTreeNodeKind::CHOICE:
-      ImportChoiceNode(
-          b, std::move(reinterpret_cast<ChoiceTokenTreeNode &&>(node)));
-      break;
-    case TokenTreeNodeKind::SUBSTITUTION:
-      ImportSubstitutionNode(
-          b, std::move(reinterpret_cast<SubstitutionTokenTreeNode &&>(node)));
-      break;
-    case TokenTreeNodeKind::SEQUENCE:
-      ImportSequenceNode(
-          b, std::move(reinterpret_cast<SequenceTokenTreeNode &&>(node)));
-      break;
+  if (!dirty.isEmpty()) {
+    self->update(dirty);
   }
 }
 
-// Scroll the window by a specific delta.
-void CodeWidget::PrivateData::ScrollBy(
-    int horizontal_pixel_delta, int vertical_pixel_delta) {
-
-  auto c_width = static_cast<int>(foreground_canvas.width() / dpi_ratio);
-  auto c_height = static_cast<int>(foreground_canvas.height() / dpi_ratio);
-
-  auto v_width = viewport.width();
-  auto v_height = viewport.height();
+// Return the area of the viewport covered by the cursor at `cursor_pos`.
+QRect CodeWidget::PrivateData::CursorRect(QPointF cursor_pos) const {
+  QRectF rect(cursor_pos.x() + kCursorDisp - scroll_x,
+              cursor_pos.y() - scroll_y, kCursorWidth, line_height);
 
-  if (c_width > v_width) {
-    scroll_x = std::min(
-        std::max(0, scroll_x + horizontal_pixel_delta),
-        c_width - v_width);
+  // Account for anti-aliasing.
+  return rect.toAlignedRect().adjusted(-1, -1, 1, 1);
+}
 
-  } else {
-    scroll_x = 0;
+// Return the area of the viewport covered by the logical line at index
+// `line_index`.
+QRect CodeWidget::PrivateData::LineRect(int line_index) const {
+  if (line_index == -1) {
+    return {};
   }
 
-  if (c_height > v_height) {
-    scroll_y = std::min(
-        std::max(0, scroll_y + vertical_pixel_delta),
-        c_height - v_height);
-
-  } else {
-    scroll_y = 0;
-  }
+  return QRect(0, (line_index * line_height) - scroll_y,
+               viewport.width(), line_height);
 }
 
 // Return the character offset (`-1` if invalid) to the right of `point` (the
@@ -925,30 +676,65 @@ std::pair<int, qreal> CodeWidget::PrivateData::CharacterPosition(
 std::pair<int, qreal> CodeWidget::PrivateData::CharacterPositionVariable(
     QPointF point, const Entity *entity) const {
 
-  auto text_data_index = entity->data_index_and_config >> kFormatShift;
-  auto text_config_index = entity->data_index_and_config & kFormatMask;
-  const Data *data = &(scene.data[text_data_index]);
+  const qreal entity_x = LayoutOf(entity).x;
+  const QStringView text = scene->Text(entity->data_index);
 
   const qreal x = point.x();
 
   // The cursor comes before `entity`.
-  if (entity->x > x) {
+  if (entity_x > x) {
     return {-1, 0.0};
   }
 
-  Q_ASSERT(entity->x >= left_margin);
+  Q_ASSERT(entity_x >= left_margin);
 
   qreal line_index = entity->logical_line_number - 1;
-  QRectF text_rect = data->bounding_rect[text_config_index];
+  QRectF text_rect = BoundingRectOf(entity);
   qreal entity_y = line_index * line_height;
 
-  text_rect.moveTo(QPointF(entity->x, entity_y));
+  text_rect.moveTo(QPointF(entity_x, entity_y));
   if (!text_rect.contains(point)) {
     return {-1, 0.0};
   }
 
-  QPixmap dummy_pixmap(static_cast<int>(text_rect.width()),
-                       static_cast<int>(text_rect.height()));
+  // The cursor falls inside of an existing entity text. Find the first
+  // character that ends beyond where the user clicked.
+  const std::vector<qreal> &offsets = CharacterOffsets(entity);
+  auto it = std::upper_bound(offsets.begin(), offsets.end(), x - entity_x);
+
+  // Falls beyond the last letter, e.g. into the italic overhang.
+  if (it == offsets.end()) {
+    return {static_cast<int>(text.size()), offsets.back()};
+  }
+
+  auto k = static_cast<int>(it - offsets.begin());
+  Q_ASSERT(0 < k);
+
+  qreal prev_width = offsets[static_cast<unsigned>(k - 1)];
+  auto half = (*it - prev_width) / 2;
+
+  // Falls to the left of this letter.
+  if ((entity_x + prev_width + half) > x) {
+    return {k - 1, prev_width};
+
+  // Falls to the right of this letter.
+  } else {
+    return {k, *it};
+  }
+}
+
+// Return the widths of the prefixes of the data of `entity`, measuring them
+// the first time they're needed.
+const std::vector<qreal> &CodeWidget::PrivateData::CharacterOffsets(
+    const Entity *entity) const {
+  auto text_config_index = LayoutOf(entity).config;
+  auto key = (static_cast<uint64_t>(entity->data_index) << 2u) |
+             text_config_index;
+
+  std::vector<qreal> &offsets = character_offsets[key];
+  if (!offsets.empty()) {
+    return offsets;
+  }
 
   // Configure the font based on the formatting of the entity. The bold/italic
   // affects character sizes.
@@ -960,38 +746,50 @@ std::pair<int, qreal> CodeWidget::PrivateData::CharacterPositionVariable(
     font.setItalic(true);
   }
 
-  QPainter p(&dummy_pixmap);
-  InitializePainterOptions(p);
-  p.setFont(font);
+  // Measure on an image with the same device pixel ratio as our tiles, so
+  // that the measurements match what gets painted.
+  QImage measure_image(1, 1, QImage::Format_ARGB32_Premultiplied);
+  measure_image.setDevicePixelRatio(dpi_ratio);
 
-  // The cursor falls inside of an existing entity text. We'll calculate the
-  // width of the text. We go one character at a time, building up
-  // successively longer prefixes of `data->text` until we find that we've
-  // moved just beyond where the user clicked.
-  qreal prev_width = 0;
-  for (auto k = 1; k <= data->text.size(); ++k) {
-    auto prefix = data->text.sliced(0, k);
+  QString text = scene->Text(entity->data_index).toString();
+  QTextLayout text_layout(text, font, &measure_image);
+  text_layout.setTextOption(to);
+  text_layout.beginLayout();
+  QTextLine line = text_layout.createLine();
+  text_layout.endLayout();
 
-    auto prefix_rect = p.boundingRect(text_rect, prefix, to);
+  offsets.reserve(static_cast<size_t>(text.size()) + 1u);
+  offsets.push_back(0);
+  for (auto k = 1; k <= text.size(); ++k) {
+    offsets.push_back(std::max(offsets.back(), line.cursorToX(k)));
+  }
 
-    if (prefix_rect.contains(point)) {
-      auto half = (prefix_rect.width() - prev_width) / 2;
+  return offsets;
+}
 
-      // Falls to the left of this letter.
-      if ((entity->x + prev_width + half) > x) {
-        return {k - 1, prev_width};
+// Return the last entity on the logical line at index `line_index` that
+// begins at or before `x`. Entities on a line are sorted by their `x`.
+const Entity *CodeWidget::PrivateData::LastEntityAtOrBefore(
+    unsigned line_index, qreal x) const {
+  if (line_index == std::numeric_limits<unsigned>::max() ||
+      (line_index + 1u) >= scene->logical_line_index.size()) {
+    return nullptr;
+  }
 
-      // Falls to the right of this letter.
-      } else {
-        return {k, prefix_rect.width()};
-      }
-    }
+  auto begin = scene->logical_line_index[line_index];
+  auto end = scene->logical_line_index[line_index + 1u];
+  auto it = std::upper_bound(
+      entity_layout.begin() + begin, entity_layout.begin() + end, x,
+      [] (qreal x, const EntityLayout &el) {
+        return x < el.x;
+      });
 
-    prev_width = prefix_rect.width();
+  auto i = static_cast<unsigned>(it - entity_layout.begin());
+  if (i == begin) {
+    return nullptr;
   }
 
-  Q_ASSERT(false);
-  return {-1, 0.0};
+  return &(scene->entities[i - 1u]);
 }
 
 // Return the character offset (`-1` if invalid) to the right of `point` (the
@@ -1000,22 +798,20 @@ std::pair<int, qreal> CodeWidget::PrivateData::CharacterPositionVariable(
 std::pair<int, qreal> CodeWidget::PrivateData::CharacterPositionFixed(
     QPointF point, const Entity *entity) const {
 
-  auto text_data_index = entity->data_index_and_config >> kFormatShift;
-  auto text_config_index = entity->data_index_and_config & kFormatMask;
-  const Data *data = &(scene.data[text_data_index]);
+  const qreal entity_x = LayoutOf(entity).x;
 
   qreal x = point.x();
 
   // The cursor comes before `entity`.
-  if (entity->x > x) {
+  if (entity_x > x) {
     return {-1, 0.0};
   }
 
   qreal line_index = entity->logical_line_number - 1;
-  QRectF text_rect = data->bounding_rect[text_config_index];
+  QRectF text_rect = BoundingRectOf(entity);
   qreal entity_y = line_index * line_height;
 
-  text_rect.moveTo(QPointF(entity->x, entity_y));
+  text_rect.moveTo(QPointF(entity_x, entity_y));
   if (!text_rect.contains(point)) {
     return {-1, 0.0};
   }
@@ -1068,7 +864,7 @@ QPointF CodeWidget::PrivateData::CursorPositionFixed(QPointF point) const {
 //            `scroll_y`.
 QPointF CodeWidget::PrivateData::CursorPositionVariable(QPointF point) const {
 
-  if (scene.entities.empty()) {
+  if (scene->entities.empty()) {
     return CursorPositionFixed(point);
   }
 
@@ -1076,63 +872,49 @@ QPointF CodeWidget::PrivateData::CursorPositionVariable(QPointF point) const {
   auto y = point.y();
 
   auto line_index = static_cast<unsigned>(std::floor(y / line_height));
-  if (line_index == std::numeric_limits<unsigned>::max() ||
-     (line_index + 1u) >= scene.logical_line_index.size()) {
+
+  // There are no entities on this line, or the cursor is before all of them.
+  const Entity *prev_entity = LastEntityAtOrBefore(line_index, x);
+  if (!prev_entity) {
     return CursorPositionFixed(point);
   }
 
-  auto i = scene.logical_line_index[line_index];
-  auto max_i = scene.logical_line_index[line_index + 1u];
-
-  const Entity *prev_entity = nullptr;
-  const Entity *entity = nullptr;
-
-  for (; i < max_i; ++i, prev_entity = entity) {
-    entity = &(scene.entities[i]);
-    Q_ASSERT(entity->logical_line_number == static_cast<int>(line_index + 1u));
-
-    // The cursor comes before `entity`.
-    if (entity->x > x) {
-      break;
-    }
+  Q_ASSERT(prev_entity->logical_line_number ==
+           static_cast<int>(line_index + 1u));
 
+  // The cursor may be inside of `prev_entity`, or inside of the entity before
+  // it, if that one is italic and leans into `prev_entity`.
+  auto line_begin = &(scene->entities[scene->logical_line_index[line_index]]);
+  for (auto entity = std::max(line_begin, prev_entity - 1);
+       entity <= prev_entity; ++entity) {
     auto [k, prefix_width] = CharacterPositionVariable(point, entity);
     if (k != -1) {
-      return QPointF(entity->x + prefix_width,
+      return QPointF(LayoutOf(entity).x + prefix_width,
                      static_cast<qreal>(line_index) * line_height);
     }
   }
 
-  // There are no entities on this line, or there is no previous entity, and so
-  // the cursor is before it.
-  if (!entity || !prev_entity) {
-    return CursorPositionFixed(point);
-  }
-
   // The cursor is between two entities. Translate the point so that it's
   // as though there is no previous entity, then it's just about whitespace
   // calculation.
-  const Data *prev_data = &(scene.data[
-      prev_entity->data_index_and_config >> kFormatShift]);
-  QRectF r = prev_data->bounding_rect[
-      prev_entity->data_index_and_config & kFormatMask];
+  QRectF r = BoundingRectOf(prev_entity);
+  qreal prev_x = LayoutOf(prev_entity).x;
 
-  r.moveTo(prev_entity->x, 0);
+  r.moveTo(prev_x, 0);
 
-  auto adj_pos = CursorPositionFixed(
-      QPointF(x - (prev_entity->x + r.width()), y));
+  auto adj_pos = CursorPositionFixed(QPointF(x - (prev_x + r.width()), y));
 
   // Readjust to account for the size of `prev_entity`.
-  return QPointF(adj_pos.x() + r.width() + prev_entity->x, adj_pos.y());
+  return QPointF(adj_pos.x() + r.width() + prev_x, adj_pos.y());
 }
 
 // Always have margin on both sides margin, and keep the cursor in-
 // bounds.
 QPointF CodeWidget::PrivateData::ClampCursorPosition(QPointF point) const {
-  qreal c_width = foreground_canvas.width() / dpi_ratio;
+  qreal c_width = canvas_rect.width();
   qreal v_width = viewport.width();
 
-  qreal c_height = foreground_canvas.height() / dpi_ratio;
+  qreal c_height = canvas_rect.height();
   qreal v_height = viewport.height();
   return QPointF(
       std::max(
@@ -1141,7 +923,7 @@ QPointF CodeWidget::PrivateData::ClampCursorPosition(QPointF point) const {
       std::max<qreal>(
           0,
           std::min(std::max(c_height - line_height, v_height - line_height),
-                   std::min<qreal>(line_height * scene.num_lines, point.y()))));
+                   std::min<qreal>(line_height * scene->num_lines, point.y()))));
 }
 
 // Locate the next cursor position (left or right, up or down).
@@ -1177,21 +959,31 @@ QPointF CodeWidget::PrivateData::NextCursorPositionFixed(
 QPointF CodeWidget::PrivateData::NextCursorPositionVariable(
     QPointF curr_cursor, qreal dir_x, qreal dir_y) const {
 
-  // Hopefully sixteenths of the space width are smaller than the smallest
-  // horizontal advance of a character in the font.
-  auto incr = (space_width / 16.0) * dir_x;
-
-  // Opportunistically search for the next X position of the cursor.
+  // If the character next to the cursor belongs to an entity, then look up
+  // its width; otherwise it's whitespace.
   qreal char_width = space_width;
   if (dir_x != 0) {
     auto curr_x = curr_cursor.x();
-    auto guess_x = curr_x;
-    for (; guess_x >= space_width; ) {
-      guess_x += incr;
-      auto new_x = CursorPositionVariable(QPointF(guess_x, curr_cursor.y())).x();
-      if (new_x != curr_x) {
-        char_width = std::abs(new_x - curr_x);
-        break;
+    auto probe_x = curr_x + (dir_x < 0 ? -0.5 : 0.5);
+    auto line_index = static_cast<unsigned>(
+        std::floor(curr_cursor.y() / line_height));
+
+    if (auto entity = LastEntityAtOrBefore(line_index, probe_x)) {
+      const std::vector<qreal> &offsets = CharacterOffsets(entity);
+      auto rel_x = curr_x - LayoutOf(entity).x;
+
+      // Find the character boundary nearest to the cursor, then the width of
+      // the character on the relevant side of it.
+      auto it = std::lower_bound(offsets.begin(), offsets.end(), rel_x);
+      if (it == offsets.end() ||
+          (it != offsets.begin() && (rel_x - it[-1]) < (*it - rel_x))) {
+        --it;
+      }
+
+      if (dir_x < 0 && it != offsets.begin()) {
+        char_width = *it - it[-1];
+      } else if (dir_x > 0 && (it + 1) != offsets.end()) {
+        char_width = it[1] - *it;
       }
     }
   }
@@ -1205,7 +997,7 @@ QPointF CodeWidget::PrivateData::NextCursorPositionVariable(
 // NOTE(pag): `point` should already be translated by the `scroll_x` and
 //            `scroll_y`.
 const Entity *CodeWidget::PrivateData::EntityUnderPoint(QPointF point) const {
-  if (scene.entities.empty()) {
+  if (scene->entities.empty()) {
     return nullptr;
   }
 
@@ -1213,27 +1005,20 @@ const Entity *CodeWidget::PrivateData::EntityUnderPoint(QPointF point) const {
   auto y = point.y();
 
   auto line_index = static_cast<unsigned>(std::floor(y / line_height));
-  if ((line_index + 1u) >= scene.logical_line_index.size()) {
+  const Entity *last = LastEntityAtOrBefore(line_index, x);
+  if (!last) {
     return nullptr;
   }
 
-  auto i = scene.logical_line_index[line_index];
-  auto max_i = scene.logical_line_index[line_index + 1u];
-
-  for (; i < max_i; ++i) {
-    const Entity &e = scene.entities[i];
-    if (e.x > x) {
-      continue;
-    }
-
-    const Data &data = scene.data[e.data_index_and_config >> kFormatShift];
-    QRectF r = data.bounding_rect[e.data_index_and_config & kFormatMask];
-
-    qreal e_y = static_cast<qreal>(line_index) * line_height;
-
-    r.moveTo(QPointF(e.x, e_y));
+  // The point is most likely in `last`, but could also be in the entity
+  // before it, if that one is italic and leans into `last`.
+  qreal e_y = static_cast<qreal>(line_index) * line_height;
+  auto line_begin = &(scene->entities[scene->logical_line_index[line_index]]);
+  for (auto e = std::max(line_begin, last - 1); e <= last; ++e) {
+    QRectF r = BoundingRectOf(e);
+    r.moveTo(QPointF(LayoutOf(e).x, e_y));
     if (r.contains(point)) {
-      return &e;
+      return e;
     }
   }
 
@@ -1243,8 +1028,8 @@ const Entity *CodeWidget::PrivateData::EntityUnderPoint(QPointF point) const {
 std::pair<const Entity *, int> CodeWidget::PrivateData::EntityAtDocumentOffset(
     int offset) const {
 
-  auto it_begin = scene.begin_of_entity_in_document.begin();
-  auto it_end = scene.begin_of_entity_in_document.end();
+  auto it_begin = scene->begin_of_entity_in_document.begin();
+  auto it_end = scene->begin_of_entity_in_document.end();
   auto it = std::upper_bound(it_begin, it_end, offset);
   if (it == it_begin) {
     return {nullptr, -1};
@@ -1254,16 +1039,15 @@ std::pair<const Entity *, int> CodeWidget::PrivateData::EntityAtDocumentOffset(
 
   for (; it != it_end; ++it) {
     auto eo = static_cast<unsigned>(it - it_begin);
-    const Entity *entity = &(scene.entities[eo]);
-    auto begin_offset = scene.begin_of_entity_in_document[eo];
+    const Entity *entity = &(scene->entities[eo]);
+    auto begin_offset = scene->begin_of_entity_in_document[eo];
     if (begin_offset > offset) {
       break;
     }
 
-    const Data &data = scene.data[
-        entity->data_index_and_config >> kFormatShift];
+    const Data &data = scene->data[entity->data_index];
 
-    if ((begin_offset + data.text.size()) < offset) {
+    if ((begin_offset + static_cast<int>(data.text_length)) < offset) {
       continue;
     }
 
@@ -1274,13 +1058,17 @@ std::pair<const Entity *, int> CodeWidget::PrivateData::EntityAtDocumentOffset(
   return {nullptr, -1};
 }
 
-CodeWidget::~CodeWidget(void) {}
+CodeWidget::~CodeWidget(void) {
+
+  // Cancel any in-progress scene build.
+  d->scene_version_number->fetch_add(1u);
+}
 
 CodeWidget::CodeWidget(const ConfigManager &config_manager,
                        const QString &model_id, bool browse_mode,
                        QWidget *parent)
     : IWindowWidget(parent),
-      d(new PrivateData(model_id)) {
+      d(new PrivateData(config_manager.TaskManager(), model_id)) {
 
   config_manager.ActionManager().Register(
       this, "com.trailofbits.action.ToggleBrowseMode",
@@ -1289,6 +1077,7 @@ CodeWidget::CodeWidget(const ConfigManager &config_manager,
   d->browse_mode = browse_mode;
 
   d->vertical_scrollbar = new QScrollBar(Qt::Vertical, this);
+  d->scroll_marker = new ScrollMarkerWidget(this);
   d->vertical_scrollbar->setSingleStep(1);
   connect(d->vertical_scrollbar, &QScrollBar::valueChanged, this,
           &CodeWidget::OnVerticalScroll);
@@ -1340,6 +1129,7 @@ CodeWidget::CodeWidget(const ConfigManager &config_manager,
   horizontal_layout->setContentsMargins(0, 0, 0, 0);
   horizontal_layout->setSpacing(0);
   horizontal_layout->addLayout(vertical_layout, 1);
+  horizontal_layout->addWidget(d->scroll_marker);
   horizontal_layout->addWidget(d->vertical_scrollbar);
 
   auto search_layout = new QVBoxLayout;
@@ -1353,15 +1143,31 @@ CodeWidget::CodeWidget(const ConfigManager &config_manager,
 
   d->search_widget->hide();
   d->vertical_scrollbar->hide();
+  d->scroll_marker->hide();
   d->horizontal_scrollbar->hide();
   d->code_area->installEventFilter(this);
 
   setFocusPolicy(Qt::StrongFocus);
   setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 
+  // We paint every pixel of the viewport. This lets `QWidget::scroll` shift
+  // what's on screen, instead of asking us to repaint everything.
+  setAttribute(Qt::WA_OpaquePaintEvent);
+
+  d->prefetch_timer.setSingleShot(true);
+  d->prefetch_timer.setInterval(0);
+  connect(&d->prefetch_timer, &QTimer::timeout,
+          this, [this] (void) {
+            if (d->PrefetchTiles()) {
+              d->prefetch_timer.start();
+            }
+          });
+
+  d->file_location_cache = config_manager.FileLocationCache();
+
   auto &theme_manager = config_manager.ThemeManager();
 
-  OnThemeChanged(theme_manager);  // Calls `RecomputeScene`.
+  OnThemeChanged(theme_manager);  // Marks the scene as changed.
 
   connect(&config_manager, &ConfigManager::IndexChanged,
           this, &CodeWidget::OnIndexChanged);
@@ -1396,7 +1202,7 @@ void CodeWidget::focusOutEvent(QFocusEvent *) {
       emit LocationChanged(kExternalFocusChange);
     }
 
-    update();
+    d->UpdateCursorArea(this);
   }
 }
 
@@ -1408,7 +1214,6 @@ bool CodeWidget::eventFilter(QObject *object, QEvent *event) {
       QSize new_size = re->size();
       d->viewport.setWidth(new_size.width());
       d->viewport.setHeight(new_size.height());
-      d->RecomputeLineNumbers();
       d->UpdateScrollbars();
       update();
 
@@ -1446,7 +1251,7 @@ bool CodeWidget::eventFilter(QObject *object, QEvent *event) {
             is_clickable = d->hovered_entity.is_clickable;
 
           } else {
-            const auto &token = d->scene.tokens[entity->token_index];
+            const auto &token = d->scene->tokens[entity->token_index];
             auto variant_id = token.related_entity_id().Unpack();
 
             is_clickable = std::holds_alternative<MacroId>(variant_id) ||
@@ -1469,7 +1274,7 @@ bool CodeWidget::eventFilter(QObject *object, QEvent *event) {
       setCursor(cursor_type);
 
       if (request_update) {
-        update();
+        d->UpdateCursorArea(this);
       }
     }
   }
@@ -1513,26 +1318,63 @@ void CodeWidget::wheelEvent(QWheelEvent *event) {
   emit LocationChanged(kExternalScrollChange);
 }
 
-void CodeWidget::paintEvent(QPaintEvent *) {
-  
+// Paint the part of the viewport covered by `event`. Scrolling shifts what is
+// already on screen (see `UpdateAfterScroll`), and moving the cursor only
+// invalidates what it touches (see `UpdateCursorArea`), so usually only a
+// small part of the viewport is repainted.
+void CodeWidget::paintEvent(QPaintEvent *event) {
+  QElapsedTimer paint_timer;
+  paint_timer.start();
+
   // Check if the DPI ratio has changed.
   if (auto window = QApplication::activeWindow()) {
     auto window_dpi_ratio = window->devicePixelRatio();
     if (window_dpi_ratio != d->dpi_ratio) {
       d->dpi_ratio = window_dpi_ratio;
       d->canvas_changed = true;
-      d->scene_changed = true;
+      d->ClearMeasurements();
     }
   }
 
-  d->RecomputeCanvas();
+  auto repaint_everything =
+      d->scene_changed || d->canvas_changed || d->styles_changed ||
+      d->painted_scroll != QPoint(d->scroll_x, d->scroll_y);
+
+  d->RecomputeCanvas(this);
+  d->UpdateScrollMarkers();
+
+  // If something changed everywhere but we were only asked to repaint part
+  // of the viewport, then go paint everything in the next pass instead. The
+  // painter is clipped to the dirty part, so painting it now would show a
+  // half-updated frame.
+  QRect dirty_rect = event->rect().intersected(d->viewport);
+  if (repaint_everything && dirty_rect != d->viewport) {
+    update();
+    return;
+  }
+
+  d->tile_cache.BeginFrame();
+
+  QPoint scroll_pos(d->scroll_x, d->scroll_y);
 
   QPainter blitter(this);
   InitializePainterOptions(blitter);
 
+  // Go get (and possibly rasterize) the tiles that intersect the dirty part
+  // of the viewport. These are copies, so they stay alive even if the cache
+  // evicts them.
+  QRect canvas_dirty_rect = dirty_rect.translated(scroll_pos);
+  QPointF scroll_origin(scroll_pos);
+
+  std::vector<std::pair<QPointF, Tile>> code_tiles;
+  for (TileKey key : d->CodeTileKeys(canvas_dirty_rect)) {
+    code_tiles.emplace_back(d->TileOrigin(key) - scroll_origin,
+                            d->GetTile(key));
+  }
+
   // ---------------------------------------------------------------------------
   // Fill the viewport with the theme background color.
-  blitter.fillRect(d->viewport, d->theme_background_color);
+  blitter.fillRect(dirty_rect, d->theme_background_color);
 
   // ---------------------------------------------------------------------------
   // Render current line within the canvas.
@@ -1547,14 +1389,18 @@ void CodeWidget::paintEvent(QPaintEvent *) {
   // ---------------------------------------------------------------------------
   // Draw the code background layer. If any tokens have background colors then
   // they are in this layer.
-  blitter.drawImage(-d->scroll_x, -d->scroll_y, d->background_canvas);
+  for (const auto &[origin, tile] : code_tiles) {
+    if (!tile.background.isNull()) {
+      blitter.drawImage(origin, tile.background);
+    }
+  }
 
   // ---------------------------------------------------------------------------
   // Draw the entity highlights. If the cursor is on an token, then all tokens
   // with the same related entity IDs are highlighted. Here, we only actually
   // change the background color.
   if (d->current_entity) {
-    blitter.drawImage(-d->scroll_x, -d->scroll_y, d->highlight_canvas);
+    d->PaintHighlights(blitter, canvas_dirty_rect);
   }
 
   // ---------------------------------------------------------------------------
@@ -1566,11 +1412,16 @@ void CodeWidget::paintEvent(QPaintEvent *) {
 
   // ---------------------------------------------------------------------------
   // Draw the line numbers.
-  blitter.drawImage(-d->scroll_x, -d->scroll_y, d->line_number_canvas);
+  for (TileKey key : d->GutterTileKeys(canvas_dirty_rect)) {
+    blitter.drawImage(d->TileOrigin(key) - scroll_origin,
+                      d->GetTile(key).foreground);
+  }
 
   // ---------------------------------------------------------------------------
   // Paint the code.
-  blitter.drawImage(-d->scroll_x, -d->scroll_y, d->foreground_canvas);
+  for (const auto &[origin, tile] : code_tiles) {
+    blitter.drawImage(origin, tile.foreground);
+  }
 
   // ---------------------------------------------------------------------------
   // Paint the cursor.
@@ -1581,6 +1432,23 @@ void CodeWidget::paintEvent(QPaintEvent *) {
   }
 
   blitter.end();
+
+  d->painted_scroll = scroll_pos;
+  d->painted_cursor = d->cursor;
+  d->painted_line_index = d->current_line_index;
+  d->painted_entity = d->current_entity;
+  d->painted_selection = d->cursor && d->selection_start_cursor;
+
+  // Rasterize the tiles around the viewport once we're idle, so that they're
+  // ready if the user scrolls.
+  d->prefetch_timer.start();
+
+  if (d->paint_times.size() < kNumPaintTimes) {
+    d->paint_times.push_back(paint_timer.nsecsElapsed());
+  } else {
+    d->paint_times[d->num_paints % kNumPaintTimes] = paint_timer.nsecsElapsed();
+  }
+  ++d->num_paints;
 }
 
 void CodeWidget::mouseReleaseEvent(QMouseEvent *event) {
@@ -1682,16 +1550,16 @@ void CodeWidget::mousePressEvent(QMouseEvent *event) {
   d->current_entity = entity;
 
   // Update *prior* to rendering the context menu, if any.
-  update();
+  d->UpdateCursorArea(this);
 
   // Update the selection in the model.
   d->token_model.selection.clear();
   auto sel_size = d->selection_end_offset - d->selection_start_offset;
   if (d->selection_start_cursor && 0 <= d->selection_start_offset &&
       0 <= d->selection_end_offset && 0 < sel_size &&
-      (d->selection_start_offset + sel_size) <= d->scene.document.size()) {
+      (d->selection_start_offset + sel_size) <= d->scene->document.size()) {
     d->token_model.selection
-        = d->scene.document.sliced(d->selection_start_offset, sel_size);
+        = d->scene->document.sliced(d->selection_start_offset, sel_size);
   }
 
   // Calculate the index of the current line.
@@ -1799,9 +1667,9 @@ void CodeWidget::keyPressEvent(QKeyEvent *event) {
       } else if (ks == kFindKeqSequence) {
         d->search_widget->show();
 
-      } else if (ks == kGotoLineKeqSequence && d->scene.num_file_lines) {
+      } else if (ks == kGotoLineKeqSequence && d->scene->num_file_lines) {
         d->goto_line_widget->Activate(
-            static_cast<unsigned>(d->scene.num_file_lines));
+            static_cast<unsigned>(d->scene->num_file_lines));
 
       // Otherwise, request a generic keypress handler.
       } else if (d->current_entity && d->cursor) {
@@ -1819,7 +1687,7 @@ void CodeWidget::keyPressEvent(QKeyEvent *event) {
 
   if (!d->cursor || (dx == 0 && dy == 0)) {
     if (need_repaint) {
-      update();
+      d->UpdateCursorArea(this);
     }
     return;
   }
@@ -1892,7 +1760,7 @@ void CodeWidget::keyPressEvent(QKeyEvent *event) {
   });
 
   if (need_repaint) {
-    update();
+    d->UpdateCursorArea(this);
   }
 
   emit LocationChanged(kExternalKeyPress);
@@ -1900,9 +1768,10 @@ void CodeWidget::keyPressEvent(QKeyEvent *event) {
 
 void CodeWidget::PrivateData::UpdateScrollbars(void) {
 
-  if (scene.entities.empty()) {
+  if (scene->entities.empty()) {
     horizontal_scrollbar->hide();
     vertical_scrollbar->hide();
+    scroll_marker->hide();
     return;
   }
 
@@ -1926,16 +1795,20 @@ void CodeWidget::PrivateData::UpdateScrollbars(void) {
     vertical_scrollbar->show();
     vertical_scrollbar->setMinimum(0);
     vertical_scrollbar->setMaximum(static_cast<int>(c_height - v_height));
+    scroll_marker->show();
 
   } else {
     vertical_scrollbar->hide();
     vertical_scrollbar->setMaximum(0);
+    scroll_marker->hide();
   }
 }
 
 // Capture an "opaque" representation of the current location in the code.
 CodeWidget::OpaqueLocation CodeWidget::LastLocation(void) const {
-  if (d->last_location) {
+  if (d->pending_location) {
+    return d->pending_location->first;
+  } else if (d->last_location) {
     return d->last_location.value();
   } else if (0 < d->space_width && 0 < d->line_height) {
     return d->Location();
@@ -1954,20 +1827,20 @@ CodeWidget::OpaquePosition CodeWidget::PrivateData::YDimensionToPosition(
   pos.scale = 0.0;
   pos.physical = 0;
   pos.relative = 0;  // Displacement from the first `physical`.
-  if (0 < y && !scene.physical_line_number.empty()) {
+  if (0 < y && !scene->physical_line_number.empty()) {
 
     pos.scale = y / line_height;
     auto logical = static_cast<int>(std::floor(pos.scale));
-    if (static_cast<unsigned>(logical) >= scene.physical_line_number.size()) {
-      if (scene.physical_line_number.empty()) {
+    if (static_cast<unsigned>(logical) >= scene->physical_line_number.size()) {
+      if (scene->physical_line_number.empty()) {
         return pos;
       } else {
-        pos.physical = scene.physical_line_number.back();
+        pos.physical = scene->physical_line_number.back();
         return pos;
       }
     }
 
-    auto line_nums = scene.physical_line_number.data();
+    auto line_nums = scene->physical_line_number.data();
     pos.physical = std::abs(line_nums[logical]);
 
     for (auto i = logical - 1; 0 <= i; --i, ++pos.relative) {
@@ -1977,7 +1850,7 @@ CodeWidget::OpaquePosition CodeWidget::PrivateData::YDimensionToPosition(
     }
 
     Q_ASSERT(static_cast<unsigned>(logical) <
-             scene.logical_line_index.size());
+             scene->logical_line_index.size());
   }
 
   return pos;
@@ -1993,7 +1866,7 @@ qreal CodeWidget::PrivateData::PositionToYDimension(
   int found = 0;
   auto new_line_index = 0;  // Logical line index.
   auto new_line_index_rel = 0;
-  for (auto new_phy_line : scene.physical_line_number) {
+  for (auto new_phy_line : scene->physical_line_number) {
     if (found && found > pos.relative) {
       break;
     }
@@ -2039,7 +1912,7 @@ CodeWidget::OpaqueLocation CodeWidget::PrivateData::Location(void) {
   loc.scroll_y = YDimensionToPosition(scroll_y);
 
   if (current_entity) {
-    loc.token = scene.tokens[current_entity->token_index];
+    loc.token = scene->tokens[current_entity->token_index];
   }
   
   // Figure out of offset within the current logical line in terms of a scaling
@@ -2068,10 +1941,10 @@ CodeWidget::OpaqueLocation CodeWidget::PrivateData::Location(void) {
     if (auto entity = EntityUnderPoint(cursor.value())) {
       loc.cursor_index = CharacterPosition(cursor.value(), entity).first;
       auto li = static_cast<unsigned>(entity->logical_line_number - 1);
-      auto lie = scene.entities.data() + scene.logical_line_index[li];
+      auto lie = scene->entities.data() + scene->logical_line_index[li];
       for (; lie < entity; ++lie) {
         loc.cursor_index += static_cast<int>(
-            scene.data[lie->data_index_and_config >> kFormatShift].text.size());
+            scene->data[lie->data_index].text_length);
       }
     }
 
@@ -2112,7 +1985,7 @@ void CodeWidget::PrivateData::SetCursor(CodeWidget::OpaqueLocation loc) {
   current_line_index = static_cast<int>(std::floor(pt.y() / line_height));
 
   auto li = static_cast<unsigned>(std::floor(pt.y() / line_height));
-  if (0 < loc.cursor_index && (li + 1u) < scene.logical_line_index.size()) {
+  if (0 < loc.cursor_index && (li + 1u) < scene->logical_line_index.size()) {
     pt.setX(left_margin);
     while (0 < loc.cursor_index) {
       pt = NextCursorPosition(pt, 1, 0);
@@ -2130,9 +2003,9 @@ void CodeWidget::PrivateData::ClampScrollXY(void) {
   auto v_width = viewport.width();
   auto v_height = viewport.height();
   if (v_width && v_height) {
-    auto c_width = static_cast<int>(foreground_canvas.width() / dpi_ratio);
-    auto c_height = static_cast<int>(foreground_canvas.height() / dpi_ratio);
-    
+    auto c_width = canvas_rect.width();
+    auto c_height = canvas_rect.height();
+
     scroll_y = std::max(0, scroll_y);
     if (c_height > v_height) {
       scroll_y = std::min(scroll_y, c_height - v_height);
@@ -2145,34 +2018,179 @@ void CodeWidget::PrivateData::ClampScrollXY(void) {
   }
 }
 
-void CodeWidget::PrivateData::RecomputeScene(void) {
+// Snapshot the sets of entities that configure what gets shown.
+SceneConfiguration CodeWidget::PrivateData::Configuration(void) const {
+  SceneConfiguration config;
+  config.macros_to_expand = macros_to_expand;
+  config.new_entity_names = new_entity_names;
+  config.scene_overrides = scene_overrides;
+  return config;
+}
+
+// Start building a new scene in the background. The current scene stays
+// visible until the new scene is handed to `InstallScene`. If another code
+// widget has already built the same scene then we share it instead.
+void CodeWidget::PrivateData::RecomputeScene(CodeWidget *self) {
   if (!scene_changed) {
     return;
   }
 
-  hovered_entity = {};
+  scene_changed = false;
+  scene_pending = true;
+
+  // Cancel any in-progress build; its results would be stale anyway.
+  auto scene_version = scene_version_number->fetch_add(1u) + 1u;
+
+  SceneConfiguration config = Configuration();
+  std::optional<SceneCacheKey> cache_key;
+  if (scene_cache_id != kInvalidEntityId) {
+    cache_key.emplace(scene_cache_id, config);
+    if (auto cached_scene = SceneCache::Find(cache_key.value())) {
+
+      // Install the scene the same way as a freshly built one, i.e. from the
+      // event loop. We may have been called from `paintEvent`, and installing
+      // a scene can move the scrollbars, take focus, and start searches.
+      QMetaObject::invokeMethod(
+          self,
+          [self, scene_version, cached_scene = std::move(cached_scene)] (void) {
+            self->d->InstallScene(self, scene_version, cached_scene);
+          },
+          Qt::QueuedConnection);
+      return;
+    }
+  }
 
-  // Try to maintain scroll position across scene changes.
-  std::optional<OpaqueLocation> loc;
-  if (0 < space_width && 0 < line_height) {
-    loc = Location();
+  // Only ask for a partial scene if there's nothing to show yet. Replacing a
+  // complete scene with a truncated one would make the scroll position jump
+  // around.
+  auto num_partial_lines = 0;
+  if (scene->entities.empty()) {
+    num_partial_lines = kMinPartialSceneLines;
+    if (0 < line_height) {
+      num_partial_lines = std::max(
+          num_partial_lines, 2 * ((viewport.height() / line_height) + 1));
+    }
   }
 
-  version_number++;
+  auto runnable = new BuildSceneRunnable(
+      token_tree, std::move(config), file_location_cache, num_partial_lines,
+      scene_version_number);
 
-  SceneBuilder builder;  
-  ImportNode(builder, token_tree.root());
+  // Share complete scenes with other code widgets.
+  auto install = [self, cache_key = std::move(cache_key)] (
+      uint64_t scene_version, ScenePtr new_scene) {
+    ConstScenePtr installed_scene = std::move(new_scene);
+    if (self->d->InstallScene(self, scene_version, installed_scene) &&
+        cache_key) {
+      SceneCache::Insert(cache_key.value(), std::move(installed_scene));
+    }
+  };
 
-  scene = builder.TakeScene();
-  scene_changed = false;
-  current_entity = nullptr;
+  QObject::connect(runnable, &BuildSceneRunnable::PartialSceneReady,
+                   self, install, Qt::QueuedConnection);
 
-  if (loc) {
-    SetLocation(std::move(loc.value()));
+  QObject::connect(runnable, &BuildSceneRunnable::SceneReady,
+                   self, install, Qt::QueuedConnection);
+
+  task_manager.Start(runnable, TaskPriority::kInteractive, task_group);
+}
+
+// Replace the current scene with one published by a `BuildSceneRunnable`, or
+// found in the `SceneCache`. Returns `true` if `new_scene` is a complete scene
+// that is now being shown.
+bool CodeWidget::PrivateData::InstallScene(
+    CodeWidget *self, uint64_t scene_version, ConstScenePtr new_scene) {
+  if (!new_scene || scene_version != scene_version_number->load()) {
+    return false;
   }
 
+  auto is_partial = new_scene->is_partial;
+  auto restore_location = false;
+
+  // Try to maintain scroll position across scene changes, or go to where we
+  // were asked to go while the scene was being built.
+  std::optional<OpaqueLocation> loc;
+  bool take_focus = false;
+  if (is_partial) {
+    // Nothing to restore; we weren't showing anything.
+
+  } else if (pending_location) {
+    loc = std::move(pending_location->first);
+    take_focus = pending_location->second;
+    pending_location.reset();
+    restore_location = true;
+
+  } else if (0 < space_width && 0 < line_height && !scene->entities.empty()) {
+    loc = Location();
+  }
+
+  SetScene(std::move(new_scene));
+  scene_pending = is_partial;
+
   // Force a change.
+  styles_changed = true;
   canvas_changed = true;
+  RecomputeCanvas(self);
+
+  if (loc) {
+    TriggerScrollbarUpdate([&, this] (void) {
+      SetLocation(std::move(loc.value()));
+    });
+  }
+
+  self->update();
+
+  if (is_partial) {
+    return false;
+  }
+
+  if (restore_location) {
+    if (take_focus) {
+      self->setFocus();
+    }
+    self->EmitLocationChanged(kExternalSetOpaqueLocation);
+  }
+
+  // Search results are offsets into the document, so they need to be redone.
+  if (!search_widget->Parameters().pattern.empty() &&
+      search_widget->isVisible()) {
+    self->OnSearchParametersChange();
+  }
+
+  if (pending_line_number) {
+    auto line = pending_line_number.value();
+    pending_line_number.reset();
+    self->OnGoToLineNumber(line);
+  }
+
+  if (pending_go_to_entity) {
+    auto [entity, focus] = std::move(pending_go_to_entity.value());
+    pending_go_to_entity.reset();
+    self->OnGoToEntity(entity, focus);
+  }
+
+  return true;
+}
+
+// Switch to showing `new_scene`. None of the layout of the old scene carries
+// over, as the data of the two scenes is unrelated.
+void CodeWidget::PrivateData::SetScene(ConstScenePtr new_scene) {
+  hovered_entity = {};
+  current_entity = nullptr;
+  scene = std::move(new_scene);
+  entity_layout.clear();
+  entity_layout.resize(scene->entities.size());
+  ClearMeasurements();
+  markers_changed = true;
+  version_number++;
+}
+
+// Forget the measured shapes of the data of the scene, e.g. because the font
+// or the DPI ratio changed. They're re-measured as the canvas is laid out.
+void CodeWidget::PrivateData::ClearMeasurements(void) {
+  data_layout.clear();
+  data_layout.resize(scene->data.size());
+  character_offsets.clear();
 }
 
 // Recompute and paint the selection.
@@ -2247,46 +2265,45 @@ void CodeWidget::PrivateData::RecomputeSelection(QPainter &blitter) {
 
   // Go through only the entities on the relevant lines.
   for (auto l = start_index; l <= stop_index; ++l) {
-    if ((l + 1) >= scene.logical_line_index.size()) {
+    if ((l + 1) >= scene->logical_line_index.size()) {
       break;
     }
 
-    auto i = scene.logical_line_index[l];
-    auto max_i = scene.logical_line_index[l + 1];
+    auto i = scene->logical_line_index[l];
+    auto max_i = scene->logical_line_index[l + 1];
 
     QPainter dummy_fg;
 
     // Inspect each entity on the line.
     for (; i < max_i; ++i) {
-      const Entity &e = scene.entities[i];
-      unsigned data_index = e.data_index_and_config >> kFormatShift;
-      unsigned rect_config = e.data_index_and_config & kFormatMask;
-      Data &data = scene.data[data_index];
+      const Entity &e = scene->entities[i];
+      const EntityLayout &el = entity_layout[i];
+      const QStringView text = scene->Text(e.data_index);
+      DataLayout &dl = data_layout[e.data_index];
 
-      const Token &t = scene.tokens[e.token_index];
-      ITheme::ColorAndStyle cs = theme->TokenColorAndStyle(t);
+      ITheme::ColorAndStyle cs = token_styles[e.token_index];
       cs.background_color = selection_color;
       cs.foreground_color = QColor();
 
-      int entity_offset = scene.begin_of_entity_in_document[i];
+      int entity_offset = scene->begin_of_entity_in_document[i];
       qreal e_y = static_cast<qreal>(e.logical_line_number - 1) *
                   line_height;
 
-      QRectF bounding_rect = data.bounding_rect[rect_config];
+      QRectF bounding_rect = dl.bounding_rect[el.config];
       for (auto &sel : selections) {
         if (!sel) {
           continue;
         }
 
-        qreal x = e.x - scroll_x;
+        qreal x = el.x - scroll_x;
         qreal y = e_y - scroll_y;
         bounding_rect.moveTo(x, y);
 
         // The selection fully contains this entity; paint it.
         if (sel->contains(bounding_rect)) {
           update_selections(entity_offset + 0,
-                            entity_offset + data.text.size());
-          PaintToken(dummy_fg, blitter, data, rect_config, cs, x, y);
+                            entity_offset + text.size());
+          PaintToken(dummy_fg, blitter, text, dl, el.config, cs, x, y);
           break;
 
         // The selection is unrelated to this entity.
@@ -2295,7 +2312,7 @@ void CodeWidget::PrivateData::RecomputeSelection(QPainter &blitter) {
         }
 
         qsizetype start_k = 0;
-        qsizetype stop_k = data.text.size();
+        qsizetype stop_k = text.size();
 
         // Top-left intersection case (highlight a suffix of `data`).
         if (bounding_rect.x() < sel->x()) {
@@ -2313,22 +2330,190 @@ void CodeWidget::PrivateData::RecomputeSelection(QPainter &blitter) {
           Q_ASSERT(0 < stop_k);
         }
 
-        Data new_data = {};
-        new_data.bounding_rect_valid[rect_config] = false;
+        QString new_text;
+        DataLayout new_layout;
         for (auto k = start_k; 0 <= k && k < stop_k; ++k) {
-          new_data.text += data.text[k];
+          new_text += text[k];
         }
         
         update_selections(entity_offset + start_k, entity_offset + stop_k);
-        PaintToken(dummy_fg, blitter, new_data, rect_config, cs, x, y);
+        PaintToken(dummy_fg, blitter, new_text, new_layout, el.config, cs,
+                   x, y);
         break;
       }
     }
   }
 }
 
-// Recompute the line numbers.
+// Recompute the width of the line number gutter. The line number shown beside
+// each logical line is computed by the `SceneBuilder`, and the gutter itself
+// is rasterized on demand, one tile at a time, by `RenderGutterTile`.
 void CodeWidget::PrivateData::RecomputeLineNumbers(void) {
+  int num_digits = 0;
+  for (auto i = scene->num_file_lines; i; ++num_digits) {
+    i /= 10;
+  }
+
+  num_digits = std::max(num_digits, 2);
+
+  QFontMetricsF fm(theme_font);
+
+  gutter_digits_width = fm.maxWidth() * num_digits;
+  left_margin = (space_width * 3) + gutter_digits_width;
+}
+
+// Return the keys of the code tiles that intersect `rect`, which is in canvas
+// coordinates.
+std::vector<TileKey> CodeWidget::PrivateData::CodeTileKeys(QRect rect) const {
+  std::vector<TileKey> keys;
+
+  rect = rect.intersected(canvas_rect);
+  if (rect.isEmpty()) {
+    return keys;
+  }
+
+  auto first_row = rect.top() / TileCache::kTileHeight;
+  auto last_row = rect.bottom() / TileCache::kTileHeight;
+  auto first_col = rect.left() / TileCache::kTileWidth;
+  auto last_col = rect.right() / TileCache::kTileWidth;
+
+  for (auto row = first_row; row <= last_row; ++row) {
+    for (auto col = first_col; col <= last_col; ++col) {
+      keys.emplace_back(TileKey{row, col});
+    }
+  }
+
+  return keys;
+}
+
+// Return the keys of the gutter tiles that intersect `rect`, which is in
+// canvas coordinates. Unlike the code, the gutter extends to the bottom of
+// the viewport, even if the code doesn't.
+std::vector<TileKey> CodeWidget::PrivateData::GutterTileKeys(
+    QRect rect) const {
+  std::vector<TileKey> keys;
+
+  if (rect.isEmpty() || rect.left() >= left_margin || 0 >= line_height) {
+    return keys;
+  }
+
+  auto first_row = std::max(0, rect.top()) / TileCache::kTileHeight;
+  auto last_row = std::max(0, rect.bottom()) / TileCache::kTileHeight;
+  for (auto row = first_row; row <= last_row; ++row) {
+    keys.emplace_back(TileKey{row, kGutterColumn});
+  }
+
+  return keys;
+}
+
+// Return the top-left corner of a tile, in canvas coordinates.
+QPointF CodeWidget::PrivateData::TileOrigin(TileKey key) const {
+  if (key.column == kGutterColumn) {
+    return QPointF(0, key.row * TileCache::kTileHeight);
+  } else {
+    return QPointF(key.column * TileCache::kTileWidth,
+                   key.row * TileCache::kTileHeight);
+  }
+}
+
+// Return the tile identified by `key`, rasterizing it if it isn't cached. The
+// returned tile shares its images with the cached tile.
+Tile CodeWidget::PrivateData::GetTile(TileKey key) {
+  if (auto tile = tile_cache.Find(key)) {
+    return *tile;
+  }
+
+  if (key.column == kGutterColumn) {
+    return tile_cache.Insert(key, RenderGutterTile(key.row));
+  } else {
+    return tile_cache.Insert(key, RenderCodeTile(key));
+  }
+}
+
+// Rasterize the code that intersects the tile identified by `key`. The
+// entities have already been laid out by `RecomputeCanvas`, so we only need
+// to visit the lines that overlap the tile.
+Tile CodeWidget::PrivateData::RenderCodeTile(TileKey key) {
+  QRectF tile_rect(TileOrigin(key),
+                   QSizeF(TileCache::kTileWidth, TileCache::kTileHeight));
+
+  auto new_layer = [this] (void) {
+    QImage layer(static_cast<int>(TileCache::kTileWidth * dpi_ratio),
+                 static_cast<int>(TileCache::kTileHeight * dpi_ratio),
+                 QImage::Format_ARGB32_Premultiplied);
+    layer.setDevicePixelRatio(dpi_ratio);
+
+    // Fill the contents with transparent pixels, rather than leaving them
+    // undefined.
+    layer.fill(0);
+    return layer;
+  };
+
+  Tile tile;
+  tile.foreground = new_layer();
+
+  QPainter fg_painter(&(tile.foreground));
+  QPainter bg_painter;
+
+  InitializePainterOptions(fg_painter);
+  fg_painter.translate(-tile_rect.topLeft());
+
+  // Italic text can lean outside of the bounding rect of its entity, so also
+  // paint the entities that are just outside of this tile.
+  qreal min_x = tile_rect.left() - max_char_width;
+  qreal max_x = tile_rect.right() + max_char_width;
+
+  auto num_lines = static_cast<int>(scene->logical_line_index.size()) - 1;
+  auto first_line = std::max(
+      0, static_cast<int>(std::floor(tile_rect.top() / line_height)));
+  auto last_line = std::min(
+      num_lines - 1,
+      static_cast<int>(std::floor(tile_rect.bottom() / line_height)));
+
+  for (auto l = first_line; l <= last_line; ++l) {
+    auto line_index = static_cast<unsigned>(l);
+    auto i = scene->logical_line_index[line_index];
+    auto max_i = scene->logical_line_index[line_index + 1u];
+
+    for (; i < max_i; ++i) {
+      const Entity &e = scene->entities[i];
+      const EntityLayout &el = entity_layout[i];
+      if (el.x > max_x) {
+        break;
+      }
+
+      DataLayout &dl = data_layout[e.data_index];
+      if ((el.x + dl.bounding_rect[el.config].width()) < min_x) {
+        continue;
+      }
+
+      const ITheme::ColorAndStyle &cs = token_styles[e.token_index];
+
+      // Only allocate the background layer if something needs it.
+      if (cs.background_color.isValid() && !bg_painter.isActive()) {
+        tile.background = new_layer();
+        bg_painter.begin(&(tile.background));
+        InitializePainterOptions(bg_painter);
+        bg_painter.translate(-tile_rect.topLeft());
+      }
+
+      qreal x = el.x;
+      qreal y = static_cast<qreal>(l) * line_height;
+      PaintToken(fg_painter, bg_painter, scene->Text(e.data_index), dl,
+                 el.config, cs, x, y);
+    }
+  }
+
+  fg_painter.end();
+  if (bg_painter.isActive()) {
+    bg_painter.end();
+  }
+
+  return tile;
+}
+
+// Rasterize the tile of the line number gutter that covers the row band `row`.
+Tile CodeWidget::PrivateData::RenderGutterTile(int row) {
   auto bg_color = theme->GutterBackgroundColor();
   if (!bg_color.isValid()) {
     bg_color = theme_background_color;
@@ -2339,21 +2524,10 @@ void CodeWidget::PrivateData::RecomputeLineNumbers(void) {
     fg_color = theme_foreground_color;
   }
 
-  int num_digits = 0;
-  for (auto i = scene.num_file_lines; i; ++num_digits) {
-    i /= 10;
-  }
-
-  num_digits = std::max(num_digits, 2);
-
-  QFontMetricsF fm(theme_font);
-
-  auto height = std::max(canvas_rect.height(), viewport.height());
-  auto width = (space_width * 3) + (fm.maxWidth() * num_digits);
-  left_margin = width;
+  qreal tile_y = row * TileCache::kTileHeight;
 
-  QImage bg(static_cast<int>(width * dpi_ratio),
-            static_cast<int>(height * dpi_ratio),
+  QImage bg(static_cast<int>(std::ceil(left_margin * dpi_ratio)),
+            static_cast<int>(TileCache::kTileHeight * dpi_ratio),
             QImage::Format_ARGB32_Premultiplied);
 
   bg.setDevicePixelRatio(dpi_ratio);
@@ -2366,92 +2540,102 @@ void CodeWidget::PrivateData::RecomputeLineNumbers(void) {
 
   QPainter blitter(&bg);
   InitializePainterOptions(blitter);
+  blitter.translate(0, -tile_y);
 
   QFont font = theme_font;
   blitter.setPen(fg_color);
 
   QTextOption gutter_to(Qt::AlignRight);
 
-  if (!scene.logical_line_index.empty()) {
-    auto max_i = scene.logical_line_index.size() - 1u;
-    QRectF bounding_rect(space_width, 0, width - (space_width * 3), line_height);
-
-    int last_line_num = 0;
-
-    // Paint the line numbers.
-    for (auto i = 0u; i < max_i; ++i) {
-      int line_number = 0;
-      auto max_e = scene.logical_line_index[i + 1u];
-      
-      // Go get the minimum line number. Some might be negative because of a
-      // macro expansion on the line, so we want to highlight that an expansion
-      // happened somewhere on the line.
-      for (auto e = scene.logical_line_index[i]; e < max_e; ++e) {
-        if (auto ln = scene.file_line_number[e]) {
-          if (!line_number) {
-            line_number = ln;
-          } else {
-            line_number = std::min(line_number, ln);
-          }
-        }
-      }
-
-      if (!line_number) {
-        line_number = last_line_num;
-      }
-
-      if (line_number) {
-        QString text = QString::number(std::abs(line_number));
-        font.setUnderline(0 > line_number);
-        blitter.setFont(font);
-        blitter.drawText(bounding_rect, text, gutter_to);
+  const std::vector<int> &gutter_line_number = scene->gutter_line_number;
+  auto num_lines = static_cast<int>(gutter_line_number.size());
+  auto first_line = static_cast<int>(std::floor(tile_y / line_height));
+  auto last_line = std::min(
+      num_lines - 1,
+      static_cast<int>(std::floor(
+          (tile_y + TileCache::kTileHeight) / line_height)));
 
-        last_line_num = -std::abs(line_number);
-      }
+  QRectF bounding_rect(space_width, 0, gutter_digits_width, line_height);
 
-      bounding_rect.moveTo(
-          QPointF(bounding_rect.x(), bounding_rect.y() + line_height));
+  // Paint the line numbers.
+  for (auto i = first_line; i <= last_line; ++i) {
+    if (auto line_number = gutter_line_number[static_cast<unsigned>(i)]) {
+      bounding_rect.moveTo(QPointF(space_width, i * line_height));
+      font.setUnderline(0 > line_number);
+      blitter.setFont(font);
+      blitter.drawText(bounding_rect, QString::number(std::abs(line_number)),
+                       gutter_to);
     }
   }
 
   // Paint a right margin one space wide.
-  QRectF right_margin_rect((space_width * 2) + (fm.maxWidth() * num_digits), 0,
-                           space_width, height);
+  QRectF right_margin_rect((space_width * 2) + gutter_digits_width, tile_y,
+                           space_width, TileCache::kTileHeight);
   blitter.fillRect(right_margin_rect, theme_background_color);
 
   blitter.end();
 
-  line_number_canvas.swap(bg);
+  Tile tile;
+  tile.foreground.swap(bg);
+  return tile;
 }
 
-// Recompute the highlights.
-void CodeWidget::PrivateData::RecomputeHighlights(void) {
-  if (current_entity == prev_highlighted_entity && !canvas_changed) {
-    return;
+// Rasterize a few of the tiles around the viewport that aren't yet cached.
+// Returns `true` if there are more tiles left to prefetch.
+bool CodeWidget::PrivateData::PrefetchTiles(void) {
+  if (styles_changed || canvas_changed || viewport.isEmpty()) {
+    return false;
   }
 
-  prev_highlighted_entity = current_entity;
+  QRect visible_rect(scroll_x, scroll_y, viewport.width(), viewport.height());
+  QRect prefetch_rect = visible_rect.adjusted(
+      -kPrefetchMargin * TileCache::kTileWidth,
+      -kPrefetchMargin * TileCache::kTileHeight,
+      kPrefetchMargin * TileCache::kTileWidth,
+      kPrefetchMargin * TileCache::kTileHeight);
 
-  QImage bg(static_cast<int>(canvas_rect.width() * dpi_ratio),
-            static_cast<int>(canvas_rect.height() * dpi_ratio),
-            QImage::Format_ARGB32_Premultiplied);
+  std::vector<TileKey> keys = CodeTileKeys(prefetch_rect);
+  std::vector<TileKey> gutter_keys = GutterTileKeys(prefetch_rect);
+  keys.insert(keys.end(), gutter_keys.begin(), gutter_keys.end());
 
-  bg.setDevicePixelRatio(dpi_ratio);
+  // Don't prefetch if doing so would push the visible tiles out of the cache.
+  auto tile_size = static_cast<size_t>(
+      TileCache::kTileWidth * TileCache::kTileHeight * dpi_ratio * dpi_ratio *
+      4 /* bytes per pixel */);
+  if ((keys.size() * tile_size) > tile_cache.MemoryBudget()) {
+    return false;
+  }
+
+  auto num_rendered = 0;
+  for (TileKey key : keys) {
+    if (tile_cache.Contains(key)) {
+      continue;
+    }
+
+    if (num_rendered == kMaxPrefetchTilesPerTurn) {
+      return true;
+    }
+
+    (void) GetTile(key);
+    ++num_rendered;
+  }
 
-  // Fill the contents with transparent pixels, rather than leaving them
-  // undefined.
-  bg.fill(0);
+  return false;
+}
 
+// Return the related entity ID of the current entity, and the color with
+// which its occurrences should be highlighted. The ID is `kInvalidEntityId` if
+// nothing should be highlighted.
+std::pair<RawEntityId, QColor>
+CodeWidget::PrivateData::HighlightedEntity(void) const {
   if (!current_entity) {
-    highlight_canvas.swap(bg);
-    return;
+    return {kInvalidEntityId, QColor()};
   }
 
-  const Token &token = scene.tokens[current_entity->token_index];
+  const Token &token = scene->tokens[current_entity->token_index];
   RawEntityId related_entity_id = token.related_entity_id().Pack();
   if (related_entity_id == kInvalidEntityId) {
-    highlight_canvas.swap(bg);
-    return;
+    return {kInvalidEntityId, QColor()};
   }
 
   QColor highlight_color = theme->CurrentEntityBackgroundColor(
@@ -2459,52 +2643,271 @@ void CodeWidget::PrivateData::RecomputeHighlights(void) {
 
   // The theme doesn't want to highlight current entities.
   if (!highlight_color.isValid()) {
-    highlight_canvas.swap(bg);
+    return {kInvalidEntityId, QColor()};
+  }
+
+  return {related_entity_id, highlight_color};
+}
+
+// Paint the background of the occurrences of the current entity that
+// intersect `dirty_rect`, which is in canvas coordinates. The occurrences are
+// found in `Scene::related_entity_ids`, where they're sorted by entity index,
+// and thus by line, so only those on the lines of `dirty_rect` are visited.
+void CodeWidget::PrivateData::PaintHighlights(QPainter &blitter,
+                                              QRect dirty_rect) {
+  if (!current_entity || dirty_rect.isEmpty() || !line_height) {
     return;
   }
 
+  auto [related_entity_id, highlight_color] = HighlightedEntity();
+  if (related_entity_id == kInvalidEntityId) {
+    return;
+  }
+
+  auto first_line = std::max(0, dirty_rect.top() / line_height);
+  auto last_line = std::max(0, dirty_rect.bottom() / line_height);
+  if (static_cast<size_t>(first_line) >= scene->logical_line_index.size()) {
+    return;
+  }
+
+  QRectF visible_rect(dirty_rect);
+
   QPainter fg_painter;
-  QPainter bg_painter(&bg);
-  InitializePainterOptions(bg_painter);
+  blitter.save();
+  blitter.translate(-scroll_x, -scroll_y);
+
+  auto first_entity = scene->logical_line_index[
+      static_cast<size_t>(first_line)];
 
-  auto re_end_it = scene.related_entity_ids.end();
-  auto re_it = std::upper_bound(
-      scene.related_entity_ids.begin(), re_end_it,
-      std::pair<RawEntityId, unsigned>(related_entity_id - 1, ~0u));
+  auto re_end_it = scene->related_entity_ids.end();
+  auto re_it = std::lower_bound(
+      scene->related_entity_ids.begin(), re_end_it,
+      std::pair<RawEntityId, unsigned>(related_entity_id, first_entity));
 
   for (auto it = re_it; it != re_end_it && it->first == related_entity_id;
      ++it) {
-    const Entity &e = scene.entities[it->second];
-    const Token &t = scene.tokens[e.token_index];
-    Data &data = scene.data[e.data_index_and_config >> kFormatShift];
-    unsigned rect_config = e.data_index_and_config & kFormatMask;
+    const Entity &e = scene->entities[it->second];
+    if ((e.logical_line_number - 1) > last_line) {
+      break;
+    }
 
-    qreal e_x = e.x;
+    const EntityLayout &el = entity_layout[it->second];
+    DataLayout &dl = data_layout[e.data_index];
+
+    qreal e_x = el.x;
     qreal e_y = static_cast<qreal>(e.logical_line_number - 1) * line_height;
 
-    QRectF bounding_rect = data.bounding_rect[rect_config];
+    QRectF bounding_rect = dl.bounding_rect[el.config];
     bounding_rect.moveTo(e_x, e_y);
+    if (!bounding_rect.intersects(visible_rect)) {
+      continue;
+    }
 
-    ITheme::ColorAndStyle cs = theme->TokenColorAndStyle(t);
+    ITheme::ColorAndStyle cs = token_styles[e.token_index];
     cs.background_color = highlight_color;
     cs.foreground_color = QColor();
 
-    PaintToken(fg_painter, bg_painter, data, rect_config, cs, e_x, e_y);
+    PaintToken(fg_painter, blitter, scene->Text(e.data_index), dl,
+               el.config, cs, e_x, e_y);
   }
 
-  bg_painter.end();
-  highlight_canvas.swap(bg);
+  blitter.restore();
 }
 
-void CodeWidget::PrivateData::RecomputeCanvas(void) {
-  RecomputeScene();
+// Re-resolve the color and style of every token from the theme, without
+// re-importing the scene. Entities whose boldness or italicness changed need
+// to be measured again, and so in that case we also force a re-layout.
+void CodeWidget::PrivateData::RecomputeStyles(void) {
+  if (!styles_changed) {
+    return;
+  }
+
+  styles_changed = false;
+  markers_changed = true;
+
+  token_styles.clear();
+  token_styles.reserve(scene->tokens.size());
+  for (const Token &token : scene->tokens) {
+    token_styles.emplace_back(theme->TokenColorAndStyle(token));
+  }
+
+  UpdateEntityConfigs();
+
+  // Everything that was rasterized used the old colors.
+  tile_cache.Clear();
+  dirty_lines.reset();
+}
+
+// Select the bounding rect configuration of each entity based on the style of
+// its token.
+void CodeWidget::PrivateData::UpdateEntityConfigs(void) {
+  auto num_entities = scene->entities.size();
+  if (entity_layout.size() != num_entities) {
+    entity_layout.resize(num_entities);
+    canvas_changed = true;
+  }
+
+  for (auto i = 0u; i < num_entities; ++i) {
+    const Entity &e = scene->entities[i];
+    const ITheme::ColorAndStyle &cs = token_styles[e.token_index];
+    unsigned rect_config = (cs.bold ? kBoldMask : 0u) |
+                           (cs.italic ? kItalicMask : 0u);
+    Q_ASSERT(rect_config == (rect_config & kFormatMask));
+    if (entity_layout[i].config != rect_config) {
+      entity_layout[i].config = rect_config;
+      canvas_changed = true;
+    }
+  }
+}
+
+// Expand or collapse macros in place, by re-importing only the substitutions
+// whose expansion state changed. Returns `false` if the scene can't be
+// spliced, and so needs to be rebuilt instead.
+bool CodeWidget::PrivateData::SpliceMacros(CodeWidget *self) {
+  if (scene_pending || scene->entities.empty()) {
+    return false;
+  }
+
+  // Try to maintain scroll position across scene changes.
+  std::optional<OpaqueLocation> loc;
+  if (0 < space_width && 0 < line_height) {
+    loc = Location();
+  }
+
+  SceneConfiguration config = Configuration();
+
+  // The current scene may be shared, so the splice produces a new scene.
+  auto new_scene = std::make_shared<Scene>();
+  std::vector<SceneEdit> edits =
+      SceneBuilder::SpliceMacroSubstitutions(*scene, config,
+                                             file_location_cache, *new_scene);
+  if (edits.empty()) {
+    return true;
+  }
+
+  if (scene_cache_id != kInvalidEntityId) {
+    SceneCache::Insert(SceneCacheKey(scene_cache_id, config), new_scene);
+  }
+
+  version_number++;
+  hovered_entity = {};
+  current_entity = nullptr;
+  markers_changed = true;
+  scene = std::move(new_scene);
+
+  // The splice keeps the data of the old scene where it was, and only appends
+  // new data, so the measurements of the old data are still good. Entity
+  // layouts are redone by `UpdateEntityConfigs` and `RecomputeCanvas`.
+  data_layout.resize(scene->data.size());
+
+  // Keep the token styles in sync with the tokens, only resolving the styles
+  // of new tokens. If all styles are going to be resolved again anyway then
+  // there's nothing to do.
+  if (!styles_changed) {
+    auto relayout_everything = canvas_changed;
+
+    std::vector<ITheme::ColorAndStyle> new_token_styles;
+    new_token_styles.reserve(scene->tokens.size());
+
+    auto old_t = 0u;
+    for (const SceneEdit &edit : edits) {
+      while (new_token_styles.size() < edit.first_token) {
+        new_token_styles.emplace_back(std::move(token_styles[old_t++]));
+      }
+      for (auto i = 0u; i < edit.num_new_tokens; ++i) {
+        new_token_styles.emplace_back(
+            theme->TokenColorAndStyle(scene->tokens[edit.first_token + i]));
+      }
+      old_t += edit.num_old_tokens;
+    }
+    while (old_t < token_styles.size()) {
+      new_token_styles.emplace_back(std::move(token_styles[old_t++]));
+    }
+
+    token_styles = std::move(new_token_styles);
+    Q_ASSERT(token_styles.size() == scene->tokens.size());
+    UpdateEntityConfigs();
+
+    // Only re-rasterize the lines that changed, unless something else already
+    // needs everything to be re-rasterized. If the number of lines changed
+    // then everything below the first edit has moved.
+    if (!relayout_everything) {
+      auto same_num_lines = std::all_of(
+          edits.begin(), edits.end(), [] (const SceneEdit &edit) {
+            return edit.num_old_lines == edit.num_new_lines;
+          });
+
+      const SceneEdit &last_edit = edits.back();
+      dirty_lines.emplace(
+          edits.front().first_line,
+          same_num_lines ?
+              last_edit.first_line + last_edit.num_new_lines - 1 :
+              std::numeric_limits<int>::max());
+    }
+  }
+
+  canvas_changed = true;
+  RecomputeCanvas(self);
+
+  if (loc) {
+    TriggerScrollbarUpdate([&, this] (void) {
+      SetLocation(std::move(loc.value()));
+    });
+  }
+
+  return true;
+}
+
+// Mark the lines of the occurrences of the current entity beside the vertical
+// scrollbar.
+void CodeWidget::PrivateData::UpdateScrollMarkers(void) {
+  if (!markers_changed && marked_entity == current_entity) {
+    return;
+  }
+
+  markers_changed = false;
+  marked_entity = current_entity;
+
+  auto [related_entity_id, highlight_color] = HighlightedEntity();
+  if (related_entity_id == kInvalidEntityId) {
+    scroll_marker->ClearMarkers();
+    return;
+  }
+
+  auto re_end_it = scene->related_entity_ids.end();
+  auto re_it = std::lower_bound(
+      scene->related_entity_ids.begin(), re_end_it,
+      std::pair<RawEntityId, unsigned>(related_entity_id, 0u));
+
+  std::vector<int> line_indices;
+  for (auto it = re_it; it != re_end_it && it->first == related_entity_id;
+       ++it) {
+    auto line_index = scene->entities[it->second].logical_line_number - 1;
+    if (line_indices.empty() || line_indices.back() != line_index) {
+      line_indices.push_back(line_index);
+    }
+  }
+
+  scroll_marker->SetMarkers(std::move(line_indices), scene->num_lines,
+                            highlight_color);
+}
+
+// Recompute the layout of the entities of the scene. This figures out where
+// each entity goes, but doesn't rasterize anything; rasterization happens
+// on-demand, one tile at a time, when painting.
+void CodeWidget::PrivateData::RecomputeCanvas(CodeWidget *self) {
+  RecomputeScene(self);
+  RecomputeStyles();
 
   if (!canvas_changed) {
-    RecomputeHighlights();
     return;
   }
 
   canvas_changed = false;
+  character_offsets.clear();
+
+  auto old_left_margin = left_margin;
+  auto old_line_height = line_height;
 
   theme_font = theme->Font();  // Reset (to clear bold/italic).
   theme_font.setStyleStrategy(QFont::NoSubpixelAntialias);
@@ -2558,37 +2961,22 @@ void CodeWidget::PrivateData::RecomputeCanvas(void) {
   // italic text to "lean in" and spill over into those margins.
   canvas_rect = QRect(
       0, 0,
-      (max_char_width * static_cast<int>(scene.max_logical_columns + 2)),
-      line_height * std::max(1, scene.num_lines));
+      (max_char_width * static_cast<int>(scene->max_logical_columns + 2)),
+      line_height * std::max(1, scene->num_lines));
 
   UpdateScrollbars();
 
-  QImage fg(static_cast<int>(canvas_rect.width() * dpi_ratio),
-            static_cast<int>(canvas_rect.height() * dpi_ratio),
-            QImage::Format_ARGB32_Premultiplied);
-
-  QImage bg(static_cast<int>(canvas_rect.width() * dpi_ratio),
-            static_cast<int>(canvas_rect.height() * dpi_ratio),
-            QImage::Format_ARGB32_Premultiplied);
-
-  fg.setDevicePixelRatio(dpi_ratio);
-  bg.setDevicePixelRatio(dpi_ratio);
-
-  // Fill the contents with transparent pixels, rather than leaving them
-  // undefined.
-  fg.fill(0);
-  bg.fill(0);
-
-  QPainter fg_painter(&fg);
-  QPainter bg_painter(&bg);
+  // Measure text with a painter on a tiny image that has the same device pixel
+  // ratio as our tiles, so that the measurements match what gets painted.
+  QImage measure_image(1, 1, QImage::Format_ARGB32_Premultiplied);
+  measure_image.setDevicePixelRatio(dpi_ratio);
 
-  InitializePainterOptions(fg_painter);
-  InitializePainterOptions(bg_painter);
-
-  fg_painter.setFont(bold_italic_font);
+  QPainter measurer(&measure_image);
+  InitializePainterOptions(measurer);
+  measurer.setFont(bold_italic_font);
 
   monospace[0] = QChar::Space;
-  space_rect = fg_painter.boundingRect(canvas_rect, monospace, to);
+  space_rect = measurer.boundingRect(canvas_rect, monospace, to);
   space_width = space_rect.width();
 
   RecomputeLineNumbers();  // Computes `left_margin` using `space_width`.
@@ -2599,7 +2987,6 @@ void CodeWidget::PrivateData::RecomputeCanvas(void) {
   // Start new lines indented with a single space. This helps us account for
   // italic character writing outside of their minimum-sized bounding box.
   qreal x = left_margin;
-  qreal y = 0;
   int logical_column_number = 1;
   int logical_line_number = 1;
 
@@ -2608,16 +2995,17 @@ void CodeWidget::PrivateData::RecomputeCanvas(void) {
       font_metrics_bi.maxWidth() == font_metrics.maxWidth() &&
       font_metrics_bi.horizontalAdvance(".") == font_metrics_bi.maxWidth();
 
-  for (Entity &e : scene.entities) {
-    Data &data = scene.data[e.data_index_and_config >> kFormatShift];
-    const Token &token = scene.tokens[e.token_index];
+  for (auto i = 0u, max_i = static_cast<unsigned>(scene->entities.size());
+       i < max_i; ++i) {
+    const Entity &e = scene->entities[i];
+    const QStringView text = scene->Text(e.data_index);
+    EntityLayout &el = entity_layout[i];
 
-    Q_ASSERT(!data.text.isEmpty());
+    Q_ASSERT(!text.isEmpty());
 
     // Synchronize our logical and physical positions. This ends up accounting
     // for whitespace.
     while (logical_line_number < e.logical_line_number) {
-      y += line_height;
       x = left_margin;
       logical_line_number += 1;
       logical_column_number = 1;
@@ -2628,35 +3016,44 @@ void CodeWidget::PrivateData::RecomputeCanvas(void) {
       x += space_width;
     }
 
-    // NOTE(pag): Mutate this in-place so that we always know where each
-    //            entity is. This is required for click and selection managent.
-    e.x = x;
-
-    ITheme::ColorAndStyle cs = theme->TokenColorAndStyle(token);
+    // NOTE: Record this so that we always know where each entity is.
+    //       This is required for click and selection managent.
+    el.x = x;
 
-    // Figure out the configuration for this entity, and update it in place.
-    unsigned rect_config = (cs.bold ? kBoldMask : 0u) |
-                           (cs.italic ? kItalicMask : 0u);
-    e.data_index_and_config |= rect_config;
+    // The style pass has already selected the configuration of this entity.
+    const ITheme::ColorAndStyle &cs = token_styles[e.token_index];
 
-    PaintToken(fg_painter, bg_painter, data, rect_config, cs, x, y);
+    x += LayoutToken(measurer, text, data_layout[e.data_index], el.config,
+                     cs);
 
-    logical_column_number += static_cast<int>(data.text.size());
+    logical_column_number += static_cast<int>(text.size());
   }
 
-  fg_painter.end();
-  bg_painter.end();
+  measurer.end();
 
-  foreground_canvas.swap(fg);
-  background_canvas.swap(bg);
+  // All previously rasterized tiles are now stale, unless we know that only
+  // some lines changed, and nothing else moved.
+  if (dirty_lines && old_left_margin == left_margin &&
+      old_line_height == line_height) {
+    auto first_y = static_cast<int64_t>(dirty_lines->first) * line_height;
+    auto last_y = (static_cast<int64_t>(dirty_lines->second) + 1) *
+                  line_height;
+    tile_cache.EraseRows(
+        static_cast<int>(first_y / TileCache::kTileHeight),
+        static_cast<int>(std::min<int64_t>(
+            last_y / TileCache::kTileHeight,
+            std::numeric_limits<int>::max())));
+  } else {
+    tile_cache.Clear();
+  }
+
+  dirty_lines.reset();
 
   // TODO(pag): `scroll_x` and `scroll_y` probably don't make sense anymore.
   if (cursor) {
     cursor = CursorPosition(cursor.value());
     current_entity = EntityUnderPoint(cursor.value());
   }
-
-  RecomputeHighlights();
 }
 
 void CodeWidget::PrivateData::ScrollToPoint(
@@ -2715,36 +3112,73 @@ void CodeWidget::PrivateData::ScrollToEntityOffset(
     CodeWidget *self, unsigned offset, bool take_focus,
     LocationChangeReason reason) {
 
-  if (offset > scene.entities.size()) {
+  if (offset > scene->entities.size()) {
     return;
   }
 
   hovered_entity = {};
 
-  const Entity &entity = scene.entities[offset];
+  const Entity &entity = scene->entities[offset];
   current_line_index = entity.logical_line_number - 1;
   qreal entity_y = current_line_index * line_height;
-  QPointF entity_loc(entity.x, entity_y);
+  qreal entity_x = LayoutOf(&entity).x;
+  QPointF entity_loc(entity_x, entity_y);
   selection_start_cursor.reset();
   cursor = CursorPosition(entity_loc);
   current_entity = &entity;
 
-  ScrollToPoint(self, QPointF(entity.x, entity_y), take_focus, reason);
+  ScrollToPoint(self, QPointF(entity_x, entity_y), take_focus, reason);
 }
 
-// Paint a token.
-void CodeWidget::PrivateData::PaintToken(
-    QPainter &fg_painter, QPainter &bg_painter, Data &data,
-    unsigned rect_config, ITheme::ColorAndStyle cs, qreal &x, qreal &y) {
-
+// Return the font to use for text in the style `cs`.
+QFont CodeWidget::PrivateData::FontForStyle(
+    const ITheme::ColorAndStyle &cs) const {
   QFont font = theme_font;
   font.setItalic(cs.italic);
   font.setUnderline(cs.underline);
   font.setStrikeOut(cs.strikeout);
   font.setWeight(cs.bold ? QFont::DemiBold : QFont::Normal);
+  return font;
+}
+
+// Compute the bounding rect of `text` when rendered in the style `cs`, and
+// return how far painting it would advance the `x` position.
+qreal CodeWidget::PrivateData::LayoutToken(
+    QPainter &measurer, QStringView text, DataLayout &layout,
+    unsigned rect_config, const ITheme::ColorAndStyle &cs) {
+
+  QRectF &token_rect = layout.bounding_rect[rect_config];
+  bool &token_rect_valid = layout.bounding_rect_valid[rect_config];
+
+  if (is_monospaced) {
+    if (!token_rect_valid) {
+      token_rect = space_rect;
+      token_rect.setWidth(space_width * static_cast<double>(text.size()));
+      token_rect_valid = true;
+    }
+    return space_width * static_cast<double>(text.size());
+  }
+
+  if (!token_rect_valid) {
+    measurer.setFont(FontForStyle(cs));
+    token_rect = measurer.boundingRect(
+        canvas_rect, QString::fromRawData(text.constData(), text.size()), to);
+    token_rect_valid = true;
+  }
+
+  return token_rect.width();
+}
 
-  QRectF &token_rect = data.bounding_rect[rect_config];
-  bool &token_rect_valid = data.bounding_rect_valid[rect_config];
+// Paint a token.
+void CodeWidget::PrivateData::PaintToken(
+    QPainter &fg_painter, QPainter &bg_painter, QStringView text,
+    DataLayout &layout, unsigned rect_config, ITheme::ColorAndStyle cs,
+    qreal &x, qreal &y) {
+
+  QFont font = FontForStyle(cs);
+
+  QRectF &token_rect = layout.bounding_rect[rect_config];
+  bool &token_rect_valid = layout.bounding_rect_valid[rect_config];
   bool fg_valid = cs.foreground_color.isValid();
   bool bg_valid = cs.background_color.isValid();
 
@@ -2765,7 +3199,7 @@ void CodeWidget::PrivateData::PaintToken(
   if (is_monospaced) {
     if (!token_rect_valid) {
       token_rect = space_rect;
-      token_rect.setWidth(space_width * static_cast<double>(data.text.size()));
+      token_rect.setWidth(space_width * static_cast<double>(text.size()));
       token_rect_valid = true;
     }
 
@@ -2776,25 +3210,23 @@ void CodeWidget::PrivateData::PaintToken(
       bg_painter.fillRect(token_rect, cs.background_color);
     }
 
-    QRectF glyph_rect = space_rect;
-
-    // Allow the glyph rect to be wider so that we don't cut off parts of
-    // italic text.
-    glyph_rect.setWidth(glyph_rect.width() * 2);
-
-    for (QChar ch : data.text) {
-      monospace[0] = ch;
+    // The shaped characters come from the process-wide glyph cache.
+    for (qsizetype i = 0; i < text.size(); ++i) {
       if (fg_valid) {
-        glyph_rect.moveTo(QPointF(x, y));
-        fg_painter.drawText(glyph_rect, monospace, to);
+        fg_painter.drawStaticText(
+            QPointF(x, y),
+            GlyphCache::Find(text.sliced(i, 1), font, dpi_ratio));
       }
       x += space_width;
     }
 
-  // Draw it as one word.
+  // Draw it as one word. The text is borrowed from the scene's text arena,
+  // and its shape comes from the process-wide glyph cache.
   } else {
     if (!token_rect_valid) {
-      token_rect = valid_painter->boundingRect(canvas_rect, data.text, to);
+      token_rect = valid_painter->boundingRect(
+          canvas_rect, QString::fromRawData(text.constData(), text.size()),
+          to);
       token_rect_valid = true;
     }
 
@@ -2803,13 +3235,18 @@ void CodeWidget::PrivateData::PaintToken(
       bg_painter.fillRect(token_rect, cs.background_color);
     }
     if (fg_valid) {
-      fg_painter.drawText(token_rect, data.text, to);
+      fg_painter.drawStaticText(token_rect.topLeft(),
+                                GlyphCache::Find(text, font, dpi_ratio));
     }
     x += token_rect.width();
   }
 }
 
-void CodeWidget::OnIndexChanged(const ConfigManager &) {
+void CodeWidget::OnIndexChanged(const ConfigManager &config_manager) {
+  d->file_location_cache = config_manager.FileLocationCache();
+
+  // Cached scenes refer to tokens of the old index.
+  SceneCache::Clear();
   ChangeScene({}, {});
   close();
 }
@@ -2826,7 +3263,9 @@ void CodeWidget::OnThemeChanged(const ThemeManager &theme_manager) {
   d->theme_foreground_color = d->theme->DefaultForegroundColor();
   d->theme_background_color = d->theme->DefaultBackgroundColor();
 
-  d->scene_changed = true;
+  // The scene doesn't depend on the theme, so we only need to re-resolve the
+  // token styles. A new font also means that we need to re-measure everything.
+  d->styles_changed = true;
 
   // If the font changed then scale the scroll position.
   if (old_font != d->theme_font) {
@@ -2837,17 +3276,20 @@ void CodeWidget::OnThemeChanged(const ThemeManager &theme_manager) {
         (d->scroll_x / old_fm.maxWidth()) * new_fm.maxWidth());
     d->scroll_y = static_cast<int>(
         (d->scroll_y / old_fm.height()) * new_fm.height());
-  }
 
-  // Rendering of things like the selection position is entirely dependent
-  // on the font sizes, so all of this stuff needs to be cleared out.
-  d->click_was_primary = false;
-  d->click_was_secondary = false;
-  d->current_entity = nullptr;
-  d->cursor.reset();
-  d->selection_start_cursor.reset();
-  d->tracking_selection = false;
-  d->hovered_entity = {};
+    d->canvas_changed = true;
+    d->ClearMeasurements();
+
+    // Rendering of things like the selection position is entirely dependent
+    // on the font sizes, so all of this stuff needs to be cleared out.
+    d->click_was_primary = false;
+    d->click_was_secondary = false;
+    d->current_entity = nullptr;
+    d->cursor.reset();
+    d->selection_start_cursor.reset();
+    d->tracking_selection = false;
+    d->hovered_entity = {};
+  }
 
   QPalette p = palette();
   p.setColor(QPalette::Window, d->theme_background_color);
@@ -2863,21 +3305,23 @@ void CodeWidget::OnThemeChanged(const ThemeManager &theme_manager) {
 // Invoked when the set of macros to be expanded changes.
 void CodeWidget::OnExpandMacros(const QSet<RawEntityId> &macros_to_expand) {
 
+  auto changed = false;
+
   // Look for macros that weren't expanded before, but are now requested to be
   // expanded.
   for (auto macro_id : macros_to_expand) {
-    auto it = d->scene.expanded_macros.find(macro_id);
-    if (it != d->scene.expanded_macros.end() && !(it->second)) {
-      d->scene_changed = true;
+    auto it = d->scene->expanded_macros.find(macro_id);
+    if (it != d->scene->expanded_macros.end() && !(it->second)) {
+      changed = true;
       break;
     }
   }
 
   // Look for macros that were expanded before, and now aren't being expanded.
-  if (!d->scene_changed) {
-    for (auto [macro_id, expanded] : d->scene.expanded_macros) {
+  if (!changed) {
+    for (auto [macro_id, expanded] : d->scene->expanded_macros) {
       if (expanded && !macros_to_expand.contains(macro_id)) {
-        d->scene_changed = true;
+        changed = true;
         break;
       }
     }
@@ -2885,13 +3329,25 @@ void CodeWidget::OnExpandMacros(const QSet<RawEntityId> &macros_to_expand) {
 
   d->macros_to_expand = macros_to_expand;
 
-  if (!d->scene_changed) {
+  if (!changed) {
     return;
   }
 
-  d->TriggerScrollbarUpdate([this] (void) {
-    d->RecomputeScene();
-  });
+  // Try to only re-import the macros whose expansion state changed. If the
+  // current scene is stale or incomplete then it needs to be rebuilt.
+  if (!d->scene_changed && d->SpliceMacros(this)) {
+
+    // Search results are offsets into the document, so they need to be redone.
+    if (!d->search_widget->Parameters().pattern.empty() &&
+        d->search_widget->isVisible()) {
+      OnSearchParametersChange();
+    }
+
+  } else {
+    d->scene_changed = true;
+    d->RecomputeScene(this);
+  }
+
   update();
 }
 
@@ -2906,14 +3362,14 @@ void CodeWidget::OnRenameEntities(
 void CodeWidget::OnVerticalScroll(int) {
   auto change = d->vertical_scrollbar->value() - d->scroll_y;
   d->ScrollBy(0, change);
-  update();
+  d->UpdateAfterScroll(this);
   emit LocationChanged(kExternalScrollChange);
 }
 
 void CodeWidget::OnHorizontalScroll(int) {
   auto change = d->horizontal_scrollbar->value() - d->scroll_x;
   d->ScrollBy(change, 0);
-  update();
+  d->UpdateAfterScroll(this);
   emit LocationChanged(kExternalScrollChange);
 }
 
@@ -2929,33 +3385,52 @@ void CodeWidget::OnGoToEntity(const VariantEntity &entity_, bool take_focus) {
   d->tracking_selection = false;
   
   d->last_entity_for_location = entity_;
+
+  // It's possible we haven't built the scene yet, and so we need a scene to be
+  // able to know what entities are even in our scene. Come back once the
+  // scene has been built.
+  d->RecomputeScene(this);
+  if (d->scene_pending) {
+    d->pending_location.reset();
+    d->pending_go_to_entity.emplace(entity_, take_focus);
+    return;
+  }
+
   VariantEntity entity = entity_;
 
   // TODO(pag): Eventually handle nested fragments.
   RawEntityId frag_id = kInvalidEntityId;
   if (auto frag = Fragment::containing(entity)) {
     frag_id = frag->id().Pack();
-    if (!d->scene.fragment_begin_offset.contains(frag_id) &&
-        d->scene.entity_begin_offset.contains(frag_id)) {
+    if (!d->scene->fragment_begin_offset.contains(frag_id) &&
+        d->scene->entity_begin_offset.contains(frag_id)) {
       d->scene_overrides.clear();
       d->scene_overrides.insert(frag->id().Pack());
       d->scene_changed = true;
+
+      // Rebuild the scene to show the fragment, then come back. The request
+      // is recorded first, as it's what `InstallScene` looks for.
+      d->pending_location.reset();
+      d->pending_go_to_entity.emplace(entity_, take_focus);
+      d->RecomputeScene(this);
+      update();
+      return;
     }
   }
 
-  // It's possible we haven't painted anything yet, and so we need a scene to
-  // be able to know what entities are even in our scene.
-  d->RecomputeCanvas();
+  // It's possible we haven't painted anything yet, and so we need the layout
+  // to be able to scroll to things.
+  d->RecomputeCanvas(this);
 
   auto from_macro = false;
-  auto it_end = d->scene.entity_begin_offset.end();
+  auto it_end = d->scene->entity_begin_offset.end();
 
   // Map to the entity.
   while (!std::holds_alternative<NotAnEntity>(entity)) {
 
     // Try to find `entity`.
     RawEntityId entity_id = EntityId(entity).Pack();
-    auto it = d->scene.entity_begin_offset.find(entity_id);
+    auto it = d->scene->entity_begin_offset.find(entity_id);
     if (it != it_end) {
       d->ScrollToEntityOffset(this, it->second, take_focus,
                               kExternalGoToEntity);
@@ -2978,25 +3453,16 @@ void CodeWidget::OnGoToEntity(const VariantEntity &entity_, bool take_focus) {
       }
       from_macro = false;
 
-      auto ti = 0u;
-      for (const auto &existing_tok : d->scene.tokens) {
-        if (existing_tok == *tok) {
-          break;
-        }
-        ++ti;
-      }
-
-      // We found the token in the scene; now find the first entity using the
-      // token.
-      if (ti < d->scene.tokens.size()) {
-        const auto &entities = d->scene.entities;
-        auto max_eo = entities.size();
-        for (auto eo = ti; eo < max_eo; ++eo) {
-          if (entities[eo].token_index == ti) {
-            d->ScrollToEntityOffset(this, eo, take_focus, kExternalGoToEntity);
-            return;
-          }
-        }
+      // Look for the first entity using the token.
+      const auto &index = d->scene->token_entity_index;
+      auto tok_id = tok->id().Pack();
+      auto it = std::lower_bound(
+          index.begin(), index.end(),
+          std::pair<RawEntityId, unsigned>(tok_id, 0u));
+      if (it != index.end() && it->first == tok_id) {
+        d->ScrollToEntityOffset(this, it->second, take_focus,
+                                kExternalGoToEntity);
+        return;
       }
 
       // Fall back on the fragment.
@@ -3054,7 +3520,7 @@ void CodeWidget::OnGoToEntity(const VariantEntity &entity_, bool take_focus) {
 
   // We failed to find the entity, hopefully we can find its containing
   // fragment. This code is probably dead.
-  auto it = d->scene.entity_begin_offset.find(frag_id);
+  auto it = d->scene->entity_begin_offset.find(frag_id);
   if (it != it_end) {
     d->ScrollToEntityOffset(this, it->second, take_focus, kExternalGoToEntity);
     return;
@@ -3066,12 +3532,17 @@ void CodeWidget::OnGoToEntity(const VariantEntity &entity_, bool take_focus) {
 
 //! Change the underlying data / model being rendered by this code widget.
 void CodeWidget::ChangeScene(const TokenTree &token_tree,
-                             const SceneOptions &options) {
-  d->hovered_entity = {};
-
-  d->version_number++;
+                             const SceneOptions &options,
+                             RawEntityId containing_entity_id) {
+  d->SetScene(std::make_shared<Scene>());
+  d->scene_cache_id = containing_entity_id;
+  d->token_styles.clear();
   d->scene_changed = true;
+  d->styles_changed = true;
   d->canvas_changed = true;
+  d->pending_go_to_entity.reset();
+  d->pending_location.reset();
+  d->pending_line_number.reset();
   d->click_was_primary = false;
   d->click_was_secondary = false;
   d->current_entity = nullptr;
@@ -3088,7 +3559,10 @@ void CodeWidget::ChangeScene(const TokenTree &token_tree,
   d->token_tree = token_tree;
   d->goto_line_widget->Deactivate();
   d->search_widget->Deactivate();
+  d->search_version_number->fetch_add(1u);
   d->search_result_list.clear();
+  d->search_scene.reset();
+  d->search_complete = false;
   d->macros_to_expand = options.macros_to_expand;
   d->new_entity_names = options.new_entity_names;
   d->last_entity_for_location = {};
@@ -3100,6 +3574,9 @@ void CodeWidget::ChangeScene(const TokenTree &token_tree,
   if (d->vertical_scrollbar->value()) {
     d->vertical_scrollbar->setValue(0);
   }
+  // Start building the new scene right away, rather than waiting for the
+  // next paint.
+  d->RecomputeScene(this);
   d->UpdateScrollbars();
   update();
   emit LocationChanged(kExternalSceneChange);
@@ -3118,21 +3595,81 @@ void CodeWidget::OnGoToLineNumber(unsigned line_) {
   d->last_location.reset();
   d->last_entity_for_location = {};
 
+  if (d->scene_pending) {
+    d->pending_line_number = line_;
+    return;
+  }
+
   auto line = static_cast<int>(line_);
-  auto max_e = d->scene.entities.size();
-  for (auto e = 0u; e < max_e; ++e) {
-    if (std::abs(d->scene.file_line_number[e]) == line) {
-      d->ScrollToEntityOffset(this, e, true  /* take focus */,
-                              kInternalGoToLine);
-      break;
+  const auto &index = d->scene->file_line_entity_index;
+  auto it = std::lower_bound(index.begin(), index.end(),
+                             std::pair<int, unsigned>(line, 0u));
+  if (it != index.end() && it->first == line) {
+    d->ScrollToEntityOffset(this, it->second, true  /* take focus */,
+                            kInternalGoToLine);
+  }
+}
+
+// Returns `true` if `pattern` can overlap with itself, i.e. if a non-empty
+// proper prefix of `pattern` is also a suffix of it.
+static bool CanOverlapItself(const QString &pattern, Qt::CaseSensitivity cs) {
+  for (auto len = pattern.size() - 1; 0 < len; --len) {
+    if (QStringView(pattern).first(len).compare(
+            QStringView(pattern).last(len), cs) == 0) {
+      return true;
     }
   }
+  return false;
 }
 
+// Returns `true` if the results of a search with `new_parameters` are a subset
+// of `search_result_list`. This is the case when a plain-text search extends
+// the pattern of the previous, complete, plain-text search of the same scene.
+//
+// NOTE: The matches of a search don't overlap. If the old pattern could
+//       overlap with itself, then some of its occurrences are missing
+//       from `search_result_list`, and those could be where the new
+//       pattern matches.
+bool CodeWidget::PrivateData::CanNarrowSearch(
+    const SearchWidget::SearchParameters &new_parameters) const {
+  using Type = SearchWidget::SearchParameters::Type;
+
+  const SearchWidget::SearchParameters &old_parameters = search_parameters;
+  if (!search_complete || search_scene != scene ||
+      old_parameters.type != Type::Text || new_parameters.type != Type::Text ||
+      old_parameters.whole_word ||
+      old_parameters.case_sensitive != new_parameters.case_sensitive ||
+      old_parameters.pattern.empty() ||
+      new_parameters.pattern.size() <= old_parameters.pattern.size() ||
+      new_parameters.pattern.compare(0u, old_parameters.pattern.size(),
+                                     old_parameters.pattern) != 0) {
+    return false;
+  }
+
+  return !CanOverlapItself(
+      QString::fromStdString(old_parameters.pattern),
+      old_parameters.case_sensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
+}
+
+// Start a new search. The search runs on a worker thread, and its results
+// stream into `search_result_list`. A previous search that is still running
+// is cancelled.
 void CodeWidget::OnSearchParametersChange(void) {
   const auto &search_parameters = d->search_widget->Parameters();
 
+  // Cancel any in-progress search; its results would be stale anyway.
+  d->search_version_number->fetch_add(1u);
+
+  std::optional<SearchResults> candidates;
+  if (d->CanNarrowSearch(search_parameters)) {
+    candidates = std::move(d->search_result_list);
+  }
+
   d->search_result_list.clear();
+  d->search_parameters = search_parameters;
+  d->search_scene = d->scene;
+  d->search_complete = false;
+
   if (search_parameters.pattern.empty()) {
     return;
   }
@@ -3153,24 +3690,39 @@ void CodeWidget::OnSearchParametersChange(void) {
     }
   }
 
-  QRegularExpression regex(pattern, options);
+  auto runnable = new SearchRunnable(
+      d->scene->document, std::move(pattern), options, std::move(candidates),
+      d->search_version_number);
 
-  // The regex is already validated by the search widget
-  Q_ASSERT(regex.isValid());
+  // Results arrive in document order, so they can be appended.
+  connect(runnable, &SearchRunnable::ResultsFound, this,
+          [this] (uint64_t version, SearchResults results) {
+            if (version != d->search_version_number->load()) {
+              return;
+            }
 
-  QRegularExpressionMatchIterator i = regex.globalMatch(d->scene.document);
-  while (i.hasNext()) {
-    QRegularExpressionMatch match = i.next();
-    d->search_result_list.emplace_back(match.capturedStart(), match.capturedLength());
-  }
+            d->search_result_list.insert(d->search_result_list.end(),
+                                         results.begin(), results.end());
+            d->search_widget->UpdateSearchProgress(
+                d->search_result_list.size(), false);
+          },
+          Qt::QueuedConnection);
+
+  connect(runnable, &SearchRunnable::SearchFinished, this,
+          [this] (uint64_t version) {
+            if (version != d->search_version_number->load()) {
+              return;
+            }
 
-  std::sort(d->search_result_list.begin(), d->search_result_list.end());
-  auto it = std::unique(d->search_result_list.begin(),
-                        d->search_result_list.end());
+            d->search_complete = true;
+            d->search_widget->UpdateSearchProgress(
+                d->search_result_list.size(), true);
+          },
+          Qt::QueuedConnection);
 
-  d->search_result_list.erase(it, d->search_result_list.end());
+  d->search_widget->UpdateSearchProgress(0u, false);
 
-  d->search_widget->UpdateSearchResultCount(d->search_result_list.size());
+  d->task_manager.Start(runnable, TaskPriority::kInteractive, d->task_group);
 }
 
 void CodeWidget::OnShowSearchResult(size_t result_index) {
@@ -3181,16 +3733,13 @@ void CodeWidget::OnShowSearchResult(size_t result_index) {
   auto [begin_, length] = d->search_result_list[result_index];
   auto begin = static_cast<int>(begin_);
   auto end = begin + static_cast<int>(length);
-  if (0 > begin || 0 > end || end >= d->scene.document.size()) {
+  if (0 > begin || 0 > end || end >= d->scene->document.size()) {
     return;
   }
 
   auto eo_to_point =
       [this] (const Entity *entity, int entity_offset) -> QPointF {
-        const Data &data = d->scene.data[
-            entity->data_index_and_config >> kFormatShift];
-        QRectF entity_rect = data.bounding_rect[
-            entity->data_index_and_config & kFormatMask];
+        QRectF entity_rect = d->BoundingRectOf(entity);
 
         // Figure out the starting position of the selection.
         qreal entity_y = (entity->logical_line_number - 1) * d->line_height;
@@ -3199,7 +3748,7 @@ void CodeWidget::OnShowSearchResult(size_t result_index) {
 
         for (qreal max_width = entity_rect.width(); ; shift += incr) {
           auto [index, width] = d->CharacterPosition(
-              QPointF(entity->x + shift, entity_y), entity);
+              QPointF(d->LayoutOf(entity).x + shift, entity_y), entity);
 
           if (index >= entity_offset || shift >= max_width) {
             shift = width;
@@ -3207,7 +3756,7 @@ void CodeWidget::OnShowSearchResult(size_t result_index) {
           }
         }
 
-        return QPointF(entity->x + shift, entity_y);
+        return QPointF(d->LayoutOf(entity).x + shift, entity_y);
       };
 
   auto [begin_entity, begin_offset] = d->EntityAtDocumentOffset(begin);
@@ -3215,7 +3764,7 @@ void CodeWidget::OnShowSearchResult(size_t result_index) {
     return;
   }
 
-  d->token_model.selection = d->scene.document.sliced(begin, length);
+  d->token_model.selection = d->scene->document.sliced(begin, length);
   d->current_entity = nullptr;
   d->last_entity_for_location = {};
   d->last_location.reset();
@@ -3251,9 +3800,72 @@ void CodeWidget::OnToggleBrowseMode(const QVariant &toggled) {
   d->browse_mode = toggled.toBool();
 }
 
+// Set the maximum number of bytes of scenes kept in the process-wide
+// `SceneCache`. This budget is shared by all code widgets.
+void CodeWidget::SetSceneCacheBudget(size_t num_bytes) {
+  SceneCache::SetMemoryBudget(num_bytes);
+}
+
+CodeWidget::SceneCacheStatistics CodeWidget::GetSceneCacheStatistics(void) {
+  auto cache_stats = SceneCache::Statistics();
+
+  SceneCacheStatistics stats;
+  stats.num_hits = cache_stats.num_hits;
+  stats.num_misses = cache_stats.num_misses;
+  stats.num_scenes = cache_stats.num_scenes;
+  stats.num_tokens = cache_stats.num_tokens;
+  stats.memory_usage = cache_stats.memory_usage;
+  stats.memory_budget = cache_stats.memory_budget;
+  return stats;
+}
+
+CodeWidget::PaintStatistics CodeWidget::GetPaintStatistics(void) const {
+  PaintStatistics stats;
+  stats.num_paints = d->num_paints;
+  if (d->paint_times.empty()) {
+    return stats;
+  }
+
+  std::vector<qint64> times = d->paint_times;
+  std::sort(times.begin(), times.end());
+
+  auto percentile = [&times] (size_t p) {
+    auto i = std::min(times.size() - 1u, (times.size() * p) / 100u);
+    return static_cast<double>(times[i]) / 1000000.0;
+  };
+
+  stats.p50_ms = percentile(50u);
+  stats.p99_ms = percentile(99u);
+  stats.max_ms = static_cast<double>(times.back()) / 1000000.0;
+  return stats;
+}
+
+CodeWidget::GlyphCacheStatistics CodeWidget::GetGlyphCacheStatistics(void) {
+  auto cache_stats = GlyphCache::Statistics();
+
+  GlyphCacheStatistics stats;
+  stats.num_hits = cache_stats.num_hits;
+  stats.num_misses = cache_stats.num_misses;
+  stats.num_entries = cache_stats.num_entries;
+  stats.max_entries = cache_stats.max_entries;
+  return stats;
+}
+
+void CodeWidget::SetRasterCacheBudget(size_t num_bytes) {
+  d->tile_cache.SetMemoryBudget(num_bytes);
+}
+
 void CodeWidget::TryGoToLocation(const OpaqueLocation &location,
                                  bool take_focus) {
 
+  // Come back to this location once the scene has been built.
+  d->RecomputeScene(this);
+  if (d->scene_pending) {
+    d->pending_go_to_entity.reset();
+    d->pending_location.emplace(location, take_focus);
+    return;
+  }
+
   d->TriggerScrollbarUpdate([&, this] (void) {
     d->SetLocation(location);
   });
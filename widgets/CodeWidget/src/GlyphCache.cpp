@@ -0,0 +1,117 @@
+/*
+  Copyright (c) 2024-present, Trail of Bits, Inc.
+  All rights reserved.
+
+  This source code is licensed in accordance with the terms specified in
+  the LICENSE file found in the root directory of this source tree.
+*/
+
+#include "GlyphCache.h"
+
+#include <QHash>
+#include <QString>
+#include <QTransform>
+
+#include <list>
+
+namespace mx::gui {
+namespace {
+
+struct Key {
+  QString text;
+  QFont font;
+  qreal dpi_ratio;
+
+  inline bool operator==(const Key &that) const noexcept {
+    return dpi_ratio == that.dpi_ratio && text == that.text &&
+           font == that.font;
+  }
+};
+
+inline size_t qHash(const Key &key, size_t seed = 0) noexcept {
+  return qHashMulti(seed, key.text, key.font, key.dpi_ratio);
+}
+
+struct Entry {
+  Key key;
+  QStaticText static_text;
+};
+
+using EntryList = std::list<Entry>;
+
+// State shared by all code widgets.
+struct GlyphCacheState {
+
+  // Most recently used texts are at the front.
+  EntryList entries;
+  QHash<Key, EntryList::iterator> key_to_entry;
+
+  size_t max_entries{GlyphCache::kDefaultMaxEntries};
+  size_t num_hits{0u};
+  size_t num_misses{0u};
+};
+
+static GlyphCacheState &State(void) {
+  static GlyphCacheState state;
+  return state;
+}
+
+}  // namespace
+
+// Return `text` shaped with `font`, shaping it if it isn't cached.
+QStaticText GlyphCache::Find(QStringView text, const QFont &font,
+                             qreal dpi_ratio) {
+  GlyphCacheState &state = State();
+
+  // Look up using a non-owning view of `text`, so that hits don't allocate.
+  Key key{QString::fromRawData(text.data(), text.size()), font, dpi_ratio};
+  if (auto it = state.key_to_entry.find(key); it != state.key_to_entry.end()) {
+    ++state.num_hits;
+    auto entry_it = it.value();
+    if (entry_it != state.entries.begin()) {
+      state.entries.splice(state.entries.begin(), state.entries, entry_it);
+    }
+    return entry_it->static_text;
+  }
+
+  ++state.num_misses;
+
+  // The key has to own its text.
+  key.text = text.toString();
+
+  QStaticText static_text(key.text);
+  static_text.setTextFormat(Qt::PlainText);
+  static_text.setPerformanceHint(QStaticText::AggressiveCaching);
+  static_text.prepare(QTransform(), font);
+
+  state.entries.push_front(Entry{key, static_text});
+  state.key_to_entry.insert(std::move(key), state.entries.begin());
+
+  while (state.entries.size() > state.max_entries) {
+    state.key_to_entry.remove(state.entries.back().key);
+    state.entries.pop_back();
+  }
+
+  return static_text;
+}
+
+// Drop all cached texts.
+void GlyphCache::Clear(void) {
+  GlyphCacheState &state = State();
+  state.key_to_entry.clear();
+  state.entries.clear();
+}
+
+// Returns the current counters.
+GlyphCacheStatistics GlyphCache::Statistics(void) {
+  GlyphCacheState &state = State();
+
+  GlyphCacheStatistics stats;
+  stats.num_hits = state.num_hits;
+  stats.num_misses = state.num_misses;
+  stats.num_entries = state.entries.size();
+  stats.max_entries = state.max_entries;
+  return stats;
+}
+
+}  // namespace mx::gui
@@ -0,0 +1,50 @@
+/*
+  Copyright (c) 2024-present, Trail of Bits, Inc.
+  All rights reserved.
+
+  This source code is licensed in accordance with the terms specified in
+  the LICENSE file found in the root directory of this source tree.
+*/
+
+#pragma once
+
+#include <QFont>
+#include <QStaticText>
+#include <QStringView>
+
+#include <cstddef>
+
+namespace mx::gui {
+
+//! Counters describing the `GlyphCache`.
+struct GlyphCacheStatistics {
+  size_t num_hits{0u};
+  size_t num_misses{0u};
+  size_t num_entries{0u};
+  size_t max_entries{0u};
+};
+
+//! A process-wide LRU cache of shaped text, keyed by the text, the font, and
+//! the DPI ratio. Tokens like `if`, `return`, or `->` appear many times in
+//! many scenes, and this makes it so that they're only shaped once.
+//!
+//! NOTE: The glyph cache is only used from the GUI thread, because that
+//!       is where painting happens.
+class GlyphCache {
+ public:
+  //! Default maximum number of cached texts.
+  static constexpr size_t kDefaultMaxEntries = 64u * 1024u;
+
+  //! Return `text` shaped with `font`, shaping it if it isn't cached. The
+  //! returned `QStaticText` should be drawn by a painter using `font`.
+  static QStaticText Find(QStringView text, const QFont &font,
+                          qreal dpi_ratio);
+
+  //! Drop all cached texts.
+  static void Clear(void);
+
+  //! Returns the current counters.
+  static GlyphCacheStatistics Statistics(void);
+};
+
+}  // namespace mx::gui
@@ -0,0 +1,45 @@
+/*
+  Copyright (c) 2024-present, Trail of Bits, Inc.
+  All rights reserved.
+
+  This source code is licensed in accordance with the terms specified in
+  the LICENSE file found in the root directory of this source tree.
+*/
+
+#include "Scene.h"
+
+namespace mx::gui {
+namespace {
+
+template <typename T>
+static size_t VectorBytes(const std::vector<T> &vec) {
+  return vec.capacity() * sizeof(T);
+}
+
+}  // namespace
+
+// Estimate the number of bytes used by this scene. `Token`s are handles into
+// fragment data owned by the index, so only the handles are counted.
+size_t Scene::NumBytes(void) const {
+  size_t num_bytes = sizeof(Scene);
+  num_bytes += static_cast<size_t>(document.capacity()) * sizeof(QChar);
+  num_bytes += static_cast<size_t>(text_arena.capacity()) * sizeof(QChar);
+  num_bytes += VectorBytes(entities);
+  num_bytes += VectorBytes(logical_line_index);
+  num_bytes += VectorBytes(file_line_number);
+  num_bytes += VectorBytes(begin_of_entity_in_document);
+  num_bytes += VectorBytes(data);
+  num_bytes += VectorBytes(tokens);
+  num_bytes += VectorBytes(related_entity_ids);
+  num_bytes += VectorBytes(token_entity_index);
+  num_bytes += VectorBytes(file_line_entity_index);
+  num_bytes += VectorBytes(macro_ranges);
+  num_bytes += VectorBytes(physical_line_number);
+  num_bytes += VectorBytes(gutter_line_number);
+  num_bytes += expanded_macros.NumBytes();
+  num_bytes += entity_begin_offset.NumBytes();
+  num_bytes += fragment_begin_offset.NumBytes();
+  return num_bytes;
+}
+
+}  // namespace mx::gui
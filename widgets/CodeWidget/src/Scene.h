@@ -0,0 +1,267 @@
+/*
+  Copyright (c) 2024-present, Trail of Bits, Inc.
+  All rights reserved.
+
+  This source code is licensed in accordance with the terms specified in
+  the LICENSE file found in the root directory of this source tree.
+*/
+
+#pragma once
+
+#include <QMetaType>
+#include <QRectF>
+#include <QString>
+#include <QStringView>
+
+#include <algorithm>
+#include <memory>
+#include <multiplier/Frontend/TokenTree.h>
+#include <multiplier/Index.h>
+#include <utility>
+#include <vector>
+
+namespace mx::gui {
+
+// NOTE: Everything reachable from a `Scene` is immutable once the scene
+//       has been built, so that scenes can be shared across widgets by
+//       way of the `SceneCache`. Where a widget puts things is tracked
+//       separately, in `EntityLayout`s and `DataLayout`s.
+struct Entity {
+
+  // Index of this entity's data in `Scene::data`.
+  unsigned data_index;
+
+  // Index of this entity's token in `Scene::tokens`.
+  unsigned token_index;
+
+  // The logical (one-indexed) line number of this token.
+  int logical_line_number;
+
+  // The logical (one-indexed) column number of this token.
+  int logical_column_number;
+};
+
+// The text of a `Data` lives in `Scene::text_arena`. Identical texts are
+// interned, so many entities share one `Data`.
+struct Data {
+  unsigned text_offset;
+  unsigned text_length;
+};
+
+// Where a widget has placed the `N`th entity of its scene.
+struct EntityLayout {
+
+  // Beginning `x` position of where the entity's data is drawn. The origin
+  // represents the left of the canvas.
+  qreal x{0};
+
+  // The "configuration" of this entity, i.e. selects which bounding rect of
+  // the entity's `DataLayout` applies.
+  unsigned config{0u};
+};
+
+// The measured shapes of the `N`th data of a scene, as drawn by a widget.
+struct DataLayout {
+  bool bounding_rect_valid[4u]{false, false, false, false};
+
+  // Normal, bold, italic, and bold+italic.
+  QRectF bounding_rect[4u];
+};
+
+// A map from entity IDs to values, stored as a flat vector that is sorted by
+// ID. Entries are appended with `emplace` while a scene is being built, and
+// `Finalize` then sorts them. Like `std::unordered_map::emplace`, the first
+// value added for an ID wins. Lookups are only valid once finalized.
+template <typename T>
+class EntityIdMap {
+ public:
+  using value_type = std::pair<RawEntityId, T>;
+  using const_iterator = typename std::vector<value_type>::const_iterator;
+
+  inline void emplace(RawEntityId id, T val) {
+    entries.emplace_back(id, std::move(val));
+  }
+
+  void Finalize(void) {
+    std::stable_sort(
+        entries.begin(), entries.end(),
+        [] (const value_type &a, const value_type &b) {
+          return a.first < b.first;
+        });
+    auto it = std::unique(
+        entries.begin(), entries.end(),
+        [] (const value_type &a, const value_type &b) {
+          return a.first == b.first;
+        });
+    entries.erase(it, entries.end());
+  }
+
+  const_iterator find(RawEntityId id) const {
+    auto it = std::lower_bound(
+        entries.begin(), entries.end(), id,
+        [] (const value_type &a, RawEntityId b) { return a.first < b; });
+    if (it != entries.end() && it->first == id) {
+      return it;
+    }
+    return entries.end();
+  }
+
+  inline bool contains(RawEntityId id) const {
+    return find(id) != entries.end();
+  }
+
+  inline const_iterator begin(void) const {
+    return entries.begin();
+  }
+
+  inline const_iterator end(void) const {
+    return entries.end();
+  }
+
+  inline void shrink_to_fit(void) {
+    entries.shrink_to_fit();
+  }
+
+  inline size_t NumBytes(void) const noexcept {
+    return entries.capacity() * sizeof(value_type);
+  }
+
+ private:
+  std::vector<value_type> entries;
+};
+
+// Records which part of a scene came from a macro substitution, so that
+// expanding or collapsing the macro only needs to re-import that part of the
+// `TokenTree`.
+struct MacroSubstitutionRange {
+  SubstitutionTokenTreeNode node;
+
+  RawEntityId macro_id{kInvalidEntityId};
+  RawEntityId definition_id{kInvalidEntityId};
+  bool force_expanded{false};
+  bool expanded{false};
+
+  // State of the `SceneBuilder` when the substitution was reached.
+  int expansion_depth{0};
+  TokenRange macro_use_tokens;
+
+  // Half-open ranges of `Scene::entities`, `Scene::tokens`, and
+  // `Scene::document` that were produced by the substitution.
+  unsigned begin_entity{0u};
+  unsigned end_entity{0u};
+  unsigned begin_token{0u};
+  unsigned end_token{0u};
+  int begin_document_offset{0};
+  int end_document_offset{0};
+
+  // Logical (one-indexed) line and column of the first character of the
+  // substitution, and of the first character following it.
+  int begin_line{1};
+  int begin_column{1};
+  int end_line{1};
+  int end_column{1};
+
+  // Number of ranges nested inside of this one. These immediately follow
+  // this range in `Scene::macro_ranges`.
+  unsigned num_nested{0u};
+
+  inline explicit MacroSubstitutionRange(SubstitutionTokenTreeNode node_)
+      : node(std::move(node_)) {}
+};
+
+struct Scene {
+  // The complete, (nearly) original document.
+  QString document;
+
+  // Sorted list of entities in this scene. This is sorted by
+  // `(Entity::logical_line_number, Entity::logical_column_number)`.
+  std::vector<Entity> entities;
+
+  // For logical (one-based) line number `N`, `logical_line_index[N - 1]` is
+  // the index into `entities` of the first entity on that line.
+  std::vector<unsigned> logical_line_index;
+
+  // The file line number associated with the `N`th entity. `0` if invalid,
+  // negative if in a macro.
+  std::vector<int> file_line_number;
+
+  // Offset of the beginning of each entity in the total text of the document.
+  std::vector<int> begin_of_entity_in_document;
+
+  // A linear representation of the token data. If a token spans multiple lines
+  // then it is split into multiple entries in `data`. If a token only
+  // contributes pure whitespace then it is not included in `data`.
+  std::vector<Data> data;
+
+  // The interned text of every `Data`, back-to-back.
+  QString text_arena;
+
+  // The underlying tokens. Entities refer to these by their 32-bit index.
+  //
+  // NOTE: `TokenTree` doesn't offer a way to refer to its tokens by
+  //       index, so we hold onto the `Token`s themselves.
+  std::vector<Token> tokens;
+
+  // A sorted list of related entity IDs and the into `entities`.
+  std::vector<std::pair<RawEntityId, unsigned>> related_entity_ids;
+
+  // A sorted list of token IDs and the index into `entities` of the first
+  // entity of each token.
+  std::vector<std::pair<RawEntityId, unsigned>> token_entity_index;
+
+  // A sorted list of (positive) file line numbers and the index into
+  // `entities` of the first entity on each line.
+  std::vector<std::pair<int, unsigned>> file_line_entity_index;
+
+  // Keeps track of which macros were and weren't expanded.
+  EntityIdMap<bool> expanded_macros;
+
+  // Maps things like fragments to where they should/could logically begin.
+  EntityIdMap<unsigned> entity_begin_offset;
+
+  // Maps displayed fragments to where they should/could logically begin.
+  EntityIdMap<unsigned> fragment_begin_offset;
+
+  // Macro substitutions, in the order in which they were imported. Parent
+  // substitutions precede the substitutions nested inside of them.
+  std::vector<MacroSubstitutionRange> macro_ranges;
+
+  // Given that `N` is a logical line number, `physical_line_number[N - 1]` is
+  // a physical line number. These can have repeats, and negative numbers, and
+  // can't be relied upon as being in
+  std::vector<int> physical_line_number;
+
+  // For logical line index `N`, `gutter_line_number[N]` is the line number
+  // shown in the gutter. `0` means nothing is shown, and negative numbers are
+  // shown underlined, because some of the line came from a macro expansion.
+  std::vector<int> gutter_line_number;
+
+  // Maximum number of characters on any given line.
+  int max_logical_columns{1};
+
+  // Number of logical lines in this scene.
+  int num_lines{1};
+
+  // Number file line number seen.
+  int num_file_lines{1};
+
+  // `true` if this scene only contains a prefix of the lines of the document,
+  // i.e. it was published early while the rest was still being imported.
+  bool is_partial{false};
+
+  // Returns the text of `data[data_index]`. This is a view into `text_arena`.
+  inline QStringView Text(unsigned data_index) const {
+    const Data &d = data[data_index];
+    return QStringView(text_arena).sliced(d.text_offset, d.text_length);
+  }
+
+  // Estimate the number of bytes used by this scene.
+  size_t NumBytes(void) const;
+};
+
+using ScenePtr = std::shared_ptr<Scene>;
+using ConstScenePtr = std::shared_ptr<const Scene>;
+
+}  // namespace mx::gui
+
+Q_DECLARE_METATYPE(mx::gui::ScenePtr)
@@ -0,0 +1,918 @@
+/*
+  Copyright (c) 2024-present, Trail of Bits, Inc.
+  All rights reserved.
+
+  This source code is licensed in accordance with the terms specified in
+  the LICENSE file found in the root directory of this source tree.
+*/
+
+#include "SceneBuilder.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <multiplier/Frontend/MacroExpansion.h>
+#include <multiplier/Frontend/MacroVAOpt.h>
+#include <optional>
+
+namespace mx::gui {
+namespace {
+
+// A macro substitution whose expansion state changed, and that is being
+// re-imported by `SceneBuilder::SpliceMacroSubstitutions`.
+struct Splice {
+  // Index of the substitution in the old `Scene::macro_ranges`.
+  unsigned range_index{0u};
+
+  // The re-imported substitution. This is an unfinalized scene, whose first
+  // logical line is the line where the substitution begins.
+  Scene sub;
+
+  // Where the re-imported substitution begins and ends in the new scene.
+  unsigned new_begin_entity{0u};
+  unsigned new_begin_token{0u};
+  int new_begin_document_offset{0};
+  int new_begin_line{1};
+  int new_end_line{1};
+
+  // Cumulative differences between the new and old scenes for everything
+  // that follows this splice. Columns only shift for things that are on
+  // `old_end_line`, i.e. on the same line as the end of the substitution.
+  int old_end_line{1};
+  int delta_entities{0};
+  int delta_tokens{0};
+  int delta_document{0};
+  int delta_lines{0};
+  int delta_columns{0};
+};
+
+// Map a logical position from the old scene to the new scene, given `prev`,
+// the last splice that precedes the position.
+static void ShiftPosition(const Splice *prev, int &line, int &column) {
+  if (!prev) {
+    return;
+  }
+  if (line == prev->old_end_line) {
+    column += prev->delta_columns;
+  }
+  line += prev->delta_lines;
+}
+
+// TODO(pag): Don't hardcode this. Investigate `QStackTextEngine`, the
+//            `QPainter` uses this internally. It seems that
+//            `QPainter::boundingRect` can take a `QTextOption` that can be
+//            configured with tab info.
+static constexpr auto kTabWidth = 4u;
+
+}  // namespace
+
+SceneBuilder::SceneBuilder(SceneConfiguration config_,
+                           FileLocationCache file_cache_)
+    : config(std::move(config_)),
+      file_cache(std::move(file_cache_)) {
+  scene.logical_line_index.emplace_back(0u);
+}
+
+void SceneBuilder::SetCancelCallback(CancelCallback cb) {
+  is_cancelled = std::move(cb);
+}
+
+void SceneBuilder::SetPartialSceneCallback(int num_lines,
+                                           PartialSceneCallback cb) {
+  num_partial_lines = num_lines;
+  partial_scene_ready = std::move(cb);
+}
+
+void SceneBuilder::Import(TokenTreeNode node) {
+  ImportNode(std::move(node));
+}
+
+// Returns the line numbers of the first and last tokens of `file_toks`, or
+// `{0, 0}` if they don't have a location.
+std::pair<int, int> SceneBuilder::FileLines(const TokenRange &file_toks) {
+  auto first_file_loc = file_toks.front().location(file_cache);
+  if (!first_file_loc) {
+    return {0, 0};
+  }
+
+  auto first_line_num = static_cast<int>(first_file_loc->first);
+  if (file_toks.size() == 1u) {
+    return {first_line_num, first_line_num};
+  }
+
+  auto last_file_loc = file_toks.back().location(file_cache);
+  Q_ASSERT(last_file_loc.has_value());
+  if (!last_file_loc) {
+    return {first_line_num, first_line_num};
+  }
+
+  return {first_line_num, static_cast<int>(last_file_loc->first)};
+}
+
+void SceneBuilder::BeginToken(const Token &tok) {
+  related_entity_id = tok.related_entity_id().Pack();
+  document_offset = static_cast<int>(scene.document.size());
+  line_number = 0;
+
+  std::pair<int, int> file_lines;
+  if (expansion_depth) {
+    if (!macro_use_lines) {
+      macro_use_lines = FileLines(macro_use_tokens);
+    }
+    file_lines = macro_use_lines.value();
+  } else {
+    file_lines = FileLines(TokenRange(tok).file_tokens());
+  }
+
+  auto [first_line_num, last_line_num] = file_lines;
+  if (!first_line_num) {
+    return;
+  }
+
+  // The token, or the extent of the use of the macro, are all on one line.
+  if (first_line_num == last_line_num) {
+    line_number = first_line_num;
+  }
+
+  scene.num_file_lines = std::max(scene.num_file_lines, line_number);
+
+  // If we're in an expansion, then negate the line number to signal that it
+  // should be specially colored.
+  if (expansion_depth) {
+    line_number = -line_number;
+  }
+}
+
+void SceneBuilder::AddNewLine(void) {
+  AddChar(QChar::LineFeed);
+  AddEntity();
+  logical_column_number = 1u;
+  scene.num_lines += 1;
+  scene.logical_line_index.emplace_back(
+      static_cast<unsigned>(scene.entities.size()));
+
+  if (0 < line_number) {
+    line_number += 1;
+  }
+}
+
+void SceneBuilder::AddChar(QChar ch) {
+  if (!token_start_column) {
+    token_start_column = logical_column_number;
+  }
+  scene.document.append(ch);
+  token_data.append(ch);
+  token_length += 1;
+  logical_column_number += 1u;
+  added_anything = true;
+}
+
+void SceneBuilder::EndToken(Token tok) {
+  AddEntity();
+  if (added_anything) {
+
+    // The `TokenTree` API often gives us macro tokens, but if we can get a
+    // parsed token, then we actually want that, as it makes scroll to entity
+    // much easier.
+    if (auto parsed_tok = tok.parsed_token()) {
+      scene.tokens.emplace_back(std::move(parsed_tok));
+    } else {
+      scene.tokens.emplace_back(std::move(tok));
+    }
+
+    added_anything = false;
+    token_index += 1u;
+  }
+
+  // Publish what we have so far, so that the top of the document can be shown
+  // while the rest of it is being imported. We do this on a token boundary so
+  // that every entity in the partial scene has its token.
+  if (partial_scene_ready && scene.num_lines > num_partial_lines) {
+    PartialSceneCallback cb = std::move(partial_scene_ready);
+    partial_scene_ready = nullptr;
+
+    Scene partial_scene = scene;
+    partial_scene.is_partial = true;
+    FinalizeScene(partial_scene);
+    cb(std::move(partial_scene));
+  }
+}
+
+void SceneBuilder::AddEntity(void) {
+  if (!token_length) {
+    return;
+  }
+
+  scene.max_logical_columns = std::max(
+      scene.max_logical_columns, token_start_column + token_length);
+
+  // Get or create an index in `Scene::data` for the actual token data.
+  auto data_index_it = data_to_index.find(token_data);
+  unsigned data_index = 0u;
+  if (data_index_it == data_to_index.end()) {
+    data_index = static_cast<unsigned>(scene.data.size());
+    data_to_index.insert(token_data, data_index);
+
+    Data &d = scene.data.emplace_back();
+    d.text_offset = static_cast<unsigned>(scene.text_arena.size());
+    d.text_length = static_cast<unsigned>(token_data.size());
+    scene.text_arena.append(token_data);
+
+  } else {
+    data_index = data_index_it.value();
+  }
+  token_data.clear();
+
+  // Keep track of the related entity ID associated with this entity.
+  if (related_entity_id != kInvalidEntityId) {
+    scene.related_entity_ids.emplace_back(
+      related_entity_id, static_cast<unsigned>(scene.entities.size()));
+  }
+
+  // Add the entity.
+  Entity &e = scene.entities.emplace_back();
+  e.logical_line_number = scene.num_lines;
+  e.logical_column_number = token_start_column;
+  e.data_index = data_index;
+  e.token_index = token_index;
+
+  scene.file_line_number.push_back(line_number);
+  scene.begin_of_entity_in_document.push_back(document_offset);
+
+  token_start_column = 0u;
+  token_length = 0;
+  document_offset = static_cast<int>(scene.document.size());
+}
+
+// Compute the things that can only be computed once we've seen all of the
+// entities of a scene (or of a prefix of the scene).
+void SceneBuilder::FinalizeScene(Scene &scene) {
+  scene.logical_line_index.resize(static_cast<unsigned>(scene.num_lines + 1));
+  scene.logical_line_index.back()
+      = static_cast<unsigned>(scene.entities.size());
+  std::sort(scene.related_entity_ids.begin(), scene.related_entity_ids.end());
+  scene.expanded_macros.Finalize();
+  scene.entity_begin_offset.Finalize();
+  scene.fragment_begin_offset.Finalize();
+
+  auto max_i = scene.logical_line_index.size() - 1u;
+  int last_line_num = -1;
+  int last_gutter_line_num = 0;
+
+  scene.physical_line_number.clear();
+  scene.physical_line_number.reserve(max_i);
+  scene.gutter_line_number.clear();
+  scene.gutter_line_number.reserve(max_i);
+
+  for (auto i = 0u; i < max_i; ++i) {
+    auto line_number = 0;
+    auto backup_line_number = 0;
+    auto gutter_line_number = 0;
+    auto max_e = scene.logical_line_index[i + 1u];
+
+    // Go get the minimum line number. Some might be negative because of a
+    // macro expansion on the line, so we want to highlight that an expansion
+    // happened somewhere on the line.
+    for (auto e = scene.logical_line_index[i]; e < max_e; ++e) {
+      if (auto ln = scene.file_line_number[e]) {
+        if (!gutter_line_number) {
+          gutter_line_number = ln;
+        } else {
+          gutter_line_number = std::min(gutter_line_number, ln);
+        }
+
+        if (!line_number) {
+          line_number = ln;
+        } else if (std::abs(ln) >= std::abs(last_line_num)) {
+          line_number = std::min(line_number, ln);
+
+        // TODO(pag): Sometimes see these; diagnose their source.
+        } else if (!backup_line_number) {
+          backup_line_number = ln;
+        } else {
+          backup_line_number = std::min(backup_line_number, ln);
+        }
+      }
+    }
+
+    if (!line_number) {
+      line_number = backup_line_number ? backup_line_number : last_line_num;
+    }
+
+    scene.physical_line_number.emplace_back(line_number);
+    last_line_num = -std::abs(line_number);
+
+    // Lines without a line number of their own, e.g. the continuation of a
+    // multi-line token, repeat the previous line number, underlined.
+    if (!gutter_line_number) {
+      gutter_line_number = last_gutter_line_num;
+    }
+
+    scene.gutter_line_number.emplace_back(gutter_line_number);
+    if (gutter_line_number) {
+      last_gutter_line_num = -std::abs(gutter_line_number);
+    }
+  }
+
+  // Build the indices used for going to tokens and lines. Sorting keeps the
+  // lowest entity offset first for each key.
+  auto num_entities = static_cast<unsigned>(scene.entities.size());
+  scene.token_entity_index.clear();
+  scene.token_entity_index.reserve(scene.tokens.size());
+  scene.file_line_entity_index.clear();
+
+  auto last_token_index = ~0u;
+  for (auto e = 0u; e < num_entities; ++e) {
+    auto token_index = scene.entities[e].token_index;
+    if (token_index != last_token_index) {
+      last_token_index = token_index;
+      scene.token_entity_index.emplace_back(
+          scene.tokens[token_index].id().Pack(), e);
+    }
+
+    if (auto ln = std::abs(scene.file_line_number[e])) {
+      scene.file_line_entity_index.emplace_back(ln, e);
+    }
+  }
+
+  auto dedup = [] (auto &index) {
+    std::sort(index.begin(), index.end());
+    auto it = std::unique(
+        index.begin(), index.end(),
+        [] (const auto &a, const auto &b) { return a.first == b.first; });
+    index.erase(it, index.end());
+  };
+
+  dedup(scene.token_entity_index);
+  dedup(scene.file_line_entity_index);
+}
+
+Scene SceneBuilder::TakeScene(void) & {
+  FinalizeScene(scene);
+  ShrinkScene(scene);
+  return std::move(scene);
+}
+
+// Release the spare capacity of a complete scene. Scenes can stick around for
+// a long time in the `SceneCache`, and the vectors of a large scene have been
+// grown many times over.
+void SceneBuilder::ShrinkScene(Scene &scene) {
+  scene.document.squeeze();
+  scene.text_arena.squeeze();
+  scene.entities.shrink_to_fit();
+  scene.logical_line_index.shrink_to_fit();
+  scene.file_line_number.shrink_to_fit();
+  scene.begin_of_entity_in_document.shrink_to_fit();
+  scene.data.shrink_to_fit();
+  scene.tokens.shrink_to_fit();
+  scene.related_entity_ids.shrink_to_fit();
+  scene.token_entity_index.shrink_to_fit();
+  scene.file_line_entity_index.shrink_to_fit();
+  scene.expanded_macros.shrink_to_fit();
+  scene.entity_begin_offset.shrink_to_fit();
+  scene.fragment_begin_offset.shrink_to_fit();
+  scene.macro_ranges.shrink_to_fit();
+  scene.physical_line_number.shrink_to_fit();
+  scene.gutter_line_number.shrink_to_fit();
+}
+
+// Re-import only the macro substitutions of `scene` whose expansion state
+// differs from what `config` asks for, and splice the results together with
+// the retained parts of `scene` into `out`. `scene` itself isn't modified, as
+// it may be shared with other widgets by way of the `SceneCache`.
+//
+// NOTE: This is linear in the size of the scene, as everything after the
+//       first splice needs to be shifted, but it avoids re-walking the
+//       `TokenTree` and re-computing token locations, which is where
+//       almost all of the time of a full import goes.
+std::vector<SceneEdit> SceneBuilder::SpliceMacroSubstitutions(
+    const Scene &scene, const SceneConfiguration &config,
+    const FileLocationCache &file_cache, Scene &out) {
+
+  std::vector<SceneEdit> edits;
+  std::vector<Splice> splices;
+  const std::vector<MacroSubstitutionRange> &ranges = scene.macro_ranges;
+
+  // Find the outermost substitutions whose expansion state changed. Anything
+  // nested inside of those is re-imported along with them.
+  for (auto k = 0u, max_k = static_cast<unsigned>(ranges.size()); k < max_k;) {
+    const MacroSubstitutionRange &r = ranges[k];
+    auto expanded = r.force_expanded ||
+                    config.macros_to_expand.contains(r.macro_id) ||
+                    (r.definition_id != kInvalidEntityId &&
+                     config.macros_to_expand.contains(r.definition_id));
+    if (expanded == r.expanded) {
+      ++k;
+    } else {
+      splices.emplace_back().range_index = k;
+      k += 1u + r.num_nested;
+    }
+  }
+
+  if (splices.empty()) {
+    return edits;
+  }
+
+  // Re-import the substitutions, and figure out where they go in the new
+  // scene.
+  const Splice *prev = nullptr;
+  for (Splice &s : splices) {
+    const MacroSubstitutionRange &r = ranges[s.range_index];
+
+    int begin_line = r.begin_line;
+    int begin_column = r.begin_column;
+    ShiftPosition(prev, begin_line, begin_column);
+
+    SceneBuilder builder(config, file_cache);
+    builder.logical_column_number = begin_column;
+    builder.expansion_depth = r.expansion_depth;
+    builder.macro_use_tokens = r.macro_use_tokens;
+    builder.ImportSubstitutionNode(r.node);
+
+    s.sub = std::move(builder.scene);
+    s.new_begin_entity = static_cast<unsigned>(
+        static_cast<int>(r.begin_entity) + (prev ? prev->delta_entities : 0));
+    s.new_begin_token = static_cast<unsigned>(
+        static_cast<int>(r.begin_token) + (prev ? prev->delta_tokens : 0));
+    s.new_begin_document_offset =
+        r.begin_document_offset + (prev ? prev->delta_document : 0);
+    s.new_begin_line = begin_line;
+    s.new_end_line = begin_line + (s.sub.num_lines - 1);
+
+    s.old_end_line = r.end_line;
+    s.delta_entities =
+        (prev ? prev->delta_entities : 0) +
+        static_cast<int>(s.sub.entities.size()) -
+        static_cast<int>(r.end_entity - r.begin_entity);
+    s.delta_tokens =
+        (prev ? prev->delta_tokens : 0) +
+        static_cast<int>(s.sub.tokens.size()) -
+        static_cast<int>(r.end_token - r.begin_token);
+    s.delta_document =
+        (prev ? prev->delta_document : 0) +
+        static_cast<int>(s.sub.document.size()) -
+        (r.end_document_offset - r.begin_document_offset);
+    s.delta_lines = (s.new_end_line - r.end_line);
+    s.delta_columns = builder.logical_column_number - r.end_column;
+
+    SceneEdit &edit = edits.emplace_back();
+    edit.first_line = s.new_begin_line - 1;
+    edit.num_old_lines = r.end_line - r.begin_line + 1;
+    edit.num_new_lines = s.new_end_line - s.new_begin_line + 1;
+    edit.first_token = s.new_begin_token;
+    edit.num_old_tokens = r.end_token - r.begin_token;
+    edit.num_new_tokens = static_cast<unsigned>(s.sub.tokens.size());
+
+    prev = &s;
+  }
+
+  out = Scene();
+  out.data = scene.data;
+  out.text_arena = scene.text_arena;
+  out.num_file_lines = scene.num_file_lines;
+  out.num_lines = scene.num_lines + splices.back().delta_lines;
+
+  auto old_e = 0u;
+  auto old_t = 0u;
+  auto old_doc = 0;
+
+  // Copy the parts of the old scene that aren't being replaced, up to (but
+  // excluding) `to_entity`.
+  auto copy_old = [&] (unsigned to_entity, unsigned to_token, int to_doc,
+                       const Splice *prev_splice) {
+    for (; old_e < to_entity; ++old_e) {
+      Entity e = scene.entities[old_e];
+      auto doc_offset = scene.begin_of_entity_in_document[old_e];
+      ShiftPosition(prev_splice, e.logical_line_number,
+                    e.logical_column_number);
+      if (prev_splice) {
+        e.token_index = static_cast<unsigned>(
+            static_cast<int>(e.token_index) + prev_splice->delta_tokens);
+        doc_offset += prev_splice->delta_document;
+      }
+      out.entities.push_back(e);
+      out.file_line_number.push_back(scene.file_line_number[old_e]);
+      out.begin_of_entity_in_document.push_back(doc_offset);
+    }
+
+    for (; old_t < to_token; ++old_t) {
+      out.tokens.emplace_back(scene.tokens[old_t]);
+    }
+
+    out.document.append(QStringView(scene.document).mid(
+        old_doc, to_doc - old_doc));
+    old_doc = to_doc;
+  };
+
+  // Maps the offset of an entity in the old scene to its offset in the new
+  // scene. If the entity was replaced then this returns `~0u`, or if `clamp`
+  // is `true`, the offset of the beginning of the replacement.
+  auto map_entity = [&] (unsigned o, bool clamp) -> unsigned {
+    auto it = std::partition_point(
+        splices.begin(), splices.end(),
+        [&] (const Splice &s) {
+          return o >= ranges[s.range_index].end_entity;
+        });
+    if (it != splices.end() && ranges[it->range_index].begin_entity <= o) {
+      return clamp ? it->new_begin_entity : ~0u;
+    }
+    if (it == splices.begin()) {
+      return o;
+    }
+    return static_cast<unsigned>(
+        static_cast<int>(o) + std::prev(it)->delta_entities);
+  };
+
+  prev = nullptr;
+  for (Splice &s : splices) {
+    const MacroSubstitutionRange &r = ranges[s.range_index];
+    copy_old(r.begin_entity, r.begin_token, r.begin_document_offset, prev);
+
+    auto line_base = s.new_begin_line - 1;
+    auto entity_base = static_cast<unsigned>(out.entities.size());
+    auto token_base = static_cast<unsigned>(out.tokens.size());
+    auto doc_base = static_cast<int>(out.document.size());
+    auto data_base = static_cast<unsigned>(out.data.size());
+    auto text_base = static_cast<unsigned>(out.text_arena.size());
+
+    Q_ASSERT(entity_base == s.new_begin_entity);
+    Q_ASSERT(token_base == s.new_begin_token);
+    Q_ASSERT(doc_base == s.new_begin_document_offset);
+
+    for (auto i = 0u, max_i = static_cast<unsigned>(s.sub.entities.size());
+         i < max_i; ++i) {
+      Entity e = s.sub.entities[i];
+      e.logical_line_number += line_base;
+      e.token_index += token_base;
+      e.data_index += data_base;
+      out.entities.push_back(e);
+      out.file_line_number.push_back(s.sub.file_line_number[i]);
+      out.begin_of_entity_in_document.push_back(
+          s.sub.begin_of_entity_in_document[i] + doc_base);
+    }
+
+    for (Token &tok : s.sub.tokens) {
+      out.tokens.emplace_back(std::move(tok));
+    }
+
+    for (Data data : s.sub.data) {
+      data.text_offset += text_base;
+      out.data.push_back(data);
+    }
+
+    out.text_arena.append(s.sub.text_arena);
+
+    out.document.append(s.sub.document);
+
+    for (auto [id, offset] : s.sub.related_entity_ids) {
+      out.related_entity_ids.emplace_back(id, offset + entity_base);
+    }
+
+    for (auto [id, expanded] : s.sub.expanded_macros) {
+      out.expanded_macros.emplace(id, expanded);
+    }
+
+    out.num_file_lines = std::max(out.num_file_lines, s.sub.num_file_lines);
+
+    old_e = r.end_entity;
+    old_t = r.end_token;
+    old_doc = r.end_document_offset;
+    prev = &s;
+  }
+
+  copy_old(static_cast<unsigned>(scene.entities.size()),
+           static_cast<unsigned>(scene.tokens.size()),
+           static_cast<int>(scene.document.size()), prev);
+
+  // Carry over the related entities of retained entities.
+  for (auto [id, offset] : scene.related_entity_ids) {
+    if (auto new_offset = map_entity(offset, false); new_offset != ~0u) {
+      out.related_entity_ids.emplace_back(id, new_offset);
+    }
+  }
+
+  // Carry over the expansion states of retained macros.
+  for (auto [id, expanded] : scene.expanded_macros) {
+    out.expanded_macros.emplace(id, expanded);
+  }
+
+  // Carry over the macro ranges. The replaced ones are swapped out for the
+  // ranges of the re-imported substitutions. For a retained range, only the
+  // splices that precede it in pre-order affect its beginning, and only the
+  // splices nested inside of it additionally affect its end.
+  auto sk = 0u;
+  for (auto k = 0u, max_k = static_cast<unsigned>(ranges.size()); k < max_k;) {
+    if (sk < splices.size() && splices[sk].range_index == k) {
+      const Splice &s = splices[sk++];
+      auto line_base = s.new_begin_line - 1;
+      for (const MacroSubstitutionRange &sub_r : s.sub.macro_ranges) {
+        MacroSubstitutionRange &new_r = out.macro_ranges.emplace_back(sub_r);
+        new_r.begin_entity += s.new_begin_entity;
+        new_r.end_entity += s.new_begin_entity;
+        new_r.begin_token += s.new_begin_token;
+        new_r.end_token += s.new_begin_token;
+        new_r.begin_document_offset += s.new_begin_document_offset;
+        new_r.end_document_offset += s.new_begin_document_offset;
+        new_r.begin_line += line_base;
+        new_r.end_line += line_base;
+      }
+      k += 1u + ranges[k].num_nested;
+      continue;
+    }
+
+    const MacroSubstitutionRange &r = ranges[k];
+    auto last_nested = k + r.num_nested;
+    auto begin_it = std::partition_point(
+        splices.begin(), splices.end(),
+        [=] (const Splice &s) { return s.range_index < k; });
+    auto end_it = std::partition_point(
+        begin_it, splices.end(),
+        [=] (const Splice &s) { return s.range_index <= last_nested; });
+
+    const Splice *before_begin =
+        begin_it == splices.begin() ? nullptr : &*std::prev(begin_it);
+    const Splice *before_end =
+        end_it == splices.begin() ? nullptr : &*std::prev(end_it);
+
+    MacroSubstitutionRange &new_r = out.macro_ranges.emplace_back(r);
+    if (before_begin) {
+      new_r.begin_entity = static_cast<unsigned>(
+          static_cast<int>(r.begin_entity) + before_begin->delta_entities);
+      new_r.begin_token = static_cast<unsigned>(
+          static_cast<int>(r.begin_token) + before_begin->delta_tokens);
+      new_r.begin_document_offset += before_begin->delta_document;
+      ShiftPosition(before_begin, new_r.begin_line, new_r.begin_column);
+    }
+    if (before_end) {
+      new_r.end_entity = static_cast<unsigned>(
+          static_cast<int>(r.end_entity) + before_end->delta_entities);
+      new_r.end_token = static_cast<unsigned>(
+          static_cast<int>(r.end_token) + before_end->delta_tokens);
+      new_r.end_document_offset += before_end->delta_document;
+      ShiftPosition(before_end, new_r.end_line, new_r.end_column);
+    }
+    for (auto it = begin_it; it != end_it; ++it) {
+      new_r.num_nested = static_cast<unsigned>(
+          static_cast<int>(new_r.num_nested) +
+          static_cast<int>(it->sub.macro_ranges.size()) -
+          static_cast<int>(1u + ranges[it->range_index].num_nested));
+    }
+    ++k;
+  }
+
+  // Carry over the beginnings of entities and fragments. The first value
+  // added for an ID wins, so macros go first, as they are re-derived from
+  // their ranges, which is more precise than `map_entity`. Next come the
+  // re-imported substitutions, and then the retained parts of the old scene.
+  for (const MacroSubstitutionRange &r : out.macro_ranges) {
+    out.entity_begin_offset.emplace(r.macro_id, r.begin_entity);
+  }
+  for (const Splice &s : splices) {
+    for (auto [id, offset] : s.sub.entity_begin_offset) {
+      out.entity_begin_offset.emplace(id, offset + s.new_begin_entity);
+    }
+  }
+  for (auto [id, offset] : scene.entity_begin_offset) {
+    out.entity_begin_offset.emplace(id, map_entity(offset, true));
+  }
+  for (auto [id, offset] : scene.fragment_begin_offset) {
+    out.fragment_begin_offset.emplace(id, map_entity(offset, true));
+  }
+
+  // Re-derive the per-line information.
+  for (const Entity &e : out.entities) {
+    out.max_logical_columns = std::max(
+        out.max_logical_columns,
+        e.logical_column_number + static_cast<int>(
+            out.data[e.data_index].text_length));
+  }
+
+  out.logical_line_index.reserve(static_cast<unsigned>(out.num_lines + 1));
+  auto ei = 0u;
+  auto max_ei = static_cast<unsigned>(out.entities.size());
+  for (auto line = 1; line <= out.num_lines; ++line) {
+    while (ei < max_ei && out.entities[ei].logical_line_number < line) {
+      ++ei;
+    }
+    out.logical_line_index.push_back(ei);
+  }
+
+  FinalizeScene(out);
+  ShrinkScene(out);
+  return edits;
+}
+
+// Import a choice node.
+void SceneBuilder::ImportChoiceNode(ChoiceTokenTreeNode node) {
+  std::optional<TokenTreeNode> chosen_node;
+  RawEntityId chosen_fragment_id = kInvalidEntityId;
+  unsigned eo = static_cast<unsigned>(scene.entities.size());
+
+  for (auto &item : node.children()) {
+    RawEntityId fragment_id = item.first.id().Pack();
+
+    // Keep track of fragment locations.
+    scene.entity_begin_offset.emplace(fragment_id, eo);
+
+    if (config.scene_overrides.contains(fragment_id) || !chosen_node) {
+      chosen_node.reset();
+      chosen_node.emplace(std::move(item.second));
+      chosen_fragment_id = fragment_id;
+    }
+  }
+
+  if (chosen_node) {
+    scene.fragment_begin_offset.emplace(chosen_fragment_id, eo);
+    ImportNode(std::move(chosen_node.value()));
+  }
+}
+
+// Import a substitution node.
+void SceneBuilder::ImportSubstitutionNode(SubstitutionTokenTreeNode node) {
+  RawEntityId def_id = kInvalidEntityId;
+  std::optional<Macro> macro;
+  auto sub = node.macro();
+  auto force_expand = false;
+  if (std::holds_alternative<MacroSubstitution>(sub)) {
+    auto &sub_node = std::get<MacroSubstitution>(sub);
+    macro = sub_node;
+
+    // Global expansion of a macro is based on the definition ID.
+    if (auto exp = MacroExpansion::from(macro.value())) {
+      if (auto def = exp->definition()) {
+        def_id = def->id().Pack();
+      }
+
+    } else if (sub_node.last_fully_substituted_token().kind() ==
+               TokenKind::HEADER_NAME) {
+      force_expand = true;
+
+    } else if (macro->kind() == MacroKind::CONCATENATE) {
+      force_expand = true;
+    }
+  } else {
+    macro = std::get<MacroVAOpt>(sub);
+  }
+
+  const RawEntityId macro_id = macro->id().Pack();
+
+  // Keep track of which macros were expanded.
+  auto expanded = force_expand || config.macros_to_expand.contains(macro_id);
+
+  if (def_id != kInvalidEntityId) {
+    expanded = expanded || config.macros_to_expand.contains(def_id);
+    scene.expanded_macros.emplace(def_id, expanded);
+  }
+  scene.expanded_macros.emplace(macro_id, expanded);
+
+  // Keep track of macro locations.
+  scene.entity_begin_offset.emplace(
+      macro_id, static_cast<unsigned>(scene.entities.size()));
+
+  // Keep track of what this substitution contributes to the scene, so that we
+  // can later re-import only this substitution if its expansion is toggled.
+  auto range_index = scene.macro_ranges.size();
+  {
+    MacroSubstitutionRange &range = scene.macro_ranges.emplace_back(node);
+    range.macro_id = macro_id;
+    range.definition_id = def_id;
+    range.force_expanded = force_expand;
+    range.expanded = expanded;
+    range.expansion_depth = expansion_depth;
+    range.macro_use_tokens = macro_use_tokens;
+    range.begin_entity = static_cast<unsigned>(scene.entities.size());
+    range.begin_token = token_index;
+    range.begin_document_offset = static_cast<int>(scene.document.size());
+    range.begin_line = scene.num_lines;
+    range.begin_column = logical_column_number;
+  }
+
+  if (expanded) {
+    if (!expansion_depth) {
+      macro_use_tokens = macro->use_tokens().file_tokens();
+      macro_use_lines.reset();
+    }
+    ++expansion_depth;
+
+    ImportNode(node.after());
+    --expansion_depth;
+  } else {
+    ImportNode(node.before());
+  }
+
+  // NOTE: Nested substitutions may have reallocated `macro_ranges`.
+  MacroSubstitutionRange &range = scene.macro_ranges[range_index];
+  range.end_entity = static_cast<unsigned>(scene.entities.size());
+  range.end_token = token_index;
+  range.end_document_offset = static_cast<int>(scene.document.size());
+  range.end_line = scene.num_lines;
+  range.end_column = logical_column_number;
+  range.num_nested = static_cast<unsigned>(
+      scene.macro_ranges.size() - range_index - 1u);
+}
+
+// Import a sequence of nodes.
+void SceneBuilder::ImportSequenceNode(SequenceTokenTreeNode node) {
+  for (auto child_node : node.children()) {
+    ImportNode(std::move(child_node));
+    if (cancelled) {
+      return;
+    }
+  }
+}
+
+// Import a node containing a token.
+void SceneBuilder::ImportTokenNode(TokenTokenTreeNode node) {
+
+  // Get the data of this token in Qt's native format.
+  Token token = node.token();
+  std::string_view utf8_data = token.data();
+  if (utf8_data.empty()) {
+    return;
+  }
+
+  QString utf16_data = QString::fromUtf8(
+      utf8_data.data(), static_cast<qsizetype>(utf8_data.size()));
+
+  RawEntityId related_entity_id = token.related_entity_id().Pack();
+  if (related_entity_id != kInvalidEntityId) {
+
+    // Support entity renaming.
+    if (auto rename_it = config.new_entity_names.find(related_entity_id);
+        rename_it != config.new_entity_names.end()) {
+      utf16_data = rename_it.value();
+    }
+  }
+
+  // The new name is empty. That's weird.
+  if (utf16_data.isEmpty()) {
+    Q_ASSERT(false);
+    return;
+  }
+
+  BeginToken(token);
+
+  for (QChar ch : utf16_data) {
+    switch (ch.unicode()) {
+
+      // TODO(pag): Configurable tab width; tab stops
+      case QChar::Tabulation:
+        for (auto i = 0u; i < kTabWidth; ++i) {
+          AddChar(QChar::Space);
+        }
+        break;
+
+      case QChar::Space:
+      case QChar::Nbsp:
+        AddChar(QChar::Space);
+        break;
+
+      case QChar::ParagraphSeparator:
+      case QChar::LineFeed:
+      case QChar::LineSeparator: {
+        AddNewLine();
+        break;
+      }
+
+      case QChar::CarriageReturn:
+        continue;
+
+      default:
+        AddChar(ch);
+        break;
+    }
+  }
+
+  EndToken(std::move(token));
+}
+
+// Import a generic node, dispatching to the relevant node.
+void SceneBuilder::ImportNode(TokenTreeNode node) {
+  if (cancelled || (is_cancelled && is_cancelled())) {
+    cancelled = true;
+    return;
+  }
+
+  switch (node.kind()) {
+    case TokenTreeNodeKind::EMPTY:
+      break;
+    case TokenTreeNodeKind::TOKEN:
+      ImportTokenNode(
+          std::move(reinterpret_cast<TokenTokenTreeNode &&>(node)));
+      break;
+    case TokenTreeNodeKind::CHOICE:
+      ImportChoiceNode(
+          std::move(reinterpret_cast<ChoiceTokenTreeNode &&>(node)));
+      break;
+    case TokenTreeNodeKind::SUBSTITUTION:
+      ImportSubstitutionNode(
+          std::move(reinterpret_cast<SubstitutionTokenTreeNode &&>(node)));
+      break;
+    case TokenTreeNodeKind::SEQUENCE:
+      ImportSequenceNode(
+          std::move(reinterpret_cast<SequenceTokenTreeNode &&>(node)));
+      break;
+  }
+}
+
+}  // namespace mx::gui
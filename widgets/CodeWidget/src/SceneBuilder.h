@@ -0,0 +1,140 @@
+/*
+  Copyright (c) 2024-present, Trail of Bits, Inc.
+  All rights reserved.
+
+  This source code is licensed in accordance with the terms specified in
+  the LICENSE file found in the root directory of this source tree.
+*/
+
+#pragma once
+
+#include <QMap>
+#include <QSet>
+#include <QString>
+
+#include <functional>
+#include <multiplier/Frontend/TokenTree.h>
+#include <multiplier/Index.h>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "Scene.h"
+
+namespace mx::gui {
+
+//! Sets of entities that configure what gets shown from a `TokenTree`. The
+//! builder works on a snapshot of these, so that the widget is free to change
+//! its own copies while a scene is being built.
+struct SceneConfiguration {
+  QSet<RawEntityId> macros_to_expand;
+  QMap<RawEntityId, QString> new_entity_names;
+  QSet<RawEntityId> scene_overrides;
+};
+
+//! Describes one part of a scene that was replaced by
+//! `SceneBuilder::SpliceMacroSubstitutions`. Lines and tokens are in terms of
+//! the new scene.
+struct SceneEdit {
+  // Zero-based index of the first logical line of the replacement, and the
+  // number of logical lines touched before and after the replacement.
+  int first_line{0};
+  int num_old_lines{0};
+  int num_new_lines{0};
+
+  // Index of the first replaced token, and the number of tokens before and
+  // after the replacement.
+  unsigned first_token{0u};
+  unsigned num_old_tokens{0u};
+  unsigned num_new_tokens{0u};
+};
+
+// The scene builder helps to populate a given `Scene`. It keeps track of state
+// that doesn't need to persist past the creation of a `Scene`.
+class SceneBuilder {
+ public:
+  using CancelCallback = std::function<bool(void)>;
+  using PartialSceneCallback = std::function<void(Scene)>;
+
+  //! `file_cache` is shared with everything else that computes locations, so
+  //! that the line tables of files are only computed once.
+  SceneBuilder(SceneConfiguration config_, FileLocationCache file_cache_);
+
+  //! Periodically invoked during the import; if it returns `true` then the
+  //! import is abandoned.
+  void SetCancelCallback(CancelCallback cb);
+
+  //! Invoke `cb` once with a copy of the scene, finalized as if it were a
+  //! complete scene, as soon as the first `num_lines` logical lines have been
+  //! imported.
+  void SetPartialSceneCallback(int num_lines, PartialSceneCallback cb);
+
+  //! Import the tree rooted at `node` into the scene.
+  void Import(TokenTreeNode node);
+
+  //! Returns `true` if the cancel callback asked us to stop.
+  inline bool WasCancelled(void) const noexcept {
+    return cancelled;
+  }
+
+  //! Finalize and return the scene.
+  Scene TakeScene(void) &;
+
+  //! Re-import only the macro substitutions of `scene` whose expansion state
+  //! differs from what `config` asks for, and splice the results into `out`,
+  //! leaving `scene` unchanged. Returns the list of edits made, in order,
+  //! which is empty (and `out` is left alone) if nothing changed.
+  static std::vector<SceneEdit> SpliceMacroSubstitutions(
+      const Scene &scene, const SceneConfiguration &config,
+      const FileLocationCache &file_cache, Scene &out);
+
+ private:
+  static void FinalizeScene(Scene &scene);
+  static void ShrinkScene(Scene &scene);
+
+  std::pair<int, int> FileLines(const TokenRange &file_toks);
+  void BeginToken(const Token &tok);
+  void AddNewLine(void);
+  void AddChar(QChar ch);
+  void EndToken(Token tok);
+  void AddEntity(void);
+
+  void ImportChoiceNode(ChoiceTokenTreeNode node);
+  void ImportSubstitutionNode(SubstitutionTokenTreeNode node);
+  void ImportSequenceNode(SequenceTokenTreeNode node);
+  void ImportTokenNode(TokenTokenTreeNode node);
+  void ImportNode(TokenTreeNode node);
+
+  const SceneConfiguration config;
+
+  Scene scene;
+
+  // Maps unique `QString`s to an index in `Scene::data`.
+  QMap<QString, unsigned> data_to_index;
+
+  int logical_column_number{1};
+  int token_start_column{0};
+  int token_length{0};
+  int expansion_depth{0};
+  int document_offset{0};
+  int line_number{0};
+  unsigned token_index{0u};
+  bool added_anything{false};
+  bool cancelled{false};
+  RawEntityId related_entity_id{kInvalidEntityId};
+  FileLocationCache file_cache;
+  QString token_data;
+  TokenRange macro_use_tokens;
+
+  // The first and last file lines of `macro_use_tokens`. Every token of an
+  // expansion is attributed to the use of the outermost macro, so we only
+  // locate that use once.
+  std::optional<std::pair<int, int>> macro_use_lines;
+
+  CancelCallback is_cancelled;
+
+  int num_partial_lines{0};
+  PartialSceneCallback partial_scene_ready;
+};
+
+}  // namespace mx::gui
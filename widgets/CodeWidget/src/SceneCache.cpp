@@ -0,0 +1,176 @@
+/*
+  Copyright (c) 2024-present, Trail of Bits, Inc.
+  All rights reserved.
+
+  This source code is licensed in accordance with the terms specified in
+  the LICENSE file found in the root directory of this source tree.
+*/
+
+#include "SceneCache.h"
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include "SceneBuilder.h"
+
+namespace mx::gui {
+namespace {
+
+struct Entry {
+  SceneCacheKey key;
+  ConstScenePtr scene;
+  size_t num_bytes{0u};
+  size_t num_tokens{0u};
+};
+
+using EntryList = std::list<Entry>;
+
+// State shared by all code widgets.
+struct SceneCacheState {
+  std::mutex lock;
+
+  // Most recently used scenes are at the front.
+  EntryList entries;
+  std::map<SceneCacheKey, EntryList::iterator> key_to_entry;
+
+  size_t memory_budget{SceneCache::kDefaultMemoryBudget};
+  size_t memory_usage{0u};
+  size_t num_tokens{0u};
+  size_t num_hits{0u};
+  size_t num_misses{0u};
+
+  // Evict the least recently used scenes until we're under budget.
+  void Evict(void) {
+    while (memory_usage > memory_budget && !entries.empty()) {
+      Entry &lru = entries.back();
+      memory_usage -= lru.num_bytes;
+      num_tokens -= lru.num_tokens;
+      key_to_entry.erase(lru.key);
+      entries.pop_back();
+    }
+  }
+};
+
+static SceneCacheState &State(void) {
+  static SceneCacheState state;
+  return state;
+}
+
+}  // namespace
+
+SceneCacheKey::SceneCacheKey(RawEntityId containing_entity_id_,
+                             const SceneConfiguration &config)
+    : containing_entity_id(containing_entity_id_),
+      macros_to_expand(config.macros_to_expand.begin(),
+                       config.macros_to_expand.end()),
+      scene_overrides(config.scene_overrides.begin(),
+                      config.scene_overrides.end()) {
+
+  // `QSet`s are unordered, so put things into a canonical order.
+  std::sort(macros_to_expand.begin(), macros_to_expand.end());
+  std::sort(scene_overrides.begin(), scene_overrides.end());
+
+  // `QMap`s are already ordered by key.
+  new_entity_names.reserve(static_cast<size_t>(config.new_entity_names.size()));
+  for (auto it = config.new_entity_names.keyValueBegin(),
+            end = config.new_entity_names.keyValueEnd(); it != end; ++it) {
+    new_entity_names.emplace_back(it->first, it->second);
+  }
+}
+
+bool SceneCacheKey::operator<(const SceneCacheKey &that) const {
+  return std::tie(containing_entity_id, macros_to_expand, new_entity_names,
+                  scene_overrides) <
+         std::tie(that.containing_entity_id, that.macros_to_expand,
+                  that.new_entity_names, that.scene_overrides);
+}
+
+// Find a scene, marking it as most recently used.
+ConstScenePtr SceneCache::Find(const SceneCacheKey &key) {
+  SceneCacheState &state = State();
+  std::lock_guard<std::mutex> locker(state.lock);
+
+  auto it = state.key_to_entry.find(key);
+  if (it == state.key_to_entry.end()) {
+    ++state.num_misses;
+    return {};
+  }
+
+  ++state.num_hits;
+  auto entry_it = it->second;
+  if (entry_it != state.entries.begin()) {
+    state.entries.splice(state.entries.begin(), state.entries, entry_it);
+  }
+  return entry_it->scene;
+}
+
+// Add a scene to the cache, evicting least recently used scenes if we're over
+// budget.
+void SceneCache::Insert(SceneCacheKey key, ConstScenePtr scene) {
+  if (!scene || scene->is_partial) {
+    return;
+  }
+
+  auto num_bytes = scene->NumBytes();
+  auto num_tokens = scene->tokens.size();
+
+  SceneCacheState &state = State();
+  std::lock_guard<std::mutex> locker(state.lock);
+
+  if (auto it = state.key_to_entry.find(key); it != state.key_to_entry.end()) {
+    state.memory_usage -= it->second->num_bytes;
+    state.num_tokens -= it->second->num_tokens;
+    state.entries.erase(it->second);
+    state.key_to_entry.erase(it);
+  }
+
+  if (num_bytes > state.memory_budget) {
+    return;
+  }
+
+  state.memory_usage += num_bytes;
+  state.num_tokens += num_tokens;
+  state.entries.push_front(
+      Entry{std::move(key), std::move(scene), num_bytes, num_tokens});
+  state.key_to_entry.emplace(state.entries.front().key, state.entries.begin());
+
+  state.Evict();
+}
+
+// Drop all cached scenes.
+void SceneCache::Clear(void) {
+  SceneCacheState &state = State();
+  std::lock_guard<std::mutex> locker(state.lock);
+  state.entries.clear();
+  state.key_to_entry.clear();
+  state.memory_usage = 0u;
+  state.num_tokens = 0u;
+}
+
+// Change the memory budget, evicting scenes if necessary.
+void SceneCache::SetMemoryBudget(size_t num_bytes) {
+  SceneCacheState &state = State();
+  std::lock_guard<std::mutex> locker(state.lock);
+  state.memory_budget = num_bytes;
+  state.Evict();
+}
+
+// Returns the current counters.
+SceneCacheStatistics SceneCache::Statistics(void) {
+  SceneCacheState &state = State();
+  std::lock_guard<std::mutex> locker(state.lock);
+
+  SceneCacheStatistics stats;
+  stats.num_hits = state.num_hits;
+  stats.num_misses = state.num_misses;
+  stats.num_scenes = state.entries.size();
+  stats.num_tokens = state.num_tokens;
+  stats.memory_usage = state.memory_usage;
+  stats.memory_budget = state.memory_budget;
+  return stats;
+}
+
+}  // namespace mx::gui
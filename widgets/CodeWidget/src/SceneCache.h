@@ -0,0 +1,78 @@
+/*
+  Copyright (c) 2024-present, Trail of Bits, Inc.
+  All rights reserved.
+
+  This source code is licensed in accordance with the terms specified in
+  the LICENSE file found in the root directory of this source tree.
+*/
+
+#pragma once
+
+#include <QString>
+
+#include <cstddef>
+#include <multiplier/Index.h>
+#include <utility>
+#include <vector>
+
+#include "Scene.h"
+
+namespace mx::gui {
+
+struct SceneConfiguration;
+
+//! Identifies a scene by the entity whose `TokenTree` it was built from, and
+//! by the configuration that it was built with.
+struct SceneCacheKey {
+  RawEntityId containing_entity_id{kInvalidEntityId};
+  std::vector<RawEntityId> macros_to_expand;
+  std::vector<std::pair<RawEntityId, QString>> new_entity_names;
+  std::vector<RawEntityId> scene_overrides;
+
+  SceneCacheKey(RawEntityId containing_entity_id_,
+                const SceneConfiguration &config);
+
+  bool operator<(const SceneCacheKey &that) const;
+};
+
+//! Counters describing the `SceneCache`.
+struct SceneCacheStatistics {
+  size_t num_hits{0u};
+  size_t num_misses{0u};
+  size_t num_scenes{0u};
+  size_t num_tokens{0u};
+  size_t memory_usage{0u};
+  size_t memory_budget{0u};
+};
+
+//! A process-wide LRU cache of complete scenes, bounded by a memory budget.
+//! Scenes are immutable once they're in the cache, so that code widgets that
+//! show the same thing in the same way can share one scene. Evicting a scene
+//! only drops the cache's reference to it.
+//!
+//! NOTE: Scenes hold onto `Token`s, and so the cache must be cleared when
+//!       the index changes.
+class SceneCache {
+ public:
+  //! Default memory budget, in bytes.
+  static constexpr size_t kDefaultMemoryBudget = 256u * 1024u * 1024u;
+
+  //! Find a scene, marking it as most recently used. Returns `nullptr` and
+  //! counts a miss if the scene isn't cached.
+  static ConstScenePtr Find(const SceneCacheKey &key);
+
+  //! Add a scene to the cache, evicting least recently used scenes if we're
+  //! over budget. Scenes bigger than the budget aren't cached.
+  static void Insert(SceneCacheKey key, ConstScenePtr scene);
+
+  //! Drop all cached scenes.
+  static void Clear(void);
+
+  //! Change the memory budget, evicting scenes if necessary.
+  static void SetMemoryBudget(size_t num_bytes);
+
+  //! Returns the current counters.
+  static SceneCacheStatistics Statistics(void);
+};
+
+}  // namespace mx::gui
@@ -0,0 +1,78 @@
+/*
+  Copyright (c) 2024-present, Trail of Bits, Inc.
+  All rights reserved.
+
+  This source code is licensed in accordance with the terms specified in
+  the LICENSE file found in the root directory of this source tree.
+*/
+
+#include "ScrollMarkerWidget.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+
+#include <algorithm>
+
+namespace mx::gui {
+
+// Width of the strip, and height of each marker.
+static constexpr int kStripWidth = 6;
+static constexpr int kMarkerHeight = 2;
+
+struct ScrollMarkerWidget::PrivateData final {
+  std::vector<int> line_indices;
+  int num_lines{1};
+  QColor color;
+};
+
+ScrollMarkerWidget::ScrollMarkerWidget(QWidget *parent)
+    : QWidget(parent),
+      d(new PrivateData) {
+  setFixedWidth(kStripWidth);
+  setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Expanding);
+}
+
+ScrollMarkerWidget::~ScrollMarkerWidget(void) {}
+
+void ScrollMarkerWidget::SetMarkers(std::vector<int> line_indices,
+                                    int num_lines, QColor color) {
+  d->line_indices = std::move(line_indices);
+  d->num_lines = std::max(1, num_lines);
+  d->color = color;
+  update();
+}
+
+void ScrollMarkerWidget::ClearMarkers(void) {
+  if (!d->line_indices.empty()) {
+    d->line_indices.clear();
+    update();
+  }
+}
+
+void ScrollMarkerWidget::paintEvent(QPaintEvent *event) {
+  if (d->line_indices.empty() || !d->color.isValid()) {
+    return;
+  }
+
+  QPainter painter(this);
+  auto strip_height = static_cast<qreal>(height() - kMarkerHeight);
+  auto dirty_rect = event->rect();
+
+  // Many occurrences can map to the same row of pixels, so only draw each row
+  // once.
+  auto prev_y = -1;
+  for (int line_index : d->line_indices) {
+    auto y = static_cast<int>((line_index * strip_height) / d->num_lines);
+    if (y == prev_y) {
+      continue;
+    }
+
+    prev_y = y;
+    QRect marker(0, y, kStripWidth, kMarkerHeight);
+    if (marker.intersects(dirty_rect)) {
+      painter.fillRect(marker, d->color);
+    }
+  }
+}
+
+}  // namespace mx::gui
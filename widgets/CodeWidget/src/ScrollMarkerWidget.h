@@ -0,0 +1,53 @@
+/*
+  Copyright (c) 2024-present, Trail of Bits, Inc.
+  All rights reserved.
+
+  This source code is licensed in accordance with the terms specified in
+  the LICENSE file found in the root directory of this source tree.
+*/
+
+#pragma once
+
+#include <QColor>
+#include <QWidget>
+
+#include <memory>
+#include <vector>
+
+namespace mx::gui {
+
+//! A thin strip beside the vertical scrollbar of a code widget that marks the
+//! lines on which the current entity occurs, including those that are
+//! outside of the viewport.
+class ScrollMarkerWidget Q_DECL_FINAL : public QWidget {
+  Q_OBJECT
+
+ public:
+  //! Constructor
+  ScrollMarkerWidget(QWidget *parent = nullptr);
+
+  //! Destructor
+  virtual ~ScrollMarkerWidget(void);
+
+  //! Disabled copy constructor
+  ScrollMarkerWidget(const ScrollMarkerWidget &) = delete;
+
+  //! Disabled assignment
+  ScrollMarkerWidget &operator=(const ScrollMarkerWidget &) = delete;
+
+  //! Mark the sorted, zero-based, logical line indices in `line_indices`, out
+  //! of `num_lines` total lines, using `color`.
+  void SetMarkers(std::vector<int> line_indices, int num_lines, QColor color);
+
+  //! Remove all markers.
+  void ClearMarkers(void);
+
+ protected:
+  void paintEvent(QPaintEvent *event) Q_DECL_FINAL;
+
+ private:
+  struct PrivateData;
+  std::unique_ptr<PrivateData> d;
+};
+
+}  // namespace mx::gui
@@ -0,0 +1,117 @@
+/*
+  Copyright (c) 2024-present, Trail of Bits, Inc.
+  All rights reserved.
+
+  This source code is licensed in accordance with the terms specified in
+  the LICENSE file found in the root directory of this source tree.
+*/
+
+#include "SearchRunnable.h"
+
+#include <QElapsedTimer>
+
+namespace mx::gui {
+
+// Publish a batch of results once it gets this big, or once this much time
+// has passed since the last batch, whichever comes first.
+static constexpr size_t kMaxBatchSize = 4096u;
+static constexpr qint64 kMaxBatchDelayMs = 50;
+
+SearchRunnable::~SearchRunnable(void) {}
+
+bool SearchRunnable::IsCancelled(void) const {
+  return version_number->load() != captured_version_number;
+}
+
+void SearchRunnable::Publish(SearchResults &results) {
+  if (!results.empty()) {
+    emit ResultsFound(captured_version_number, std::move(results));
+    results = {};
+  }
+}
+
+// Find all non-overlapping matches in the document.
+void SearchRunnable::Scan(const QRegularExpression &regex) {
+  QElapsedTimer timer;
+  timer.start();
+
+  SearchResults results;
+  QRegularExpressionMatchIterator it = regex.globalMatch(document);
+  while (it.hasNext()) {
+    if (IsCancelled()) {
+      return;
+    }
+
+    QRegularExpressionMatch match = it.next();
+    results.emplace_back(match.capturedStart(), match.capturedLength());
+
+    if (results.size() >= kMaxBatchSize ||
+        timer.elapsed() >= kMaxBatchDelayMs) {
+      Publish(results);
+      timer.restart();
+    }
+  }
+
+  Publish(results);
+}
+
+// Try to match at the offset of each candidate. The candidates are in
+// document order, so we can skip those that overlap the previous match, just
+// like `QRegularExpression::globalMatch` would.
+void SearchRunnable::Narrow(const QRegularExpression &regex) {
+  QElapsedTimer timer;
+  timer.start();
+
+  SearchResults results;
+  qsizetype next_offset = 0;
+  for (auto [offset, length] : candidates.value()) {
+    if (offset < next_offset) {
+      continue;
+    }
+
+    if (IsCancelled()) {
+      return;
+    }
+
+    QRegularExpressionMatch match = regex.match(
+        document, offset, QRegularExpression::NormalMatch,
+        QRegularExpression::AnchorAtOffsetMatchOption);
+    if (!match.hasMatch()) {
+      continue;
+    }
+
+    results.emplace_back(match.capturedStart(), match.capturedLength());
+    next_offset = match.capturedEnd();
+
+    if (results.size() >= kMaxBatchSize ||
+        timer.elapsed() >= kMaxBatchDelayMs) {
+      Publish(results);
+      timer.restart();
+    }
+  }
+
+  Publish(results);
+}
+
+void SearchRunnable::run(void) {
+  if (IsCancelled()) {
+    return;
+  }
+
+  QRegularExpression regex(pattern, options);
+
+  // The regex is already validated by the search widget.
+  Q_ASSERT(regex.isValid());
+
+  if (candidates) {
+    Narrow(regex);
+  } else {
+    Scan(regex);
+  }
+
+  if (!IsCancelled()) {
+    emit SearchFinished(captured_version_number);
+  }
+}
+
+}  // namespace mx::gui
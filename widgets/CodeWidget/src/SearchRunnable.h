@@ -0,0 +1,85 @@
+/*
+  Copyright (c) 2024-present, Trail of Bits, Inc.
+  All rights reserved.
+
+  This source code is licensed in accordance with the terms specified in
+  the LICENSE file found in the root directory of this source tree.
+*/
+
+#pragma once
+
+#include <QMetaType>
+#include <QObject>
+#include <QRegularExpression>
+#include <QRunnable>
+#include <QString>
+
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "BuildSceneRunnable.h"
+
+namespace mx::gui {
+
+//! `(offset, length)` pairs of the matches of a search in a document.
+using SearchResults = std::vector<std::pair<qsizetype, qsizetype>>;
+
+//! Searches a document off of the main thread. Results are published in
+//! document order, a batch at a time, so that they can be shown as they are
+//! found. Searches are abandoned as soon as `version_number` no longer matches
+//! the version number captured at construction time.
+class SearchRunnable Q_DECL_FINAL : public QObject, public QRunnable {
+  Q_OBJECT
+
+  // The document to search. This is a shallow copy of the scene's document.
+  const QString document;
+
+  const QString pattern;
+  const QRegularExpression::PatternOptions options;
+
+  // If present, then every match is known to begin at the offset of one of
+  // these, and so only they are tried, instead of scanning the document.
+  const std::optional<SearchResults> candidates;
+
+  // Used to keep track of if the search needs to still happen.
+  const AtomicU64Ptr version_number;
+  const uint64_t captured_version_number;
+
+  bool IsCancelled(void) const;
+  void Scan(const QRegularExpression &regex);
+  void Narrow(const QRegularExpression &regex);
+  void Publish(SearchResults &results);
+
+ public:
+  virtual ~SearchRunnable(void);
+
+  inline explicit SearchRunnable(
+      QString document_, QString pattern_,
+      QRegularExpression::PatternOptions options_,
+      std::optional<SearchResults> candidates_, AtomicU64Ptr version_number_)
+      : document(std::move(document_)),
+        pattern(std::move(pattern_)),
+        options(options_),
+        candidates(std::move(candidates_)),
+        version_number(std::move(version_number_)),
+        captured_version_number(version_number->load()) {
+    setAutoDelete(true);
+  }
+
+  void run(void) Q_DECL_FINAL;
+
+ signals:
+  //! Published with each batch of results. Batches are published in document
+  //! order, and their results don't overlap.
+  void ResultsFound(uint64_t version_number, SearchResults results);
+
+  //! Published after the last batch of results, unless the search was
+  //! cancelled.
+  void SearchFinished(uint64_t version_number);
+};
+
+}  // namespace mx::gui
+
+Q_DECLARE_METATYPE(mx::gui::SearchResults)
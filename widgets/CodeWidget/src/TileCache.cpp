@@ -0,0 +1,100 @@
+/*
+  Copyright (c) 2024-present, Trail of Bits, Inc.
+  All rights reserved.
+
+  This source code is licensed in accordance with the terms specified in
+  the LICENSE file found in the root directory of this source tree.
+*/
+
+#include "TileCache.h"
+
+namespace mx::gui {
+
+size_t Tile::NumBytes(void) const noexcept {
+  return static_cast<size_t>(background.sizeInBytes()) +
+         static_cast<size_t>(foreground.sizeInBytes());
+}
+
+// Mark the start of a new frame.
+void TileCache::BeginFrame(void) {
+  ++frame;
+}
+
+// Find a tile, marking it as most recently used.
+const Tile *TileCache::Find(TileKey key) {
+  auto it = key_to_entry.find(key.Hash());
+  if (it == key_to_entry.end()) {
+    return nullptr;
+  }
+
+  auto entry_it = it->second;
+  entry_it->last_frame = frame;
+  if (entry_it != entries.begin()) {
+    entries.splice(entries.begin(), entries, entry_it);
+  }
+  return &(entry_it->tile);
+}
+
+// Add a tile to the cache, evicting least recently used tiles if we're over
+// budget.
+const Tile &TileCache::Insert(TileKey key, Tile tile) {
+  auto hash = key.Hash();
+  if (auto it = key_to_entry.find(hash); it != key_to_entry.end()) {
+    memory_usage -= it->second->tile.NumBytes();
+    entries.erase(it->second);
+    key_to_entry.erase(it);
+  }
+
+  memory_usage += tile.NumBytes();
+  Entry &entry = entries.emplace_front();
+  entry.key = key;
+  entry.tile = std::move(tile);
+  entry.last_frame = frame;
+  key_to_entry.emplace(hash, entries.begin());
+
+  Evict();
+  return entry.tile;
+}
+
+// Drop all cached tiles.
+void TileCache::Clear(void) {
+  entries.clear();
+  key_to_entry.clear();
+  memory_usage = 0u;
+}
+
+// Drop the cached tiles in rows `first_row` through `last_row`, inclusive.
+void TileCache::EraseRows(int first_row, int last_row) {
+  for (auto it = entries.begin(); it != entries.end();) {
+    if (first_row <= it->key.row && it->key.row <= last_row) {
+      memory_usage -= it->tile.NumBytes();
+      key_to_entry.erase(it->key.Hash());
+      it = entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+// Change the memory budget, evicting tiles if necessary.
+void TileCache::SetMemoryBudget(size_t num_bytes) {
+  memory_budget = num_bytes;
+  Evict();
+}
+
+// Evict the least recently used tiles until we're under budget. Tiles used
+// in the current frame are kept around, even if that means we go over budget.
+void TileCache::Evict(void) {
+  while (memory_usage > memory_budget && !entries.empty()) {
+    Entry &lru = entries.back();
+    if (lru.last_frame == frame) {
+      break;
+    }
+
+    memory_usage -= lru.tile.NumBytes();
+    key_to_entry.erase(lru.key.Hash());
+    entries.pop_back();
+  }
+}
+
+}  // namespace mx::gui
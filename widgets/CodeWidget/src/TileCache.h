@@ -0,0 +1,111 @@
+/*
+  Copyright (c) 2024-present, Trail of Bits, Inc.
+  All rights reserved.
+
+  This source code is licensed in accordance with the terms specified in
+  the LICENSE file found in the root directory of this source tree.
+*/
+
+#pragma once
+
+#include <QImage>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+namespace mx::gui {
+
+//! Identifies a tile by its row band (Y axis) and column band (X axis). A
+//! column of `-1` is used for tiles of the line number gutter.
+struct TileKey {
+  int row{0};
+  int column{0};
+
+  inline uint64_t Hash(void) const noexcept {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(row)) << 32u) |
+           static_cast<uint64_t>(static_cast<uint32_t>(column));
+  }
+};
+
+//! A rasterized, fixed-size piece of the code canvas. The background layer
+//! is only allocated if something in the tile has a background color.
+struct Tile {
+  QImage background;
+  QImage foreground;
+
+  size_t NumBytes(void) const noexcept;
+};
+
+//! An LRU cache of rasterized tiles, bounded by a memory budget. Tiles that
+//! were used during the current frame are never evicted, so that a viewport
+//! that needs more tiles than the budget allows doesn't thrash.
+class TileCache {
+ public:
+  //! Size of a tile, in logical (device-independent) pixels.
+  static constexpr int kTileWidth = 512;
+  static constexpr int kTileHeight = 256;
+
+  //! Default memory budget, in bytes.
+  static constexpr size_t kDefaultMemoryBudget = 64u * 1024u * 1024u;
+
+  TileCache(void) = default;
+
+  //! Mark the start of a new frame. Tiles touched after this are pinned until
+  //! the next frame starts.
+  void BeginFrame(void);
+
+  //! Find a tile, marking it as most recently used. Returns `nullptr` if the
+  //! tile isn't cached.
+  const Tile *Find(TileKey key);
+
+  //! Returns `true` if the tile is cached. This doesn't affect the LRU order.
+  inline bool Contains(TileKey key) const {
+    return key_to_entry.find(key.Hash()) != key_to_entry.end();
+  }
+
+  //! Add a tile to the cache, evicting least recently used tiles if we're
+  //! over budget.
+  const Tile &Insert(TileKey key, Tile tile);
+
+  //! Drop all cached tiles.
+  void Clear(void);
+
+  //! Drop the cached tiles in rows `first_row` through `last_row`, inclusive.
+  void EraseRows(int first_row, int last_row);
+
+  //! Change the memory budget, evicting tiles if necessary.
+  void SetMemoryBudget(size_t num_bytes);
+
+  //! The memory budget, in bytes.
+  inline size_t MemoryBudget(void) const noexcept {
+    return memory_budget;
+  }
+
+  //! Number of bytes used by all cached tiles.
+  inline size_t MemoryUsage(void) const noexcept {
+    return memory_usage;
+  }
+
+ private:
+  struct Entry {
+    TileKey key;
+    Tile tile;
+    uint64_t last_frame{0};
+  };
+
+  using EntryList = std::list<Entry>;
+
+  void Evict(void);
+
+  // Most recently used tiles are at the front.
+  EntryList entries;
+  std::unordered_map<uint64_t, EntryList::iterator> key_to_entry;
+
+  size_t memory_budget{kDefaultMemoryBudget};
+  size_t memory_usage{0u};
+  uint64_t frame{0u};
+};
+
+}  // namespace mx::gui
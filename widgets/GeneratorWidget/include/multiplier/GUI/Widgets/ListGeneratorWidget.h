@@ -96,6 +96,9 @@ class ListGeneratorWidget Q_DECL_FINAL : public IWindowWidget {
 
   //! Called when the model request has finished
   void OnModelRequestFinished(void);
+
+  //! Called when the model has imported a batch of generated items
+  void OnModelImportProgress(size_t num_queued, size_t num_imported);
 };
 
 }  // namespace mx::gui
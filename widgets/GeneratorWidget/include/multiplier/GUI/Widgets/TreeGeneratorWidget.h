@@ -64,6 +64,12 @@ class TreeGeneratorWidget Q_DECL_FINAL : public IWindowWidget {
   //! Updates the treeview item hover buttons
   void UpdateItemButtons(void);
 
+  //! Tells the model which rows are on screen, after a short delay
+  void ScheduleVisibleRowsUpdate(void);
+
+  //! Tells the model which rows are on screen
+  void UpdateVisibleRows(void);
+
  private slots:
   //! Used to expand and resize the items after a model reset
   void OnModelReset(void);
@@ -109,6 +115,9 @@ class TreeGeneratorWidget Q_DECL_FINAL : public IWindowWidget {
   //! Called when the model request has finished
   void OnModelRequestFinished(void);
 
+  //! Called when the model has imported a batch of generated items
+  void OnModelImportProgress(size_t num_queued, size_t num_imported);
+
   void GotoOriginal(const QModelIndex &index);
  
  signals:
@@ -0,0 +1,122 @@
+/*
+  Copyright (c) 2024-present, Trail of Bits, Inc.
+  All rights reserved.
+
+  This source code is licensed in accordance with the terms specified in
+  the LICENSE file found in the root directory of this source tree.
+*/
+
+#pragma once
+
+#include <QVector>
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace mx::gui {
+
+//! A FIFO queue of items stored in fixed-size chunks. Items are consumed by
+//! advancing a cursor into the front chunk, so consuming an item is O(1) and
+//! never shifts the other items. Drained chunks are recycled for future
+//! pushes, so a queue that is filled and drained repeatedly, as happens when
+//! generator batches are imported into a model, stops allocating once it
+//! reaches its high-water mark.
+template <typename T, size_t kChunkSize = 1024u>
+class ChunkedQueue {
+  using Chunk = std::vector<T>;
+  using ChunkPtr = std::unique_ptr<Chunk>;
+
+  // Chunks in FIFO order. Every chunk except the back one is full.
+  std::deque<ChunkPtr> chunks;
+
+  // Drained chunks available for reuse.
+  std::vector<ChunkPtr> free_chunks;
+
+  // Index of the next item to consume in `chunks.front()`.
+  size_t cursor{0u};
+
+  // Number of unconsumed items.
+  size_t num_items{0u};
+
+  Chunk &BackChunk(void) {
+    if (chunks.empty() || chunks.back()->size() == kChunkSize) {
+      if (free_chunks.empty()) {
+        chunks.emplace_back(new Chunk);
+        chunks.back()->reserve(kChunkSize);
+      } else {
+        chunks.emplace_back(std::move(free_chunks.back()));
+        free_chunks.pop_back();
+      }
+    }
+    return *chunks.back();
+  }
+
+  void RecycleFrontChunk(void) {
+    ChunkPtr chunk = std::move(chunks.front());
+    chunks.pop_front();
+    chunk->clear();
+    free_chunks.emplace_back(std::move(chunk));
+    cursor = 0u;
+  }
+
+ public:
+  inline bool empty(void) const noexcept {
+    return !num_items;
+  }
+
+  inline size_t size(void) const noexcept {
+    return num_items;
+  }
+
+  //! Add an item to the back of the queue.
+  void push_back(T item) {
+    BackChunk().emplace_back(std::move(item));
+    ++num_items;
+  }
+
+  //! Move all of `items` to the back of the queue.
+  void append(QVector<T> items) {
+    for (T &item : items) {
+      BackChunk().emplace_back(std::move(item));
+    }
+    num_items += static_cast<size_t>(items.size());
+  }
+
+  //! Return the item at the front of the queue. The queue must not be empty.
+  inline T &front(void) {
+    return (*chunks.front())[cursor];
+  }
+
+  //! Remove the item at the front of the queue. The queue must not be empty.
+  void pop_front(void) {
+    Chunk &chunk = *chunks.front();
+    chunk[cursor] = T{};  // Release the item now, not when recycled.
+    ++cursor;
+    --num_items;
+
+    if (cursor == chunk.size()) {
+      RecycleFrontChunk();
+    }
+  }
+
+  //! Remove and return the item at the front of the queue. The queue must not
+  //! be empty.
+  T take_front(void) {
+    T item = std::move(front());
+    pop_front();
+    return item;
+  }
+
+  //! Remove all items, keeping the chunks for reuse.
+  void clear(void) {
+    while (!chunks.empty()) {
+      RecycleFrontChunk();
+    }
+    num_items = 0u;
+  }
+};
+
+}  // namespace mx::gui
@@ -0,0 +1,40 @@
+/*
+  Copyright (c) 2024-present, Trail of Bits, Inc.
+  All rights reserved.
+
+  This source code is licensed in accordance with the terms specified in
+  the LICENSE file found in the root directory of this source tree.
+*/
+
+#include "DeferredDataRunnable.h"
+
+namespace mx::gui {
+
+DeferredDataRunnable::~DeferredDataRunnable(void) {}
+
+void DeferredDataRunnable::run(void) {
+  QVector<QVariantList> data;
+  data.reserve(items.size());
+
+  for (const IGeneratedItemPtr &item : items) {
+    if (task_group.IsCancelled(captured_version_number)) {
+      return;
+    }
+
+    QVariantList &columns = data.emplaceBack();
+    columns.reserve(num_columns);
+    for (int col = 0; col < num_columns; ++col) {
+      if (item->IsDeferred(col)) {
+        columns.emplaceBack(item->DeferredData(col));
+      } else {
+        columns.emplaceBack();
+      }
+    }
+  }
+
+  if (!task_group.IsCancelled(captured_version_number)) {
+    emit NewDeferredData(captured_version_number, item_ids, std::move(data));
+  }
+}
+
+}  // namespace mx::gui
@@ -0,0 +1,64 @@
+/*
+  Copyright (c) 2024-present, Trail of Bits, Inc.
+  All rights reserved.
+
+  This source code is licensed in accordance with the terms specified in
+  the LICENSE file found in the root directory of this source tree.
+*/
+
+#pragma once
+
+#include <multiplier/GUI/Interfaces/IGeneratedItem.h>
+#include <multiplier/GUI/Managers/TaskManager.h>
+
+#include <QList>
+#include <QObject>
+#include <QRunnable>
+#include <QVariant>
+#include <QVector>
+
+namespace mx::gui {
+
+// Maximum number of items whose deferred data is computed by one runnable.
+// This is small so that the first rows on screen get their data quickly.
+static constexpr int kDeferredDataBatchSize{32};
+
+//! A background thread that computes the deferred column data of a batch of
+//! generated items.
+class DeferredDataRunnable Q_DECL_FINAL : public QObject, public QRunnable {
+  Q_OBJECT
+
+  const TaskGroup task_group;
+  const uint64_t captured_version_number;
+
+  // Some kind of identifier for what the item nodes are in the underlying
+  // model, and the items themselves.
+  const QVector<uint64_t> item_ids;
+  const QVector<IGeneratedItemPtr> items;
+
+  const int num_columns;
+
+  void run(void) Q_DECL_FINAL;
+
+ public:
+  virtual ~DeferredDataRunnable(void);
+
+  inline explicit DeferredDataRunnable(
+      TaskGroup task_group_, QVector<uint64_t> item_ids_,
+      QVector<IGeneratedItemPtr> items_, int num_columns_)
+      : task_group(std::move(task_group_)),
+        captured_version_number(task_group.Generation()),
+        item_ids(std::move(item_ids_)),
+        items(std::move(items_)),
+        num_columns(num_columns_) {
+    setAutoDelete(true);
+  }
+
+ signals:
+  //! Emitted with the data of all `num_columns` columns of each item. Columns
+  //! that aren't deferred are left invalid.
+  void NewDeferredData(uint64_t version_number, QVector<uint64_t> item_ids,
+                       QVector<QVariantList> data);
+};
+
+}  // namespace mx::gui
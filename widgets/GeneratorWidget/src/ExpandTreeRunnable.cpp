@@ -15,11 +15,21 @@ namespace mx::gui {
 void ExpandTreeRunnable::run(void) {
   QVector<IGeneratedItemPtr> items;
   for (auto item : generator->Children(generator, parent_item)) {
-    if (version_number.load() != captured_version_number) {
+    if (IsCancelled()) {
       emit Finished();
       return;
     }
 
+    // A checkpoint; send out what we have so far.
+    if (!item) {
+      if (!items.isEmpty()) {
+        emit NewGeneratedItems(captured_version_number, parent_item_id,
+                               std::move(items), depth - 1u);
+        items.clear();
+      }
+      continue;
+    }
+
     items.emplaceBack(std::move(item));
 
     // Send out a batch.
@@ -30,7 +40,7 @@ void ExpandTreeRunnable::run(void) {
     }
   }
 
-  if (version_number.load() != captured_version_number) {
+  if (IsCancelled()) {
     emit Finished();
     return;
   }
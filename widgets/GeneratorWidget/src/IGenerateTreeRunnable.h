@@ -10,19 +10,29 @@
 
 #include <multiplier/Index.h>
 #include <multiplier/GUI/Interfaces/IGeneratedItem.h>
+#include <multiplier/GUI/Managers/TaskManager.h>
 
 #include <QVector>
 #include <QRunnable>
 #include <QObject>
 
-#include <atomic>
 #include <memory>
 
 namespace mx::gui {
 
-static constexpr int kBatchIntervalTime{150};
+// Delay, in milliseconds, between the first batch of generated items arriving
+// at a model and the model importing them, so that the first few batches are
+// imported together.
+static constexpr int kBatchIntervalTime{16};
+
+// Maximum number of items that a runnable sends to its model in one batch.
 static constexpr int kMaxBatchSize{150};
 
+// Time, in milliseconds, that a model can spend importing queued items on
+// each turn of the event loop. Whatever doesn't fit is imported on the next
+// turn, after the view has had a chance to repaint.
+static constexpr qint64 kImportTimeBudget{8};
+
 class ITreeGenerator;
 
 class IGenerateTreeRunnable : public QObject, public QRunnable {
@@ -30,7 +40,7 @@ class IGenerateTreeRunnable : public QObject, public QRunnable {
 
  protected:
   const std::shared_ptr<ITreeGenerator> generator;
-  const std::atomic_uint64_t &version_number;
+  const TaskGroup task_group;
   const uint64_t captured_version_number;
   const IGeneratedItemPtr parent_item;
   
@@ -44,18 +54,22 @@ class IGenerateTreeRunnable : public QObject, public QRunnable {
   virtual ~IGenerateTreeRunnable(void);
   
   inline explicit IGenerateTreeRunnable(
-      std::shared_ptr<ITreeGenerator> generator_,
-      const std::atomic_uint64_t &version_number_,
+      std::shared_ptr<ITreeGenerator> generator_, TaskGroup task_group_,
       IGeneratedItemPtr parent_item_, uint64_t parent_item_id_, unsigned depth_)
       : generator(std::move(generator_)),
-        version_number(version_number_),
-        captured_version_number(version_number.load()),
+        task_group(std::move(task_group_)),
+        captured_version_number(task_group.Generation()),
         parent_item(std::move(parent_item_)),
         parent_item_id(parent_item_id_),
         depth(depth_) {
     setAutoDelete(true);        
   }
 
+ protected:
+  inline bool IsCancelled(void) const {
+    return task_group.IsCancelled(captured_version_number);
+  }
+
  signals:
   void NewGeneratedItems(uint64_t version_number, uint64_t parent_item_id,
                          QVector<IGeneratedItemPtr> child_items,
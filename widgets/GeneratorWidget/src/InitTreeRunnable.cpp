@@ -15,11 +15,21 @@ namespace mx::gui {
 void InitTreeRunnable::run(void) {
   QVector<IGeneratedItemPtr> items;
   for (auto item : generator->Roots(generator)) {
-    if (version_number.load() != captured_version_number) {
+    if (IsCancelled()) {
       emit Finished();
       return;
     }
 
+    // A checkpoint; send out what we have so far.
+    if (!item) {
+      if (!items.isEmpty()) {
+        emit NewGeneratedItems(captured_version_number, parent_item_id,
+                               std::move(items), depth - 1u);
+        items.clear();
+      }
+      continue;
+    }
+
     items.emplaceBack(std::move(item));
 
     // Send out a batch.
@@ -30,7 +40,7 @@ void InitTreeRunnable::run(void) {
     }
   }
 
-  if (version_number.load() != captured_version_number) {
+  if (IsCancelled()) {
     emit Finished();
     return;
   }
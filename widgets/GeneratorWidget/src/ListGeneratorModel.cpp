@@ -10,21 +10,21 @@
 
 #include <QColor>
 #include <QApplication>
-#include <QThreadPool>
+#include <QElapsedTimer>
 #include <QTimer>
 #include <QPalette>
 #include <QtConcurrent>
 #include <QDebug>
 
-#include <atomic>
 #include <algorithm>
 #include <cassert>
 #include <deque>
-#include <list>
 #include <multiplier/GUI/Interfaces/IListGenerator.h>
+#include <multiplier/GUI/Managers/TaskManager.h>
 #include <multiplier/GUI/Util.h>
 #include <unordered_map>
 
+#include "ChunkedQueue.h"
 #include "InitTreeRunnable.h"
 
 namespace mx::gui {
@@ -47,17 +47,17 @@ struct Node {
   unsigned alias_index{0u};
 };
 
-struct DataBatch {
-  std::list<IGeneratedItemPtr> child_items;
-
-  inline DataBatch(QVector<IGeneratedItemPtr> child_items_) {
-    for (auto &item : child_items_) {
-      child_items.emplace_back(std::move(item));
-    }
+// Returns the data of column `col` of `item`.
+//
+// NOTE: List generators produce flat lists of cheap items, so unlike the
+//       `TreeGeneratorModel`, we don't bother computing deferred data in
+//       the background.
+static QVariant ColumnData(const IGeneratedItemPtr &item, int col) {
+  if (item->IsDeferred(col)) {
+    return item->DeferredData(col);
   }
-};
-
-using DataBatchQueue = std::list<DataBatch>;
+  return item->Data(col);
+}
 
 }  // namespace
 
@@ -87,22 +87,26 @@ struct ListGeneratorModel::PrivateData final {
   // Returns the if there's an outstanding request.
   int num_pending_requests{0};
 
-  // Version number of this model. This is incremented when we install a new
-  // generator.
-  std::atomic_uint64_t version_number;
+  // Runs all expansion runnables.
+  TaskManager &task_manager;
 
-  // Thread pool for all expansion runnables.
-  QThreadPool thread_pool;
+  // Cancellation group of the expansion runnables. This is cancelled when we
+  // install a new generator.
+  TaskGroup task_group;
 
-  //! A timer used to import data from the data batch queue
+  //! A timer used to import data from the item queue
   QTimer import_timer;
 
-  // Queue of groups of children `IGeneratedItem`s to insert into the model.
-  DataBatchQueue data_batch_queue;
+  // Queue of children `IGeneratedItem`s to insert into the model.
+  ChunkedQueue<IGeneratedItemPtr> item_queue;
 
-  inline PrivateData(const QString &model_id_)
+  // Number of items imported into the list since the generator was
+  // installed.
+  size_t num_imported{0u};
+
+  inline PrivateData(TaskManager &task_manager_, const QString &model_id_)
       : model_id(model_id_),
-        version_number(0u) {}
+        task_manager(task_manager_) {}
 
   NodeKey *NodeKeyFrom(const QModelIndex &index) const {
     if (!index.isValid()) {
@@ -141,9 +145,10 @@ struct ListGeneratorModel::PrivateData final {
 };
 
 //! Constructor
-ListGeneratorModel::ListGeneratorModel(const QString &model_id, QObject *parent)
+ListGeneratorModel::ListGeneratorModel(TaskManager &task_manager,
+                                       const QString &model_id, QObject *parent)
     : IModel(parent),
-      d(new PrivateData(model_id)) {
+      d(new PrivateData(task_manager, model_id)) {
   connect(&d->import_timer, &QTimer::timeout, this,
           &ListGeneratorModel::ProcessDataBatchQueue);
 }
@@ -173,14 +178,15 @@ void ListGeneratorModel::InstallGenerator(IListGeneratorPtr generator_) {
   CancelRunningRequest();
 
   emit beginResetModel();
-  d->version_number.fetch_add(1u);
+  d->task_group.Cancel();
   d->generator = std::move(generator_);
   d->entity_to_node.clear();
   d->aliased_entity_to_key.clear();
   d->child_keys.clear();
   d->redundant_keys.clear();
   d->import_timer.stop();
-  d->data_batch_queue.clear();
+  d->item_queue.clear();
+  d->num_imported = 0u;
   emit endResetModel();
 
   // Start a request to fetch the data.
@@ -188,7 +194,7 @@ void ListGeneratorModel::InstallGenerator(IListGeneratorPtr generator_) {
     d->num_pending_requests += 1;
 
     auto runnable = new InitTreeRunnable(
-        d->generator, d->version_number, {}, 0u, 1u);
+        d->generator, d->task_group, {}, 0u, 1u);
 
     connect(runnable, &IGenerateTreeRunnable::NewGeneratedItems,
             this, &ListGeneratorModel::OnNewListItems);
@@ -196,10 +202,10 @@ void ListGeneratorModel::InstallGenerator(IListGeneratorPtr generator_) {
     connect(runnable, &IGenerateTreeRunnable::Finished,
             this, &ListGeneratorModel::OnRequestFinished);
 
-    d->import_timer.start(kBatchIntervalTime);
     emit RequestStarted();
 
-    d->thread_pool.start(runnable);
+    d->task_manager.Start(runnable, TaskPriority::kInteractive,
+                          d->task_group);
   }
 }
 
@@ -258,7 +264,7 @@ QVariant ListGeneratorModel::data(const QModelIndex &index, int role) const {
 
   Node *node = &(entity_key->second);
 
-    QVariant data = node->item->Data(index.column());
+    QVariant data = ColumnData(node->item, index.column());
   if (!data.isValid()) {
     return data;
   }
@@ -278,7 +284,7 @@ QVariant ListGeneratorModel::data(const QModelIndex &index, int role) const {
   } else if (role == Qt::ToolTipRole) {
     QString tooltip = tr("Entity Id: ") + QString::number(entity_key->first);
     if (d->generator) {
-      QVariant col_data = node->item->Data(0);
+      QVariant col_data = ColumnData(node->item, 0);
       if (auto as_str = TryConvertToString(col_data)) {
         tooltip += QString("\n%1: %2").arg(d->generator->ColumnTitle(0)).arg(as_str.value());
       }
@@ -315,13 +321,13 @@ void ListGeneratorModel::OnRequestFinished(void) {
 }
 
 void ListGeneratorModel::CancelRunningRequest(void) {
-  if (!d->num_pending_requests && d->data_batch_queue.empty()) {
+  if (!d->num_pending_requests && d->item_queue.empty()) {
     return;
   }
 
-  d->version_number.fetch_add(1u);
+  d->task_group.Cancel();
   d->import_timer.stop();
-  d->data_batch_queue.clear();
+  d->item_queue.clear();
 }
 
 //! Notify us when there's a batch of new data to update.
@@ -329,144 +335,126 @@ void ListGeneratorModel::OnNewListItems(
     uint64_t version_number, uint64_t,
     QVector<IGeneratedItemPtr> child_items, unsigned) {
 
-  if (version_number != d->version_number.load()) {
+  if (d->task_group.IsCancelled(version_number)) {
     return;
   }
 
-  d->data_batch_queue.emplace_back(std::move(child_items));
+  d->item_queue.append(std::move(child_items));
+
+  if (!d->import_timer.isActive()) {
+    d->import_timer.start(kBatchIntervalTime);
+  }
 }
 
 void ListGeneratorModel::ProcessDataBatchQueue(void) {
+  QElapsedTimer timer;
+  timer.start();
 
-  // Count how many items we've imported so that we can batch them across
-  // timer events.
+  // Count how many items we've imported so that all of the items imported
+  // on this turn of the event loop are inserted into the model at once.
   int num_imported = 0;
+  const int prev_num_children = static_cast<int>(d->child_keys.size());
 
-  while (!d->data_batch_queue.empty()) {
-    DataBatch &batch = d->data_batch_queue.front();
-    if (batch.child_items.empty()) {
-      d->data_batch_queue.pop_front();
-      continue;
-    }
-
-    int num_imported_children = 0;
-    const int prev_num_children = static_cast<int>(d->child_keys.size());
-
-    while (!batch.child_items.empty()) {
+  // If we've used up our time budget then stop now and push things to the
+  // next turn of the event loop. We always import at least one item so that
+  // we make progress.
+  auto out_of_time = [&] (void) {
+    return num_imported && timer.hasExpired(kImportTimeBudget);
+  };
 
-      auto item = std::move(batch.child_items.front());
-      batch.child_items.pop_front();
+  while (!d->item_queue.empty() && !out_of_time()) {
+    IGeneratedItemPtr item = d->item_queue.take_front();
 
-      VariantEntity entity = item->Entity();
-      if (std::holds_alternative<NotAnEntity>(entity)) {
-        continue;
-      }
+    VariantEntity entity = item->Entity();
+    if (std::holds_alternative<NotAnEntity>(entity)) {
+      continue;
+    }
 
-      auto eid = ::mx::EntityId(entity).Pack();
-      if (eid == kInvalidEntityId) {
-        continue;
-      }
+    auto eid = ::mx::EntityId(entity).Pack();
+    if (eid == kInvalidEntityId) {
+      continue;
+    }
 
-      auto aliased_entity = item->AliasedEntity();
-      if (std::holds_alternative<NotAnEntity>(aliased_entity)) {
-        aliased_entity = entity;
-      }
+    auto aliased_entity = item->AliasedEntity();
+    if (std::holds_alternative<NotAnEntity>(aliased_entity)) {
+      aliased_entity = entity;
+    }
 
-      // Now create the node key. If this is the first time we're seeing the
-      // node, then the node key is in our `entity_to_node` map; otherwise we
-      // make a redundant key in `redundant_keys`.
-      NodeKey *curr_key = nullptr;
-      auto [node_it, added] = d->entity_to_node.emplace(eid, Node{});
-      NodeKey *load_key = &*node_it;
-      if (added) {
-        curr_key = load_key;
-
-        // Even though this is a new node, link it to a prior node. This is to
-        // allow us to reprepresent another form of equivalence to the
-        // deduplication mechanism, i.e. that one declaration may be a
-        // redeclaration of another one.
-        const RawEntityId aliased_eid = ::mx::EntityId(aliased_entity).Pack();
-        if (aliased_eid != kInvalidEntityId && aliased_eid != eid) {
-          NodeKey *&alias_key = d->aliased_entity_to_key[aliased_eid];
-
-          if (!alias_key) {
-            auto alias_it = d->entity_to_node.find(aliased_eid);
-            if (alias_it != d->entity_to_node.end()) {
-              load_key = &*alias_it;
-              alias_key = load_key;
-            } else {
-              alias_key = curr_key;  // Store for future dedup.
-            }
+    // Now create the node key. If this is the first time we're seeing the
+    // node, then the node key is in our `entity_to_node` map; otherwise we
+    // make a redundant key in `redundant_keys`.
+    NodeKey *curr_key = nullptr;
+    auto [node_it, added] = d->entity_to_node.emplace(eid, Node{});
+    NodeKey *load_key = &*node_it;
+    if (added) {
+      curr_key = load_key;
+
+      // Even though this is a new node, link it to a prior node. This is to
+      // allow us to reprepresent another form of equivalence to the
+      // deduplication mechanism, i.e. that one declaration may be a
+      // redeclaration of another one.
+      const RawEntityId aliased_eid = ::mx::EntityId(aliased_entity).Pack();
+      if (aliased_eid != kInvalidEntityId && aliased_eid != eid) {
+        NodeKey *&alias_key = d->aliased_entity_to_key[aliased_eid];
+
+        if (!alias_key) {
+          auto alias_it = d->entity_to_node.find(aliased_eid);
+          if (alias_it != d->entity_to_node.end()) {
+            load_key = &*alias_it;
+            alias_key = load_key;
           } else {
-            load_key = alias_key;
+            alias_key = curr_key;  // Store for future dedup.
           }
-
-          // An existing thing notifies us of this alias.
-        } else if (auto alias_it = d->aliased_entity_to_key.find(eid);
-                   alias_it != d->aliased_entity_to_key.end()) {
-          load_key = alias_it->second;
+        } else {
+          load_key = alias_key;
         }
 
-      } else {
-        curr_key = &(d->redundant_keys.emplace_back(eid, Node{}));
+        // An existing thing notifies us of this alias.
+      } else if (auto alias_it = d->aliased_entity_to_key.find(eid);
+                 alias_it != d->aliased_entity_to_key.end()) {
+        load_key = alias_it->second;
       }
 
-      Node *const new_node = &(curr_key->second);
-
-      // Copy the entity into the node.
-      new_node->item = std::move(item);
+    } else {
+      curr_key = &(d->redundant_keys.emplace_back(eid, Node{}));
+    }
 
-      // Make the node point to itself, and update the parent child index or
-      // previous sibling's next sibling index.
-      new_node->alias_index = static_cast<unsigned>(d->child_keys.size());
-      new_node->row = static_cast<int>(new_node->alias_index);
+    Node *const new_node = &(curr_key->second);
 
-      // Possibly make the node point to its alias. Note that `load_key` may
-      // not be `new_node`.
-      new_node->alias_index = load_key->second.alias_index;
+    // Copy the entity into the node.
+    new_node->item = std::move(item);
 
-      d->child_keys.emplace_back(curr_key);
+    // Make the node point to itself, and update the parent child index or
+    // previous sibling's next sibling index.
+    new_node->alias_index = static_cast<unsigned>(d->child_keys.size());
+    new_node->row = static_cast<int>(new_node->alias_index);
 
-      ++num_imported_children;
-      ++num_imported;
+    // Possibly make the node point to its alias. Note that `load_key` may
+    // not be `new_node`.
+    new_node->alias_index = load_key->second.alias_index;
 
-      if (kMaxBatchSize <= num_imported) {
-        break;
-      }
-    }
+    d->child_keys.emplace_back(curr_key);
 
-    // We didn't end up importing anything.
-    if (!num_imported_children) {
-      d->data_batch_queue.pop_front();
-      continue;
-    }
+    ++num_imported;
+  }
 
-    // Update the number of children of the parent.
+  // Update the number of children of the parent.
+  if (num_imported) {
     emit beginInsertRows(
         QModelIndex(), prev_num_children,
-        prev_num_children + num_imported_children - 1);
+        prev_num_children + num_imported - 1);
 
     emit endInsertRows();
-
-    if (batch.child_items.empty()) {
-      d->data_batch_queue.pop_front();
-    }
-
-    if (kMaxBatchSize <= num_imported) {
-      break;
-    }
   }
 
-  bool has_remaining = !d->data_batch_queue.empty() ||
-                       0 < d->num_pending_requests;
-
-  // Restart the timer, so that the import procedure will fire again
-  // in kBatchIntervalTime msecs from the end of the previous batch.
-  if (has_remaining) {
-    if (!d->import_timer.isActive()) {
-      d->import_timer.start(kBatchIntervalTime);
-    }
+  d->num_imported += static_cast<size_t>(num_imported);
+  emit ImportProgress(d->item_queue.size(), d->num_imported);
 
+  // If there's still anything left then import more as soon as the view has
+  // caught up with this batch. Otherwise, the next batch to arrive restarts
+  // the timer.
+  if (!d->item_queue.empty()) {
+    d->import_timer.start(0);
   } else {
     d->import_timer.stop();
   }
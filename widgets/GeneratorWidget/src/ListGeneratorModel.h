@@ -16,6 +16,7 @@
 namespace mx::gui {
 
 class IGenerateTreeRunnable;
+class TaskManager;
 class ThemeManager;
 
 //! Implements the IReferenceExplorerModel interface
@@ -36,7 +37,8 @@ class ListGeneratorModel Q_DECL_FINAL : public IModel {
   };
 
   //! Constructor
-  ListGeneratorModel(const QString &model_id, QObject *parent = nullptr);
+  ListGeneratorModel(TaskManager &task_manager, const QString &model_id,
+                     QObject *parent = nullptr);
 
   //! Destructor
   virtual ~ListGeneratorModel(void);
@@ -93,6 +95,11 @@ class ListGeneratorModel Q_DECL_FINAL : public IModel {
 
   //! Emitted when a request has finished
   void RequestFinished(void);
+
+  //! Emitted after each import of generated items into the list, with the
+  //! number of items still waiting to be imported, and the total number of
+  //! items imported since the generator was installed.
+  void ImportProgress(size_t num_queued, size_t num_imported);
 };
 
 }  // namespace mx::gui
\ No newline at end of file
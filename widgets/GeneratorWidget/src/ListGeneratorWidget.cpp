@@ -13,6 +13,7 @@
 #include <multiplier/GUI/Util.h>
 #include <multiplier/GUI/Managers/ConfigManager.h>
 #include <multiplier/GUI/Managers/MediaManager.h>
+#include <multiplier/GUI/Managers/TaskManager.h>
 #include <multiplier/GUI/Widgets/SearchWidget.h>
 
 #include <QAction>
@@ -43,6 +44,7 @@ struct ListGeneratorWidget::PrivateData final {
   QListView *list_view{nullptr};
   SearchWidget *search_widget{nullptr};
   QWidget *status_widget{nullptr};
+  QLabel *status_label{nullptr};
 
   bool updating_buttons{false};
 
@@ -62,7 +64,8 @@ ListGeneratorWidget::ListGeneratorWidget(
       d(new PrivateData) {
 
   d->selection_timer.start();
-  d->model = new ListGeneratorModel(model_id, this);
+  d->model = new ListGeneratorModel(config_manager.TaskManager(), model_id,
+                                    this);
   InitializeWidgets(config_manager);
   InstallModel();
 
@@ -151,7 +154,8 @@ void ListGeneratorWidget::InitializeWidgets(
   auto status_widget_layout = new QHBoxLayout();
   status_widget_layout->setContentsMargins(0, 0, 0, 0);
 
-  status_widget_layout->addWidget(new QLabel(tr("Updating..."), this));
+  d->status_label = new QLabel(tr("Updating..."), this);
+  status_widget_layout->addWidget(d->status_label);
   status_widget_layout->addStretch();
 
   auto cancel_button = new QPushButton(tr("Cancel"), this);
@@ -166,6 +170,9 @@ void ListGeneratorWidget::InitializeWidgets(
   connect(d->model, &ListGeneratorModel::RequestFinished,
           this, &ListGeneratorWidget::OnModelRequestFinished);
 
+  connect(d->model, &ListGeneratorModel::ImportProgress,
+          this, &ListGeneratorWidget::OnModelImportProgress);
+
   d->status_widget->setLayout(status_widget_layout);
 
   // Setup the main layout
@@ -471,6 +478,7 @@ void ListGeneratorWidget::OnThemeChanged(const ThemeManager &theme_manager) {
 }
 
 void ListGeneratorWidget::OnModelRequestStarted(void) {
+  d->status_label->setText(tr("Updating..."));
   d->status_widget->setVisible(true);
   d->model_proxy->setDynamicSortFilter(false);
 }
@@ -480,6 +488,13 @@ void ListGeneratorWidget::OnModelRequestFinished(void) {
   d->model_proxy->setDynamicSortFilter(true);
 }
 
+void ListGeneratorWidget::OnModelImportProgress(size_t num_queued,
+                                                size_t num_imported) {
+  d->status_label->setText(tr("Updating... (%1 of %2 items)")
+                               .arg(num_imported)
+                               .arg(num_imported + num_queued));
+}
+
 //! Used to hide the OSD buttons when focus is lost
 void ListGeneratorWidget::focusOutEvent(QFocusEvent *) {
   UpdateItemButtons();
@@ -10,20 +10,24 @@
 
 #include <QColor>
 #include <QApplication>
-#include <QThreadPool>
+#include <QElapsedTimer>
 #include <QTimer>
 #include <QPalette>
 #include <QtConcurrent>
 #include <QDebug>
 
-#include <atomic>
 #include <algorithm>
 #include <cassert>
 #include <deque>
 #include <multiplier/GUI/Interfaces/ITreeGenerator.h>
+#include <multiplier/GUI/Managers/TaskManager.h>
 #include <multiplier/GUI/Util.h>
+#include <optional>
 #include <unordered_map>
+#include <unordered_set>
 
+#include "ChunkedQueue.h"
+#include "DeferredDataRunnable.h"
 #include "InitTreeRunnable.h"
 #include "ExpandTreeRunnable.h"
 
@@ -49,6 +53,12 @@ struct Node {
   // a duplicate, it points to the duplicate.
   Node *self_or_duplicate{nullptr};
 
+  // Data of the deferred columns of `item`. This is empty until computed.
+  QVariantList deferred_data;
+
+  // Version number at which `deferred_data` was last requested.
+  std::optional<uint64_t> deferred_data_version;
+
   Node *Deduplicate(void) {
     auto node = this;
     if (self_or_duplicate) {
@@ -84,7 +94,7 @@ struct TreeGeneratorModel::PrivateData final {
   
   //! Queue of generated data to insert into our trees. The data are triples of
   //! the version number, the parent node pointer, and the item itself.
-  std::list<QueuedItem> insertion_queue;
+  ChunkedQueue<QueuedItem> insertion_queue;
 
   //! Data generator.
   ITreeGeneratorPtr generator;
@@ -95,35 +105,105 @@ struct TreeGeneratorModel::PrivateData final {
   //! Number of columns.
   int num_columns{0};
 
-  //! Returns the number of pending requests.
+  //! Returns the number of pending requests. This includes both the running
+  //! runnables and the queued expansions.
   int num_pending_requests{0};
 
-  //! Version number of this model. This is incremented when we install a new
-  //! generator.
-  std::atomic_uint64_t version_number;
+  //! Number of runnables started on `task_manager` that haven't finished.
+  int num_running_requests{0};
+
+  //! Expansions that have been requested but not yet started, mapped to
+  //! their depths. Only up to one runnable per thread of `task_manager` runs
+  //! at a time, so that we can pick which expansions to start next.
+  std::unordered_map<Node *, unsigned> queued_expansions;
+
+  //! Queued expansions of visible nodes, in the order in which they became
+  //! visible. This can contain nodes that have since been started or scrolled
+  //! out of view; those are skipped.
+  std::deque<Node *> visible_expansions;
+
+  //! All queued expansions, in the order in which they were requested. This
+  //! can contain nodes that have since been started; those are skipped.
+  std::deque<Node *> ordered_expansions;
+
+  //! Nodes on screen, and their ancestors.
+  std::unordered_set<Node *> visible_nodes;
+
+  //! Number of items imported into the tree since the generator was
+  //! installed.
+  size_t num_imported{0u};
+
+  //! Nodes whose deferred data has been requested, but whose runnables
+  //! haven't yet been started.
+  std::vector<Node *> pending_deferred_data;
+
+  //! Starts the runnables for `pending_deferred_data` on the next turn of the
+  //! event loop, so that all the rows of one repaint are batched together.
+  QTimer deferred_data_timer;
+
+  //! Runs all expansion runnables.
+  TaskManager &task_manager;
+
+  //! Cancellation group of the expansion runnables. This is cancelled when we
+  //! install a new generator.
+  TaskGroup task_group;
 
-  //! Thread pool for all expansion runnables.
-  QThreadPool thread_pool;
+  inline PrivateData(TaskManager &task_manager_, const QString &model_id_)
+      : model_id(model_id_),
+        task_manager(task_manager_) {}
 
-  inline PrivateData(const QString &model_id_)
-      : model_id(model_id_) {}
+  //! Returns the data of column `col` of `node`. Deferred data that hasn't
+  //! been computed yet is requested, and is invalid in the meantime.
+  QVariant ColumnData(Node *node, int col);
 };
 
+QVariant TreeGeneratorModel::PrivateData::ColumnData(Node *node, int col) {
+  if (!node->item->IsDeferred(col)) {
+    return node->item->Data(col);
+  }
+
+  if (col < node->deferred_data.size()) {
+    return node->deferred_data[col];
+  }
+
+  // Request the data if we haven't already done so. If a request was
+  // cancelled then its version number is stale, and we ask again.
+  auto version_number = task_group.Generation();
+  if (node->deferred_data_version != version_number) {
+    node->deferred_data_version = version_number;
+    pending_deferred_data.push_back(node);
+    if (!deferred_data_timer.isActive()) {
+      deferred_data_timer.start(0);
+    }
+  }
+
+  return {};
+}
+
 //! Constructor
-TreeGeneratorModel::TreeGeneratorModel(const QString &model_id, QObject *parent)
+TreeGeneratorModel::TreeGeneratorModel(TaskManager &task_manager,
+                                       const QString &model_id, QObject *parent)
     : IModel(parent),
-      d(new PrivateData(model_id)) {
+      d(new PrivateData(task_manager, model_id)) {
 
   connect(&d->import_timer, &QTimer::timeout, this,
           &TreeGeneratorModel::ProcessData);
+
+  d->deferred_data_timer.setSingleShot(true);
+  connect(&d->deferred_data_timer, &QTimer::timeout, this,
+          &TreeGeneratorModel::RunDeferredDataThreads);
 }
 
 TreeGeneratorModel::~TreeGeneratorModel(void) {
+
+  // NOTE: Our parent widget is being destroyed, so it shouldn't hear
+  //       about the cancellation.
+  blockSignals(true);
   CancelRunningRequest();
 }
 
 void TreeGeneratorModel::RunExpansionThread(
-    IGenerateTreeRunnable *runnable) {
+    IGenerateTreeRunnable *runnable, TaskPriority priority) {
 
   connect(runnable, &IGenerateTreeRunnable::NewGeneratedItems,
           this, &TreeGeneratorModel::AddData);
@@ -131,20 +211,184 @@ void TreeGeneratorModel::RunExpansionThread(
   connect(runnable, &IGenerateTreeRunnable::Finished,
           this, &TreeGeneratorModel::OnRequestFinished);
 
+  d->num_running_requests += 1;
+  d->task_manager.Start(runnable, priority, d->task_group);
+}
+
+void TreeGeneratorModel::StartRequest(void) {
   if (!d->num_pending_requests) {
     emit RequestStarted();
   }
 
   d->num_pending_requests += 1;
-  d->thread_pool.start(runnable);
+}
+
+//! Queue up the expansion of `node` to `depth` levels deep.
+void TreeGeneratorModel::ScheduleExpansion(uint64_t node_id, unsigned depth) {
+  auto node = reinterpret_cast<Node *>(node_id);
+  StartRequest();
+
+  d->queued_expansions.emplace(node, depth);
+  d->ordered_expansions.push_back(node);
+  if (d->visible_nodes.count(node)) {
+    d->visible_expansions.push_back(node);
+  }
+
+  RunQueuedExpansions();
+}
+
+//! Start queued expansions until every thread is busy, visible ones first.
+void TreeGeneratorModel::RunQueuedExpansions(void) {
+  auto max_running = d->task_manager.MaxThreadCount();
+
+  while (d->num_running_requests < max_running &&
+         !d->queued_expansions.empty()) {
+
+    Node *node = nullptr;
+    auto priority = TaskPriority::kVisible;
+    while (!node && !d->visible_expansions.empty()) {
+      node = d->visible_expansions.front();
+      d->visible_expansions.pop_front();
+      if (!d->visible_nodes.count(node)) {
+        node = nullptr;
+      }
+    }
+
+    if (!node) {
+      Q_ASSERT(!d->ordered_expansions.empty());
+      node = d->ordered_expansions.front();
+      d->ordered_expansions.pop_front();
+      if (!d->visible_nodes.count(node)) {
+        priority = TaskPriority::kBackground;
+      }
+    }
+
+    auto it = d->queued_expansions.find(node);
+    if (it == d->queued_expansions.end()) {
+      continue;  // Already started.
+    }
+
+    auto depth = it->second;
+    d->queued_expansions.erase(it);
+
+    RunExpansionThread(
+        new ExpandTreeRunnable(d->generator, d->task_group, node->item,
+                               reinterpret_cast<uintptr_t>(node), depth),
+        priority);
+  }
 }
 
 void TreeGeneratorModel::OnRequestFinished(void) {
+  d->num_running_requests -= 1;
   d->num_pending_requests -= 1;
+  Q_ASSERT(d->num_running_requests >= 0);
   Q_ASSERT(d->num_pending_requests >= 0);
   if (!d->num_pending_requests) {
     emit RequestFinished();
   }
+
+  RunQueuedExpansions();
+}
+
+//! Start runnables to compute the requested deferred data, visible rows
+//! first.
+void TreeGeneratorModel::RunDeferredDataThreads(void) {
+  std::vector<Node *> pending;
+  pending.swap(d->pending_deferred_data);
+
+  // Rows that aren't on screen are requested when sorting or filtering needs
+  // their data. There can be many of those, so they run in the background.
+  auto first_hidden = std::stable_partition(
+      pending.begin(), pending.end(),
+      [this] (Node *node) { return d->visible_nodes.count(node) != 0u; });
+
+  auto run = [this] (auto begin, auto end, TaskPriority priority) {
+    while (begin != end) {
+      auto batch_end = begin + std::min<ptrdiff_t>(
+          kDeferredDataBatchSize, end - begin);
+
+      QVector<uint64_t> item_ids;
+      QVector<IGeneratedItemPtr> items;
+      for (auto it = begin; it != batch_end; ++it) {
+        item_ids.push_back(reinterpret_cast<uintptr_t>(*it));
+        items.push_back((*it)->item);
+      }
+
+      auto runnable = new DeferredDataRunnable(
+          d->task_group, std::move(item_ids), std::move(items),
+          d->num_columns);
+
+      connect(runnable, &DeferredDataRunnable::NewDeferredData,
+              this, &TreeGeneratorModel::AddDeferredData);
+
+      d->task_manager.Start(runnable, priority, d->task_group);
+      begin = batch_end;
+    }
+  };
+
+  run(pending.begin(), first_hidden, TaskPriority::kVisible);
+  run(first_hidden, pending.end(), TaskPriority::kBackground);
+}
+
+//! Cache computed deferred data in the nodes, and update their rows.
+void TreeGeneratorModel::AddDeferredData(
+    uint64_t version_number, QVector<uint64_t> item_ids,
+    QVector<QVariantList> data) {
+
+  if (d->task_group.IsCancelled(version_number)) {
+    return;
+  }
+
+  Q_ASSERT(item_ids.size() == data.size());
+  for (auto i = 0; i < item_ids.size(); ++i) {
+    auto node = reinterpret_cast<Node *>(item_ids[i]);
+    node->deferred_data = std::move(data[i]);
+    emit dataChanged(createIndex(node->row, 0, node),
+                     createIndex(node->row, d->num_columns - 1, node));
+  }
+}
+
+//! Tell the model which rows are on screen, so that their expansions run
+//! before those of off-screen rows.
+void TreeGeneratorModel::SetVisibleRows(const QModelIndexList &indexes) {
+  d->visible_nodes.clear();
+
+  for (const QModelIndex &index : indexes) {
+    if (!index.isValid() || index.model() != this) {
+      continue;
+    }
+
+    // Visible rows, and their ancestors, up to the root.
+    for (auto node = reinterpret_cast<Node *>(index.internalPointer());
+         node && node != &(d->root) && d->visible_nodes.insert(node).second;
+         node = node->parent) {
+
+      if (d->queued_expansions.count(node)) {
+        d->visible_expansions.push_back(node);
+      }
+    }
+  }
+
+  // Forget about anything that has since scrolled out of view.
+  auto it = std::remove_if(
+      d->visible_expansions.begin(), d->visible_expansions.end(),
+      [this] (Node *node) { return !d->visible_nodes.count(node); });
+  d->visible_expansions.erase(it, d->visible_expansions.end());
+}
+
+//! Return the current queue depths.
+TreeGeneratorModel::ExpansionStatistics
+TreeGeneratorModel::GetExpansionStatistics(void) const {
+  ExpansionStatistics stats;
+  stats.num_running = static_cast<size_t>(d->num_running_requests);
+  stats.num_queued = d->queued_expansions.size();
+  stats.num_import_queued = d->insertion_queue.size();
+  for (Node *node : d->visible_nodes) {
+    if (d->queued_expansions.count(node)) {
+      ++stats.num_visible_queued;
+    }
+  }
+  return stats;
 }
 
 //! Find the original version of an item.
@@ -190,9 +434,7 @@ void TreeGeneratorModel::Expand(const QModelIndex &index, unsigned depth) {
     // Never been expanded; try to expand it.
     if (!node->self_or_duplicate) {
       node->self_or_duplicate = node;
-      RunExpansionThread(new ExpandTreeRunnable(
-          d->generator, d->version_number, node->item,
-          reinterpret_cast<uintptr_t>(node), depth));
+      ScheduleExpansion(reinterpret_cast<uintptr_t>(node), depth);
       continue;
     }
 
@@ -213,7 +455,7 @@ void TreeGeneratorModel::InstallGenerator(ITreeGeneratorPtr generator_) {
   CancelRunningRequest();
 
   emit beginResetModel();
-  d->version_number.fetch_add(1u);
+  d->task_group.Cancel();
   d->root.nodes.clear();
   d->root.parent = &(d->root);
   d->root.self_or_duplicate = nullptr;
@@ -222,14 +464,23 @@ void TreeGeneratorModel::InstallGenerator(ITreeGeneratorPtr generator_) {
   d->entity_to_node.clear();
   d->entity_to_node.emplace(kInvalidEntityId, &(d->root));
   d->nodes.swap(old_nodes);
+  d->visible_nodes.clear();
+  d->insertion_queue.clear();
+  d->import_timer.stop();
+  d->num_imported = 0u;
+  d->pending_deferred_data.clear();
+  d->deferred_data_timer.stop();
   emit endResetModel();
 
   if (d->generator) {
     d->root.self_or_duplicate = &(d->root);
-    RunExpansionThread(new InitTreeRunnable(
-        d->generator, d->version_number, {},
-        reinterpret_cast<uintptr_t>(&(d->root)),
-        d->generator->InitialExpansionDepth()));
+    StartRequest();
+    RunExpansionThread(
+        new InitTreeRunnable(
+            d->generator, d->task_group, {},
+            reinterpret_cast<uintptr_t>(&(d->root)),
+            d->generator->InitialExpansionDepth()),
+        TaskPriority::kInteractive);
   }
 }
 
@@ -321,7 +572,7 @@ QVariant TreeGeneratorModel::data(const QModelIndex &index, int role) const {
   }
 
   if (role == Qt::DisplayRole || role == IModel::TokenRangeDisplayRole) {
-    QVariant data = node->item->Data(column);
+    QVariant data = d->ColumnData(node, column);
     if (!data.isValid()) {
       return {};
     }
@@ -344,7 +595,7 @@ QVariant TreeGeneratorModel::data(const QModelIndex &index, int role) const {
         = tr("Entity Id: %1").arg(::mx::EntityId(node->item->Entity()).Pack());
     if (d->generator) {
       for (int i = 0; i < d->num_columns; ++i) {
-        QVariant col_data = node->item->Data(i);
+        QVariant col_data = d->ColumnData(node, i);
         if (auto as_str = TryConvertToString(col_data)) {
           tooltip += QString("\n%1: %2")
                          .arg(d->generator->ColumnTitle(i))
@@ -388,7 +639,17 @@ void TreeGeneratorModel::CancelRunningRequest(void) {
     return;
   }
 
-  d->version_number.fetch_add(1u);
+  d->task_group.Cancel();
+
+  // Queued expansions will never start, so they'll never finish either.
+  d->num_pending_requests -= static_cast<int>(d->queued_expansions.size());
+  d->queued_expansions.clear();
+  d->visible_expansions.clear();
+  d->ordered_expansions.clear();
+
+  if (!d->num_pending_requests) {
+    emit RequestFinished();
+  }
 }
 
 //! Notify us when there's a batch of new data to update.
@@ -396,18 +657,15 @@ void TreeGeneratorModel::AddData(
     uint64_t version_number, uint64_t parent_item_id,
     QVector<IGeneratedItemPtr> child_items, unsigned remaining_depth) {
 
-  if (version_number != d->version_number.load()) {
+  if (d->task_group.IsCancelled(version_number)) {
     return;
   }
 
   auto parent_node = reinterpret_cast<Node *>(parent_item_id);
 
   for (auto &child_item : child_items) {
-    QueuedItem &entry = d->insertion_queue.emplace_back();
-    entry.version_number = version_number;
-    entry.parent_node = parent_node;
-    entry.item = std::move(child_item);
-    entry.remaining_depth = remaining_depth;
+    d->insertion_queue.push_back(QueuedItem{
+        version_number, parent_node, std::move(child_item), remaining_depth});
   }
 
   if (!d->import_timer.isActive()) {
@@ -416,9 +674,12 @@ void TreeGeneratorModel::AddData(
 }
 
 void TreeGeneratorModel::ProcessData(void) {
+  QElapsedTimer timer;
+  timer.start();
+
   size_t num_changes = 0u;
 
-  auto version_number = d->version_number.load();
+  auto version_number = d->task_group.Generation();
 
   Node *root_node = &(d->root);
 
@@ -441,14 +702,14 @@ void TreeGeneratorModel::ProcessData(void) {
 
   while (!d->insertion_queue.empty()) {
 
-    // If we've made too many changes overall then stop now and push things
-    // to the next time.
-    if (num_changes >= kMaxBatchSize) {
+    // If we've used up our time budget then stop now and push things to the
+    // next turn of the event loop. We always import at least one item so that
+    // we make progress.
+    if (num_changes && timer.hasExpired(kImportTimeBudget)) {
       break;
     }
 
-    QueuedItem entry = std::move(d->insertion_queue.front());
-    d->insertion_queue.pop_front();
+    QueuedItem entry = d->insertion_queue.take_front();
 
     // If the version number is wrong then this is batched data for some
     // previous entity, and so we want to ignore it.
@@ -500,10 +761,8 @@ void TreeGeneratorModel::ProcessData(void) {
       Q_ASSERT(!entity_node->self_or_duplicate);
       Q_ASSERT(entity_node->Deduplicate() == entity_node);
       entity_node->self_or_duplicate = entity_node;
-      RunExpansionThread(new ExpandTreeRunnable(
-          d->generator, d->version_number, entity_node->item,
-          reinterpret_cast<uintptr_t>(entity_node),
-          entry.remaining_depth));
+      ScheduleExpansion(reinterpret_cast<uintptr_t>(entity_node),
+                        entry.remaining_depth);
     }
   }
 
@@ -543,9 +802,16 @@ void TreeGeneratorModel::ProcessData(void) {
     emit endInsertRows();
   }
 
-  // If there's still anything left then restart the timer to import more.
+  d->num_imported += num_changes;
+  emit ImportProgress(d->insertion_queue.size(), d->num_imported);
+
+  // If there's still anything left then import more as soon as the view has
+  // caught up with this batch. Otherwise, the next batch to arrive restarts
+  // the timer.
   if (!d->insertion_queue.empty()) {
-    d->import_timer.start(kBatchIntervalTime);
+    d->import_timer.start(0);
+  } else {
+    d->import_timer.stop();
   }
 }
 
@@ -10,6 +10,7 @@
 
 #include <multiplier/GUI/Interfaces/IModel.h>
 #include <multiplier/GUI/Interfaces/ITreeGenerator.h>
+#include <multiplier/GUI/Managers/TaskManager.h>
 
 #include <QVector>
 
@@ -38,8 +39,24 @@ class TreeGeneratorModel Q_DECL_FINAL : public IModel {
     IsDuplicate,
   };
 
+  //! Depths of the queues of work of this model.
+  struct ExpansionStatistics {
+    //! Number of expansion runnables that are running.
+    size_t num_running{0u};
+
+    //! Number of expansions that are waiting to run.
+    size_t num_queued{0u};
+
+    //! Number of queued expansions whose rows are on screen.
+    size_t num_visible_queued{0u};
+
+    //! Number of generated items waiting to be imported into the tree.
+    size_t num_import_queued{0u};
+  };
+
   //! Constructor
-  TreeGeneratorModel(const QString &model_id, QObject *parent = nullptr);
+  TreeGeneratorModel(TaskManager &task_manager, const QString &model_id,
+                     QObject *parent = nullptr);
 
   //! Destructor
   virtual ~TreeGeneratorModel(void);
@@ -53,6 +70,13 @@ class TreeGeneratorModel Q_DECL_FINAL : public IModel {
   //! Find the original version of an item.
   QModelIndex Deduplicate(const QModelIndex &);
 
+  //! Tell the model which rows are on screen, so that their expansions run
+  //! before those of off-screen rows.
+  void SetVisibleRows(const QModelIndexList &indexes);
+
+  //! Return the current queue depths.
+  ExpansionStatistics GetExpansionStatistics(void) const;
+
   //! Creates a new Qt model index
   QModelIndex index(
       int row, int column, const QModelIndex &parent) const Q_DECL_FINAL;
@@ -76,7 +100,22 @@ class TreeGeneratorModel Q_DECL_FINAL : public IModel {
                       int role) const Q_DECL_FINAL;
 
  private:
-  void RunExpansionThread(IGenerateTreeRunnable *runnable);
+  void RunExpansionThread(IGenerateTreeRunnable *runnable,
+                          TaskPriority priority);
+
+  //! Count a new request, and maybe emit `RequestStarted`.
+  void StartRequest(void);
+
+  //! Queue up the expansion of the node identified by `node_id` to `depth`
+  //! levels deep.
+  void ScheduleExpansion(uint64_t node_id, unsigned depth);
+
+  //! Start queued expansions until every thread is busy, visible ones first.
+  void RunQueuedExpansions(void);
+
+  //! Start runnables to compute the requested deferred data, visible rows
+  //! first.
+  void RunDeferredDataThreads(void);
 
  private slots:
 
@@ -91,6 +130,10 @@ class TreeGeneratorModel Q_DECL_FINAL : public IModel {
   //! When an expansion thread is done sending data, we get this.
   void OnRequestFinished(void);
 
+  //! Cache computed deferred data in the nodes, and update their rows.
+  void AddDeferredData(uint64_t version_number, QVector<uint64_t> item_ids,
+                       QVector<QVariantList> data);
+
  public slots:
   void CancelRunningRequest(void);
  
@@ -100,6 +143,11 @@ class TreeGeneratorModel Q_DECL_FINAL : public IModel {
 
   //! Emitted when a request has finished
   void RequestFinished(void);
+
+  //! Emitted after each import of generated items into the tree, with the
+  //! number of items still waiting to be imported, and the total number of
+  //! items imported since the generator was installed.
+  void ImportProgress(size_t num_queued, size_t num_imported);
 };
 
 }  // namespace mx::gui
\ No newline at end of file
@@ -13,6 +13,7 @@
 #include <multiplier/GUI/Util.h>
 #include <multiplier/GUI/Managers/ConfigManager.h>
 #include <multiplier/GUI/Managers/MediaManager.h>
+#include <multiplier/GUI/Managers/TaskManager.h>
 #include <multiplier/GUI/Widgets/FilterSettingsWidget.h>
 #include <multiplier/GUI/Widgets/SearchWidget.h>
 
@@ -25,6 +26,7 @@
 #include <QMenu>
 #include <QPushButton>
 #include <QScrollBar>
+#include <QTimer>
 #include <QTreeView>
 
 namespace mx::gui {
@@ -32,6 +34,10 @@ namespace {
 
 static constexpr unsigned kMaxExpansionLevel = 9u;
 
+// Delay, in milliseconds, between the visible rows changing and telling the
+// model about it, so that we don't recompute them on every scroll step.
+static constexpr int kVisibleRowsUpdateDelay = 50;
+
 // Activate the selected index when pressing this key
 static constexpr auto kActivateSelectedItem{Qt::Key_Return};
 
@@ -82,6 +88,7 @@ struct TreeGeneratorWidget::PrivateData final {
   SearchWidget *search_widget{nullptr};
   FilterSettingsWidget *filter_settings_widget{nullptr};
   QWidget *status_widget{nullptr};
+  QLabel *status_label{nullptr};
 
   bool updating_buttons{false};
 
@@ -99,6 +106,9 @@ struct TreeGeneratorWidget::PrivateData final {
 
   QModelIndex selected_index;
   QElapsedTimer selection_timer;
+
+  // Used to coalesce updates of the visible rows.
+  QTimer visible_rows_timer;
 };
 
 TreeGeneratorWidget::~TreeGeneratorWidget(void) {}
@@ -110,7 +120,12 @@ TreeGeneratorWidget::TreeGeneratorWidget(
       d(new PrivateData) {
 
   d->selection_timer.start();
-  d->model = new TreeGeneratorModel(model_id, this);
+  d->model = new TreeGeneratorModel(config_manager.TaskManager(), model_id,
+                                    this);
+
+  d->visible_rows_timer.setSingleShot(true);
+  connect(&d->visible_rows_timer, &QTimer::timeout,
+          this, &TreeGeneratorWidget::UpdateVisibleRows);
 
   // (void) new QAbstractItemModelTester(
   //     d->model, QAbstractItemModelTester::FailureReportingMode::Fatal, this);
@@ -157,6 +172,13 @@ void TreeGeneratorWidget::InstallModel(void) {
   connect(d->model_proxy, &QAbstractItemModel::rowsInserted,
           this, &TreeGeneratorWidget::OnRowsInserted);
 
+  // Sorting and filtering move rows into and out of view.
+  connect(d->model_proxy, &QAbstractItemModel::layoutChanged,
+          this, &TreeGeneratorWidget::ScheduleVisibleRowsUpdate);
+
+  connect(d->model_proxy, &QAbstractItemModel::rowsRemoved,
+          this, &TreeGeneratorWidget::ScheduleVisibleRowsUpdate);
+
   OnModelReset();
 }
 
@@ -180,6 +202,17 @@ void TreeGeneratorWidget::InitializeWidgets(
 
   d->tree_view->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 
+  // Rows on screen get expanded before those that aren't, so keep the model
+  // up-to-date with what's on screen.
+  connect(d->tree_view->verticalScrollBar(), &QScrollBar::valueChanged,
+          this, &TreeGeneratorWidget::ScheduleVisibleRowsUpdate);
+
+  connect(d->tree_view, &QTreeView::expanded,
+          this, &TreeGeneratorWidget::ScheduleVisibleRowsUpdate);
+
+  connect(d->tree_view, &QTreeView::collapsed,
+          this, &TreeGeneratorWidget::ScheduleVisibleRowsUpdate);
+
   // The auto scroll takes care of keeping the active item within the
   // visible viewport region. This is true for mouse clicks but also
   // keyboard navigation (i.e. arrow keys, page up/down, etc).
@@ -257,7 +290,8 @@ void TreeGeneratorWidget::InitializeWidgets(
   auto status_widget_layout = new QHBoxLayout();
   status_widget_layout->setContentsMargins(0, 0, 0, 0);
 
-  status_widget_layout->addWidget(new QLabel(tr("Updating..."), this));
+  d->status_label = new QLabel(tr("Updating..."), this);
+  status_widget_layout->addWidget(d->status_label);
   status_widget_layout->addStretch();
 
   auto cancel_button = new QPushButton(tr("Cancel"), this);
@@ -272,6 +306,9 @@ void TreeGeneratorWidget::InitializeWidgets(
   connect(d->model, &TreeGeneratorModel::RequestFinished,
           this, &TreeGeneratorWidget::OnModelRequestFinished);
 
+  connect(d->model, &TreeGeneratorModel::ImportProgress,
+          this, &TreeGeneratorWidget::OnModelImportProgress);
+
   d->status_widget->setLayout(status_widget_layout);
 
   // Setup the main layout
@@ -475,6 +512,34 @@ bool TreeGeneratorWidget::eventFilter(QObject *obj, QEvent *event) {
 
 void TreeGeneratorWidget::resizeEvent(QResizeEvent *) {
   UpdateItemButtons();
+  ScheduleVisibleRowsUpdate();
+}
+
+void TreeGeneratorWidget::ScheduleVisibleRowsUpdate(void) {
+  if (!d->visible_rows_timer.isActive()) {
+    d->visible_rows_timer.start(kVisibleRowsUpdateDelay);
+  }
+}
+
+//! Tell the model which of its rows are on screen.
+void TreeGeneratorWidget::UpdateVisibleRows(void) {
+  QModelIndexList visible_rows;
+
+  auto viewport = d->tree_view->viewport();
+  auto viewport_height = viewport->height();
+
+  // NOTE: We probe the right edge of the viewport because the left edge
+  //       can land in the indentation of nested rows.
+  auto index = d->tree_view->indexAt(QPoint(viewport->width() - 1, 0));
+  for (; index.isValid(); index = d->tree_view->indexBelow(index)) {
+    if (d->tree_view->visualRect(index).top() >= viewport_height) {
+      break;
+    }
+
+    visible_rows.append(d->model_proxy->mapToSource(index));
+  }
+
+  d->model->SetVisibleRows(visible_rows);
 }
 
 void TreeGeneratorWidget::UpdateItemButtons(void) {
@@ -626,6 +691,7 @@ void TreeGeneratorWidget::OnIconsChanged(const MediaManager &media_manager) {
 void TreeGeneratorWidget::OnModelReset(void) {
   ExpandAllNodes();
   UpdateItemButtons();
+  ScheduleVisibleRowsUpdate();
 }
 
 void TreeGeneratorWidget::OnDataChanged(void) {
@@ -648,6 +714,7 @@ void TreeGeneratorWidget::OnRowsInserted(const QModelIndex &parent, int, int) {
   if (0 < d->sort_column) {
     d->tree_view->resizeColumnToContents(d->sort_column);
   }
+  ScheduleVisibleRowsUpdate();
 }
 
 void TreeGeneratorWidget::OnItemActivated(const QModelIndex &current_index) {
@@ -758,6 +825,7 @@ void TreeGeneratorWidget::OnThemeChanged(const ThemeManager &theme_manager) {
 }
 
 void TreeGeneratorWidget::OnModelRequestStarted(void) {
+  d->status_label->setText(tr("Updating..."));
   d->status_widget->setVisible(true);
   d->model_proxy->setDynamicSortFilter(false);
 }
@@ -767,6 +835,27 @@ void TreeGeneratorWidget::OnModelRequestFinished(void) {
   d->model_proxy->setDynamicSortFilter(true);
 }
 
+void TreeGeneratorWidget::OnModelImportProgress(size_t num_queued,
+                                                size_t num_imported) {
+  auto stats = d->model->GetExpansionStatistics();
+  auto num_expansions = stats.num_running + stats.num_queued;
+  if (!num_expansions) {
+    d->status_label->setText(tr("Updating... (%1 of %2 items)")
+                                 .arg(num_imported)
+                                 .arg(num_imported + num_queued));
+    return;
+  }
+
+  // Show how much expansion work is left, and how much of it is for rows
+  // that are on screen, i.e. which is going to run first.
+  d->status_label->setText(
+      tr("Updating... (%1 of %2 items, %3 expansions left, %4 on screen)")
+          .arg(num_imported)
+          .arg(num_imported + num_queued)
+          .arg(num_expansions)
+          .arg(stats.num_visible_queued));
+}
+
 //! Used to hide the OSD buttons when focus is lost
 void TreeGeneratorWidget::focusOutEvent(QFocusEvent *) {
   UpdateItemButtons();
@@ -13,12 +13,12 @@
 #include <multiplier/Frontend/File.h>
 #include <multiplier/GUI/Managers/ConfigManager.h>
 #include <multiplier/GUI/Managers/MediaManager.h>
+#include <multiplier/GUI/Managers/TaskManager.h>
 #include <multiplier/GUI/Widgets/CodeWidget.h>
 
 #include <QHBoxLayout>
 #include <QIcon>
 #include <QMenu>
-#include <QThreadPool>
 #include <QToolButton>
 #include <QShortcut>
 
@@ -60,6 +60,10 @@ using ItemList = std::list<Item>;
 struct HistoryWidget::PrivateData {
   FileLocationCache file_cache;
 
+  // Runs the `HistoryLabelBuilder`s.
+  TaskManager &task_manager;
+  TaskGroup task_group;
+
   const unsigned max_history_size;
   ItemList item_list;
 
@@ -87,8 +91,10 @@ struct HistoryWidget::PrivateData {
   QShortcut *forward_shortcut{nullptr};
 
   inline PrivateData(const FileLocationCache &file_cache_,
+                     TaskManager &task_manager_,
                      unsigned max_history_size_)
       : file_cache(file_cache_),
+        task_manager(task_manager_),
         max_history_size(max_history_size_),
         current_item_it(item_list.end()) {}
 
@@ -106,7 +112,8 @@ HistoryWidget::HistoryWidget(const ConfigManager &config_manager,
                              bool install_global_shortcuts,
                              QWidget *parent)
     : QWidget(parent),
-      d(new PrivateData(config_manager.FileLocationCache(), max_history_size)) {
+      d(new PrivateData(config_manager.FileLocationCache(),
+                        config_manager.TaskManager(), max_history_size)) {
 
   InitializeWidgets(parent, install_global_shortcuts);
 
@@ -226,7 +233,7 @@ void HistoryWidget::PrivateData::AddToHistory(
       connect(labeller, &HistoryLabelBuilder::LabelForItem,
               widget, &HistoryWidget::OnLabelForItem);
 
-      QThreadPool::globalInstance()->start(labeller);
+      task_manager.Start(labeller, TaskPriority::kBackground, task_group);
     
     } else {
       Q_ASSERT(false);
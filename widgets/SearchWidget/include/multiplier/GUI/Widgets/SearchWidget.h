@@ -58,6 +58,12 @@ class SearchWidget Q_DECL_FINAL : public QWidget {
   //! Called by the other client widget to update the search result count
   void UpdateSearchResultCount(size_t search_result_count);
 
+  //! Called by the other client widget as search results stream in. Unlike
+  //! `UpdateSearchResultCount`, this only shows the first result if there
+  //! weren't any results before. `search_complete` is `false` while more
+  //! results may follow.
+  void UpdateSearchProgress(size_t search_result_count, bool search_complete);
+
   //! Return the current search paramters.
   const SearchParameters &Parameters(void) const;
 
@@ -81,6 +87,9 @@ class SearchWidget Q_DECL_FINAL : public QWidget {
   //! Helper method for OnShowPreviousResult and OnShowNextResult
   void ShowResult(void);
 
+  //! Shows which result is the current one in the message display
+  void ShowResultMessage(void);
+
   //! Updates the icons based on the active theme
   void UpdateIcons(void);
 
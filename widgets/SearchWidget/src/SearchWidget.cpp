@@ -31,6 +31,7 @@ struct SearchWidget::PrivateData final {
 
   size_t search_result_count{};
   size_t current_search_result{};
+  bool search_complete{true};
 
   QIcon show_prev_result_icon;
   QPushButton *show_prev_result{nullptr};
@@ -69,6 +70,7 @@ SearchWidget::~SearchWidget(void) {}
 void SearchWidget::UpdateSearchResultCount(size_t search_result_count) {
   d->search_result_count = search_result_count;
   d->current_search_result = 0;
+  d->search_complete = true;
 
   d->show_next_result->setEnabled(d->search_result_count != 0);
   d->show_prev_result->setEnabled(d->search_result_count != 0);
@@ -81,6 +83,29 @@ void SearchWidget::UpdateSearchResultCount(size_t search_result_count) {
   ShowResult();
 }
 
+void SearchWidget::UpdateSearchProgress(size_t search_result_count,
+                                        bool search_complete) {
+  auto had_results = d->search_result_count != 0;
+  d->search_result_count = search_result_count;
+  d->search_complete = search_complete;
+
+  d->show_next_result->setEnabled(d->search_result_count != 0);
+  d->show_prev_result->setEnabled(d->search_result_count != 0);
+
+  if (d->search_result_count == 0) {
+    SetDisplayMessage(false, search_complete ? tr("No result found")
+                                             : tr("Searching..."));
+    return;
+  }
+
+  if (!had_results) {
+    d->current_search_result = 0;
+    ShowResult();
+  } else {
+    ShowResultMessage();
+  }
+}
+
 SearchWidget::SearchWidget(const MediaManager &media_manager, Mode mode,
                            QWidget *parent)
     : QWidget(parent),
@@ -231,12 +256,19 @@ void SearchWidget::ClearDisplayMessage() {
 }
 
 void SearchWidget::ShowResult(void) {
+  ShowResultMessage();
+  emit ShowSearchResult(d->current_search_result);
+}
+
+void SearchWidget::ShowResultMessage(void) {
+  // More results may still be found.
+  auto suffix = d->search_complete ? QString() : QString("+");
+
   SetDisplayMessage(false, tr("Showing result ") +
                                QString::number(d->current_search_result + 1) +
                                tr(" of ") +
-                               QString::number(d->search_result_count));
-
-  emit ShowSearchResult(d->current_search_result);
+                               QString::number(d->search_result_count) +
+                               suffix);
 }
 
 void SearchWidget::UpdateIcons(void) {